@@ -0,0 +1,65 @@
+#include "arena.h"
+#include <stdexcept>
+
+Arena::Arena(size_t block_size_) : block_size(block_size_) {
+    if (block_size == 0) throw std::invalid_argument("arena block size must be positive");
+}
+
+Arena::Arena(Arena&& o) noexcept
+    : block_size(o.block_size)
+    , ptr(std::exchange(o.ptr, nullptr))
+    , remaining(std::exchange(o.remaining, 0))
+    , used(std::exchange(o.used, 0))
+    , reserved(std::exchange(o.reserved, 0))
+    , blocks(std::move(o.blocks)) {
+    o.blocks.clear();
+}
+
+Arena& Arena::operator=(Arena&& o) noexcept {
+    if (this != &o) {
+        block_size = o.block_size;
+        ptr = std::exchange(o.ptr, nullptr);
+        remaining = std::exchange(o.remaining, 0);
+        used = std::exchange(o.used, 0);
+        reserved = std::exchange(o.reserved, 0);
+        blocks = std::move(o.blocks);
+        o.blocks.clear();
+    }
+    return *this;
+}
+
+char* Arena::allocate_aligned(size_t bytes, size_t align) {
+    size_t pad = (align - (reinterpret_cast<uintptr_t>(ptr) & (align - 1))) & (align - 1);
+    if (bytes + pad <= remaining) {
+        char* p = ptr + pad;
+        ptr += bytes + pad;
+        remaining -= bytes + pad;
+        used += bytes + pad;
+        return p;
+    }
+    // fresh blocks come from new[], which is max_align_t aligned
+    if (align <= alignof(std::max_align_t)) return allocate_fallback(bytes);
+    char* p = allocate_fallback(bytes + align - 1);
+    return p + ((align - (reinterpret_cast<uintptr_t>(p) & (align - 1))) & (align - 1));
+}
+
+char* Arena::allocate_fallback(size_t bytes) {
+    if (bytes > block_size / 4) {
+        // large request: dedicated block, keep bumping in the current one
+        used += bytes;
+        return new_block(bytes);
+    }
+    ptr = new_block(block_size);
+    remaining = block_size;
+    char* p = ptr;
+    ptr += bytes;
+    remaining -= bytes;
+    used += bytes;
+    return p;
+}
+
+char* Arena::new_block(size_t bytes) {
+    blocks.emplace_back(new char[bytes]);   // not value-initialised: no memset
+    reserved += bytes;
+    return blocks.back().get();
+}
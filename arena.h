@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Arena: bump allocator for memtable nodes and key/value bytes
+// ----------------------------------------
+// Memory is carved out of large blocks by advancing a pointer; nothing is
+// freed individually. Everything goes away at once when the arena is
+// destroyed (i.e. when the memtable is flushed and replaced), so a memtable
+// costs a handful of malloc calls instead of several per insert.
+//
+// Requests larger than a quarter of the block size get a block of their own,
+// so an unusually large value does not waste the rest of the current block.
+// Not thread-safe.
+class Arena {
+public:
+    static constexpr size_t kDefaultBlockSize = 64 * 1024;
+
+    explicit Arena(size_t block_size = kDefaultBlockSize);
+
+    Arena(Arena&& o) noexcept;
+    Arena& operator=(Arena&& o) noexcept;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // 'bytes' bytes with no alignment guarantee (key/value bytes).
+    char* allocate(size_t bytes) {
+        if (bytes <= remaining) {
+            char* p = ptr;
+            ptr += bytes;
+            remaining -= bytes;
+            used += bytes;
+            return p;
+        }
+        return allocate_fallback(bytes);
+    }
+
+    // 'bytes' bytes aligned to 'align' (a power of two). Alignments above
+    // alignof(max_align_t), e.g. a cache line, may waste up to align - 1
+    // bytes when a new block is started.
+    char* allocate_aligned(size_t bytes, size_t align = alignof(std::max_align_t));
+
+    // Construct a T in the arena. T's destructor is never run, so it must be trivial.
+    template <class T, class... Args>
+    T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible_v<T>, "arena objects are never destroyed");
+        return new (allocate_aligned(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Copy 's' into the arena and return a view of the copy.
+    std::string_view copy(std::string_view s) {
+        if (s.empty()) return {};
+        char* p = allocate(s.size());
+        std::memcpy(p, s.data(), s.size());
+        return {p, s.size()};
+    }
+
+    // Bytes handed out so far (what a memtable's size is measured in).
+    [[nodiscard]] size_t bytes_used() const { return used; }
+
+    // Bytes obtained from the system, including the unused tail of each block.
+    [[nodiscard]] size_t bytes_reserved() const { return reserved; }
+
+private:
+    size_t block_size;
+    char* ptr{nullptr};        // next free byte of the current block
+    size_t remaining{0};       // free bytes left in the current block
+    size_t used{0};
+    size_t reserved{0};
+    std::vector<std::unique_ptr<char[]>> blocks;
+
+    char* allocate_fallback(size_t bytes);
+    char* new_block(size_t bytes);
+};
@@ -0,0 +1,53 @@
+#ifndef KVDATABASE_ARENA_UNIT_TESTS_H
+#define KVDATABASE_ARENA_UNIT_TESTS_H
+
+#include "arena.h"
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+void test_arena_bump_and_copy() {
+    Arena arena(1024);
+    std::vector<std::string_view> views;
+    for (int i = 0; i < 500; ++i) views.push_back(arena.copy("value" + std::to_string(i)));
+    for (int i = 0; i < 500; ++i) assert(views[i] == "value" + std::to_string(i));   // earlier blocks stay put
+
+    size_t expected = 0;
+    for (int i = 0; i < 500; ++i) expected += ("value" + std::to_string(i)).size();
+    assert(arena.bytes_used() == expected);
+    assert(arena.bytes_reserved() >= expected);
+    assert(arena.bytes_reserved() < expected + 2 * 1024);
+    assert(arena.copy("").empty());
+}
+
+void test_arena_alignment_and_large() {
+    Arena arena(1024);
+    arena.allocate(3);
+    struct Node { uint64_t a; double b; };
+    Node* n = arena.make<Node>(Node{7, 1.5});
+    assert(reinterpret_cast<uintptr_t>(n) % alignof(Node) == 0);
+    assert(n->a == 7 && n->b == 1.5);
+
+    size_t reserved = arena.bytes_reserved();
+    char* big = arena.allocate(10000);   // dedicated block
+    big[9999] = 'x';
+    assert(arena.bytes_reserved() == reserved + 10000);
+    char* small = arena.allocate(8);     // still served from the current block
+    assert(arena.bytes_reserved() == reserved + 10000);
+    (void)small;
+
+    Arena moved(std::move(arena));
+    assert(moved.bytes_used() >= 10000 + 3 + sizeof(Node));
+    assert(arena.bytes_used() == 0 && arena.bytes_reserved() == 0);
+    assert(big[9999] == 'x');
+}
+
+void run_arena_tests() {
+    test_arena_bump_and_copy();
+    test_arena_alignment_and_large();
+    std::cout << "✅ All Arena tests passed!" << std::endl;
+}
+
+#endif
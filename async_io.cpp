@@ -0,0 +1,341 @@
+#include "async_io.h"
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <chrono>
+
+struct AsyncReader::Request {
+    int file;
+    uint64_t offset;
+    std::string buf;
+    size_t done{0};     // bytes read so far
+    iovec iov{};        // remainder still to read (io_uring)
+    Callback cb;
+};
+
+// Mapped SQ/CQ rings of an io_uring instance.
+struct AsyncReader::Ring {
+    int fd{-1};
+    void* sq_map{nullptr};
+    size_t sq_map_size{0};
+    void* cq_map{nullptr};
+    size_t cq_map_size{0};
+    io_uring_sqe* sqes{nullptr};
+    size_t sqes_size{0};
+
+    unsigned* sq_head{nullptr};
+    unsigned* sq_tail{nullptr};
+    unsigned* sq_mask{nullptr};
+    unsigned* sq_array{nullptr};
+    unsigned* cq_head{nullptr};
+    unsigned* cq_tail{nullptr};
+    unsigned* cq_mask{nullptr};
+    io_uring_cqe* cqes{nullptr};
+
+    ~Ring() {
+        if (sqes) ::munmap(sqes, sqes_size);
+        if (cq_map && cq_map != sq_map) ::munmap(cq_map, cq_map_size);
+        if (sq_map) ::munmap(sq_map, sq_map_size);
+        if (fd >= 0) ::close(fd);
+    }
+};
+
+static int sys_io_uring_setup(unsigned entries, io_uring_params* p) {
+    return (int)::syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return (int)::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return (int)::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+// user_data of the NOP that tells the reaper to exit
+static constexpr uint64_t kStopTag = 0;
+
+AsyncReader::AsyncReader(AsyncReaderOptions options_) : options(options_) {
+    if (options.queue_depth == 0) throw std::invalid_argument("queue_depth must be positive");
+    if (options.backend != AsyncIoBackend::ThreadPool && setup_ring()) {
+        active = AsyncIoBackend::IoUring;
+        reaper = std::thread([this] { reap_loop(); });
+        return;
+    }
+    if (options.backend == AsyncIoBackend::IoUring) throw std::runtime_error("io_uring unavailable");
+    active = AsyncIoBackend::ThreadPool;
+    for (unsigned i = 0; i < std::max(options.threads, 1u); ++i) workers.emplace_back([this] { worker_loop(); });
+}
+
+AsyncReader::~AsyncReader() {
+    drain();
+    if (active == AsyncIoBackend::IoUring) {
+        // nothing else is in flight, so only the NOP can be stranded; the
+        // reaper cannot be woken without it, so keep trying
+        for (;;) {
+            std::vector<Request*> stranded;
+            std::lock_guard<std::mutex> lock(submit_mu);
+            unsigned tail = *ring->sq_tail;
+            unsigned idx = tail & *ring->sq_mask;
+            io_uring_sqe* sqe = &ring->sqes[idx];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_NOP;
+            sqe->user_data = kStopTag;
+            ring->sq_array[idx] = idx;
+            __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+            if (enter_locked(stranded) == 0) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        reaper.join();
+    } else {
+        {
+            std::lock_guard<std::mutex> lock(mu);
+            stopping = true;
+        }
+        queue_cv.notify_all();
+        for (auto& w : workers) w.join();
+    }
+}
+
+// AsyncReader::setup_ring()
+// --------------------------------------------------------------------
+// io_uring_setup, then map the SQ ring, the CQ ring (one mapping on kernels
+// with IORING_FEAT_SINGLE_MMAP) and the SQE array. Also reserves max_files
+// sparse fixed-file slots. Returns false if the kernel refuses io_uring
+// (too old, disabled by sysctl or seccomp).
+bool AsyncReader::setup_ring() {
+    io_uring_params p{};
+    int fd = sys_io_uring_setup(options.queue_depth, &p);
+    if (fd < 0) return false;
+    auto r = std::make_unique<Ring>();
+    r->fd = fd;
+
+    r->sq_map_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_map_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single) r->sq_map_size = r->cq_map_size = std::max(r->sq_map_size, r->cq_map_size);
+
+    r->sq_map = ::mmap(nullptr, r->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (r->sq_map == MAP_FAILED) { r->sq_map = nullptr; return false; }
+    if (single) {
+        r->cq_map = r->sq_map;
+    } else {
+        r->cq_map = ::mmap(nullptr, r->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (r->cq_map == MAP_FAILED) { r->cq_map = nullptr; return false; }
+    }
+    r->sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = ::mmap(nullptr, r->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) return false;
+    r->sqes = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(r->sq_map);
+    char* cq = static_cast<char*>(r->cq_map);
+    r->sq_head = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    r->sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    r->sq_mask = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    r->sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    r->cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+    r->cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+    r->cq_mask = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+    r->cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+    // never more reads in flight than SQ entries, so the rings cannot overflow
+    options.queue_depth = std::min(options.queue_depth, p.sq_entries);
+
+    if (options.max_files > 0) {
+        std::vector<int> sparse(options.max_files, -1);
+        if (sys_io_uring_register(fd, IORING_REGISTER_FILES, sparse.data(), options.max_files) < 0)
+            options.max_files = 0;   // no fixed files: reads pass plain fds
+    }
+    ring = std::move(r);
+    return true;
+}
+
+int AsyncReader::register_file(int fd) {
+    std::lock_guard<std::mutex> lock(mu);
+    size_t h = 0;
+    while (h < fds.size() && fds[h] >= 0) ++h;
+    if (h == fds.size()) {
+        fds.push_back(-1);
+        fixed.push_back(false);
+    }
+    fds[h] = fd;
+    fixed[h] = false;
+    if (ring && h < options.max_files) {
+        io_uring_files_update up{};
+        up.offset = (unsigned)h;
+        up.fds = (uint64_t)(uintptr_t)&fds[h];
+        fixed[h] = sys_io_uring_register(ring->fd, IORING_REGISTER_FILES_UPDATE, &up, 1) == 1;
+    }
+    return (int)h;
+}
+
+void AsyncReader::unregister_file(int file) {
+    std::lock_guard<std::mutex> lock(mu);
+    if (file < 0 || (size_t)file >= fds.size()) return;
+    if (fixed[file]) {
+        int none = -1;
+        io_uring_files_update up{};
+        up.offset = (unsigned)file;
+        up.fds = (uint64_t)(uintptr_t)&none;
+        sys_io_uring_register(ring->fd, IORING_REGISTER_FILES_UPDATE, &up, 1);
+        fixed[file] = false;
+    }
+    fds[file] = -1;
+}
+
+void AsyncReader::read(int file, uint64_t offset, size_t len, Callback done) {
+    auto* req = new Request{file, offset, std::string(len, '\0'), 0, {}, std::move(done)};
+    {
+        std::unique_lock<std::mutex> lock(mu);
+        slot_cv.wait(lock, [&] { return in_flight < options.queue_depth; });
+        ++in_flight;
+        if (active == AsyncIoBackend::ThreadPool) {
+            queue.push_back(req);
+            queue_cv.notify_one();
+            return;
+        }
+    }
+    if (len == 0) return complete(req, 0);
+    submit(req);
+}
+
+void AsyncReader::drain() {
+    std::unique_lock<std::mutex> lock(mu);
+    slot_cv.wait(lock, [&] { return in_flight == 0; });
+}
+
+void AsyncReader::complete(Request* req, int error) {
+    req->buf.resize(req->done);
+    req->cb(std::move(req->buf), error);
+    delete req;
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        --in_flight;
+    }
+    slot_cv.notify_all();
+}
+
+// Queue one READV for the part of 'req' not read yet and enter the kernel.
+void AsyncReader::submit(Request* req) {
+    int fd;
+    bool is_fixed;
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        fd = fds[req->file];
+        is_fixed = fixed[req->file];
+    }
+    req->iov.iov_base = req->buf.data() + req->done;
+    req->iov.iov_len = req->buf.size() - req->done;
+
+    std::vector<Request*> stranded;
+    int error;
+    {
+        std::lock_guard<std::mutex> lock(submit_mu);
+        unsigned tail = *ring->sq_tail;
+        unsigned idx = tail & *ring->sq_mask;
+        io_uring_sqe* sqe = &ring->sqes[idx];
+        std::memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READV;
+        sqe->fd = is_fixed ? req->file : fd;
+        sqe->flags = is_fixed ? IOSQE_FIXED_FILE : 0;
+        sqe->addr = (uint64_t)(uintptr_t)&req->iov;
+        sqe->len = 1;
+        sqe->off = req->offset + req->done;
+        sqe->user_data = (uint64_t)(uintptr_t)req;
+        ring->sq_array[idx] = idx;
+        __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+        error = enter_locked(stranded);
+    }
+    for (Request* r : stranded) complete(r, error);
+}
+
+// Hand the kernel every SQE it has not consumed yet, going again after a
+// partial submit until the SQ is empty; returns 0. On a hard error nothing
+// would ever submit what is left (the reaper only waits), so those entries
+// are taken back off the ring, their requests added to 'stranded' for the
+// caller to fail with the returned errno, and a stop NOP among them dropped.
+int AsyncReader::enter_locked(std::vector<Request*>& stranded) {
+    for (;;) {
+        unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+        unsigned tail = *ring->sq_tail;
+        if (head == tail) return 0;
+        if (sys_io_uring_enter(ring->fd, tail - head, 0, 0) >= 0) continue;
+        int error = errno;
+        if (error == EINTR || error == EAGAIN || error == EBUSY) continue;
+        // without SQPOLL the kernel only consumes SQEs inside io_uring_enter,
+        // so the tail can be wound back to the head
+        for (unsigned i = head; i != tail; ++i) {
+            uint64_t tag = ring->sqes[ring->sq_array[i & *ring->sq_mask]].user_data;
+            if (tag != kStopTag) stranded.push_back(reinterpret_cast<Request*>((uintptr_t)tag));
+        }
+        __atomic_store_n(ring->sq_tail, head, __ATOMIC_RELEASE);
+        return error;
+    }
+}
+
+// AsyncReader::reap_loop()
+// --------------------------------------------------------------------
+// Completion thread: sleep in io_uring_enter until CQEs arrive, take every
+// available one in a batch, then resubmit short reads and complete the rest.
+// The batch is taken under submit_mu, which also orders each submitter's
+// writes to its request before the reads here.
+void AsyncReader::reap_loop() {
+    std::vector<io_uring_cqe> batch;
+    for (;;) {
+        batch.clear();
+        {
+            std::lock_guard<std::mutex> lock(submit_mu);
+            unsigned head = *ring->cq_head;
+            unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+            for (; head != tail; ++head) batch.push_back(ring->cqes[head & *ring->cq_mask]);
+            __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+        }
+        if (batch.empty()) {
+            sys_io_uring_enter(ring->fd, 0, 1, IORING_ENTER_GETEVENTS);
+            continue;
+        }
+
+        for (const io_uring_cqe& cqe : batch) {
+            if (cqe.user_data == kStopTag) return;
+            auto* req = reinterpret_cast<Request*>((uintptr_t)cqe.user_data);
+            if (cqe.res < 0) {
+                complete(req, -cqe.res);
+                continue;
+            }
+            req->done += (size_t)cqe.res;
+            if (cqe.res == 0 || req->done == req->buf.size()) complete(req, 0);
+            else submit(req);   // short read: ask for the rest
+        }
+    }
+}
+
+void AsyncReader::worker_loop() {
+    for (;;) {
+        Request* req;
+        int fd;
+        {
+            std::unique_lock<std::mutex> lock(mu);
+            queue_cv.wait(lock, [&] { return stopping || !queue.empty(); });
+            if (queue.empty()) return;
+            req = queue.front();
+            queue.pop_front();
+            fd = fds[req->file];
+        }
+        int error = 0;
+        while (req->done < req->buf.size()) {
+            ssize_t n = ::pread(fd, req->buf.data() + req->done, req->buf.size() - req->done,
+                                (off_t)(req->offset + req->done));
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) { error = errno; break; }
+            if (n == 0) break;
+            req->done += (size_t)n;
+        }
+        complete(req, error);
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+
+// Which engine AsyncReader drives its reads with.
+enum class AsyncIoBackend {
+    Auto,         // io_uring if the kernel allows it, otherwise ThreadPool
+    IoUring,      // io_uring through raw syscalls; the constructor throws if unavailable
+    ThreadPool,   // worker threads issuing blocking preads
+};
+
+struct AsyncReaderOptions {
+    AsyncIoBackend backend = AsyncIoBackend::Auto;
+    unsigned queue_depth = 64;   // reads in flight at once; read() waits for a free slot beyond that
+    unsigned max_files = 256;    // io_uring registered-file slots (0: pass plain fds)
+    unsigned threads = 4;        // ThreadPool workers
+};
+
+// AsyncReader: asynchronous positional reads
+// ----------------------------------------
+// read() queues a read of [offset, offset + len) of a registered file and
+// returns at once; the callback runs later on the reader's completion
+// thread (io_uring) or on a worker (ThreadPool), so it should be short and
+// must not call read(), drain() or the destructor of the same reader (the
+// thread running it is the one that frees queue slots).
+//
+// io_uring backend: one ring of queue_depth entries set up with the raw
+// io_uring_setup/io_uring_enter syscalls (no liburing needed). Files are
+// registered as fixed files when the kernel allows it, which saves a file
+// table lookup per read. A short read is resubmitted for the rest.
+//
+// Thread-safe: any number of threads may call read() at the same time.
+class AsyncReader {
+public:
+    // Bytes read (shorter than asked only at end of file), or error != 0 (an errno).
+    using Callback = std::function<void(std::string data, int error)>;
+
+    explicit AsyncReader(AsyncReaderOptions options = {});
+
+    // Waits for every read in flight and runs its callback.
+    ~AsyncReader();
+
+    AsyncReader(const AsyncReader&) = delete;
+    AsyncReader& operator=(const AsyncReader&) = delete;
+
+    // Returns the handle to pass to read(). The fd must stay open until unregister_file().
+    int register_file(int fd);
+
+    // No reads of the file may be in flight.
+    void unregister_file(int file);
+
+    void read(int file, uint64_t offset, size_t len, Callback done);
+
+    // Block until every read submitted so far has completed.
+    void drain();
+
+    [[nodiscard]] AsyncIoBackend backend() const { return active; }
+    [[nodiscard]] unsigned queue_depth() const { return options.queue_depth; }
+
+private:
+    struct Request;
+    struct Ring;
+
+    AsyncReaderOptions options;
+    AsyncIoBackend active{AsyncIoBackend::ThreadPool};
+
+    std::mutex mu;
+    std::condition_variable slot_cv;   // a read completed (in_flight went down)
+    unsigned in_flight{0};
+    std::vector<int> fds;              // file handle -> fd, -1 for a free handle
+    std::vector<bool> fixed;           // handle is registered with the ring
+
+    // io_uring
+    std::unique_ptr<Ring> ring;
+    std::mutex submit_mu;              // one submitter at a time fills the SQ ring
+    std::thread reaper;
+
+    // ThreadPool
+    std::deque<Request*> queue;
+    std::condition_variable queue_cv;
+    bool stopping{false};
+    std::vector<std::thread> workers;
+
+    bool setup_ring();
+    void submit(Request* req);
+    // Caller holds submit_mu; completes what it returns in 'stranded' after releasing it.
+    int enter_locked(std::vector<Request*>& stranded);
+    void reap_loop();
+    void worker_loop();
+
+    // Run the callback and release the request's queue slot.
+    void complete(Request* req, int error);
+};
@@ -4,6 +4,7 @@
 //
 
 #include <algorithm>
+#include <stdexcept>
 #include "avl_tree.h"
 using namespace std;
 
@@ -44,27 +45,45 @@ AVLNode* AVLTree::leftRotate(AVLNode* x) {
     return y;
 }
 
-pair<AVLNode*, bool> AVLTree::insert(AVLNode* node, const string& key, const string& value) {
+AVLTree::AVLTree(AVLTree&& other) noexcept
+    : arena(std::move(other.arena))
+    , root(std::exchange(other.root, nullptr))
+    , size(std::exchange(other.size, 0))
+    , max_size(other.max_size)
+    , max_bytes(other.max_bytes) {}
+
+AVLTree& AVLTree::operator=(AVLTree&& other) noexcept {
+    if (this != &other) {
+        arena = std::move(other.arena);
+        root = std::exchange(other.root, nullptr);
+        size = std::exchange(other.size, 0);
+        max_size = other.max_size;
+        max_bytes = other.max_bytes;
+    }
+    return *this;
+}
+
+pair<AVLNode*, bool> AVLTree::insert(Arena& arena, AVLNode* node, const string& key, const string& value, bool deleted) {
     if (node == nullptr) {
-        // didn't put this inside the initialization of the pair because linter detects this as a memory leak
-        auto new_leaf = new AVLNode(key, value);
+        auto new_leaf = arena.make<AVLNode>(arena.copy(key), arena.copy(value), deleted);
         return {new_leaf, true};
     }
 
     bool insertion_outcome;
     if (key < node->key) {
-        auto res = insert(node->left, key, value);
+        auto res = insert(arena, node->left, key, value, deleted);
         node->left = res.first;
         insertion_outcome = res.second;
     }
     else if (key > node->key) {
-        auto res = insert(node->right, key, value);
+        auto res = insert(arena, node->right, key, value, deleted);
         node->right = res.first;
         insertion_outcome = res.second;
     }
     else {
-        // overwrite key value pair with new value
-        node->value = value;
+        // overwrite key value pair with new value (the old bytes stay in the arena)
+        node->value = arena.copy(value);
+        node->deleted = deleted;
         return {node, false};
     }
 
@@ -94,7 +113,7 @@ AVLNode* AVLTree::minValueNode(AVLNode* node) {
     return current;
 }
 
-pair<AVLNode*, bool> AVLTree::deleteNode(AVLNode* root, const string& key) {
+pair<AVLNode*, bool> AVLTree::deleteNode(AVLNode* root, string_view key) {
     if (root == nullptr) return {nullptr, false};
 
     bool deletion_outcome;
@@ -120,11 +139,12 @@ pair<AVLNode*, bool> AVLTree::deleteNode(AVLNode* root, const string& key) {
             else
                 *root = *temp;
                 deletion_outcome = true;
-            delete temp;
+            // the unlinked node's memory is reclaimed with the arena
         } else {
             const AVLNode* temp = minValueNode(root->right);
             root->key = temp->key;
             root->value = temp->value;
+            root->deleted = temp->deleted;
             deletion_outcome = true;
             // root deleted, now remove copy from right node
             auto res = deleteNode(root->right, temp->key);
@@ -155,25 +175,31 @@ pair<AVLNode*, bool> AVLTree::deleteNode(AVLNode* root, const string& key) {
     return {root, deletion_outcome};
 }
 
-string AVLTree::inorder(AVLNode* root) {
-    if (root != nullptr) {
-        const string left = inorder(root->left);
-        const string right = inorder(root->right);
-        return left + " (" + root->key + ", " + root->value + ") " + right;
-    }
-    return "";
+void AVLTree::collect(const AVLNode* root, vector<KVRecord>& out) {
+    if (root == nullptr) return;
+    collect(root->left, out);
+    if (root->deleted) out.emplace_back(string(root->key), nullopt);
+    else out.emplace_back(string(root->key), string(root->value));
+    collect(root->right, out);
 }
 
-bool AVLTree::search(const AVLNode* root, const string& key) {
-    if (root == nullptr) return false;
-    if (root->key == key) return true;
-    if (key < root->key) return search(root->left, key);
-    return search(root->right, key);
+void AVLTree::for_each(const AVLNode* root, const function<void(const AVLNode&)>& visit) {
+    if (root == nullptr) return;
+    for_each(root->left, visit);
+    visit(*root);
+    for_each(root->right, visit);
 }
 
-bool AVLTree::insert(const string& key,const string& value) {
-    if (size == max_size) return false;
-    auto res = insert(root, key, value);
+const AVLNode* AVLTree::find(const AVLNode* root, const string& key) {
+    if (root == nullptr) return nullptr;
+    if (root->key == key) return root;
+    if (key < root->key) return find(root->left, key);
+    return find(root->right, key);
+}
+
+bool AVLTree::insert_entry(const string& key, const string& value, bool deleted) {
+    if (is_full()) return false;
+    auto res = insert(arena, root, key, value, deleted);
     root = res.first;
     if (res.second == true) {
         size++;
@@ -181,6 +207,14 @@ bool AVLTree::insert(const string& key,const string& value) {
     return true;
 }
 
+bool AVLTree::insert(const string& key,const string& value) {
+    return insert_entry(key, value, false);
+}
+
+bool AVLTree::insert_tombstone(const string& key) {
+    return insert_entry(key, "", true);
+}
+
 void AVLTree::remove(const string& key) {
     auto res = deleteNode(root, key);
     root = res.first;
@@ -188,13 +222,119 @@ void AVLTree::remove(const string& key) {
 }
 
 bool AVLTree::search(const string& key) const {
-    return search(root, key);
+    const AVLNode* node = find(root, key);
+    return node != nullptr && !node->deleted;
+}
+
+LookupResult AVLTree::get(const string& key, string& value_out) const {
+    const AVLNode* node = find(root, key);
+    if (node == nullptr) return LookupResult::NotFound;
+    if (node->deleted) return LookupResult::Deleted;
+    value_out.assign(node->value);
+    return LookupResult::Found;
+}
+
+void AVLTree::collect(vector<KVRecord>& out) const {
+    out.reserve(out.size() + size);
+    collect(root, out);
 }
 
 string AVLTree::inorder() const {
-    return inorder(root);
+    string out;
+    Iterator it(*this);
+    for (it.seek_to_first(); it.valid(); it.next()) {
+        out += " (";
+        out.append(it.key());
+        out += ", ";
+        out.append(it.value());
+        out += ") ";
+    }
+    return out;
 }
 
 int AVLTree::get_size() const {
     return size;
 }
+
+int AVLTree::get_height() const {
+    return height(root);
+}
+
+// Subtree of sorted[lo, hi). The halves differ by at most one node, so
+// their heights differ by at most one and every node is AVL-balanced.
+AVLNode* AVLTree::build_balanced(Arena& arena, const vector<KVRecord>& sorted, size_t lo, size_t hi) {
+    if (lo >= hi) return nullptr;
+    size_t mid = lo + (hi - lo) / 2;
+    const KVRecord& r = sorted[mid];
+    AVLNode* node = arena.make<AVLNode>(arena.copy(r.first), r.second ? arena.copy(*r.second) : string_view(),
+                                        !r.second.has_value());
+    node->left = build_balanced(arena, sorted, lo, mid);
+    node->right = build_balanced(arena, sorted, mid + 1, hi);
+    node->height = 1 + max(height(node->left), height(node->right));
+    return node;
+}
+
+AVLTree AVLTree::from_sorted(const vector<KVRecord>& sorted, int max, size_t max_bytes) {
+    for (size_t i = 1; i < sorted.size(); ++i)
+        if (!(sorted[i - 1].first < sorted[i].first))
+            throw std::invalid_argument("AVLTree::from_sorted keys must be strictly increasing");
+    AVLTree tree(max, max_bytes);
+    tree.root = build_balanced(tree.arena, sorted, 0, sorted.size());
+    tree.size = (int)sorted.size();
+    return tree;
+}
+
+void AVLTree::for_each(const function<void(const AVLNode&)>& visit) const {
+    for_each(root, visit);
+}
+
+void AVLTree::scan(const string& start, const string& end,
+                   const function<void(const string&, const string&)>& visit) const {
+    // one key and one value buffer, reused for every visited entry
+    string k, v;
+    Iterator it(*this);
+    for (it.seek(start); it.valid() && it.key() <= end; it.next()) {
+        if (it.deleted()) continue;
+        k.assign(it.key());
+        v.assign(it.value());
+        visit(k, v);
+    }
+}
+
+void AVLTree::Iterator::push_left(const AVLNode* node) {
+    for (; node != nullptr; node = node->left) path.push_back(node);
+}
+
+void AVLTree::Iterator::seek_to_first() {
+    path.clear();
+    push_left(root);
+}
+
+void AVLTree::Iterator::seek(string_view target) {
+    path.clear();
+    // Keep only the nodes >= target on the stack: they are exactly the
+    // ancestors an in-order walk from the answer would still return to.
+    const AVLNode* node = root;
+    while (node != nullptr) {
+        if (node->key >= target) {
+            path.push_back(node);
+            node = node->left;
+        } else {
+            node = node->right;
+        }
+    }
+}
+
+void AVLTree::Iterator::next() {
+    const AVLNode* cur = path.back();
+    path.pop_back();
+    push_left(cur->right);
+}
+
+size_t AVLTree::memory_usage() const {
+    return arena.bytes_used();
+}
+
+bool AVLTree::is_full() const {
+    return size >= max_size || arena.bytes_used() >= max_bytes;
+}
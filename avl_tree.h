@@ -7,32 +7,43 @@
 #define KVDATABASE_AVL_TREE_H
 
 #include <string>
+#include <string_view>
 #include <algorithm>
 #include <utility>
 #include <limits>
+#include <vector>
+#include <functional>
+#include "record.h"
+#include "arena.h"
+#include "iterator.h"
 
 using namespace std;
 
+// Nodes live in the tree's Arena; key and value point at bytes in the same arena.
 class AVLNode {
 public:
-    string key;
-    string value;
+    string_view key;
+    string_view value;
     AVLNode* left;
     AVLNode* right;
     int height;
+    bool deleted;  // tombstone: key was removed, value is empty
 
-    AVLNode(string k, string v)
-        : key(std::move(k))
-        , value(std::move(v))
+    AVLNode(string_view k, string_view v, bool is_deleted = false)
+        : key(k)
+        , value(v)
         , left(nullptr)
         , right(nullptr)
-        , height(1) {}
+        , height(1)
+        , deleted(is_deleted) {}
 };
 
 class AVLTree {
+    Arena arena;       // owns every node and all key/value bytes
     AVLNode* root;
     int size;
     int max_size;
+    size_t max_bytes;  // limit on arena.bytes_used()
     static int height(const AVLNode* node);
     static int balanceFactor(const AVLNode* node);
 
@@ -40,29 +51,106 @@ class AVLTree {
 
     static AVLNode* leftRotate(AVLNode* x);
 
-    static pair<AVLNode*, bool> insert(AVLNode* node, const string& key, const string& value);
+    static pair<AVLNode*, bool> insert(Arena& arena, AVLNode* node, const string& key, const string& value, bool deleted);
     static AVLNode* minValueNode(AVLNode* node);
 
-    static pair<AVLNode*, bool> deleteNode(AVLNode* node, const string& key);
+    static pair<AVLNode*, bool> deleteNode(AVLNode* node, string_view key);
 
-    static bool search(const AVLNode *root, const string& key);
+    static const AVLNode* find(const AVLNode* root, const string& key);
 
-    static string inorder(AVLNode* root);
+    static void collect(const AVLNode* root, vector<KVRecord>& out);
+
+    static void for_each(const AVLNode* root, const function<void(const AVLNode&)>& visit);
+
+    static AVLNode* build_balanced(Arena& arena, const vector<KVRecord>& sorted, size_t lo, size_t hi);
+
+    bool insert_entry(const string& key, const string& value, bool deleted);
 public:
     AVLTree()
         : root(nullptr)
         , size(0)
-        , max_size(numeric_limits<int>::max()) {}
+        , max_size(numeric_limits<int>::max())
+        , max_bytes(numeric_limits<size_t>::max()) {}
     explicit AVLTree(const int max)
         : root(nullptr)
         , size(0)
-        , max_size(max){}
-    // ~AVLTree();
+        , max_size(max)
+        , max_bytes(numeric_limits<size_t>::max()) {}
+    // Full once either max entries or max_bytes of arena memory is reached.
+    AVLTree(const int max, const size_t max_bytes_)
+        : root(nullptr)
+        , size(0)
+        , max_size(max)
+        , max_bytes(max_bytes_) {}
+    // Nodes and bytes are released all at once with the arena.
+    ~AVLTree() = default;
+    AVLTree(AVLTree&& other) noexcept;
+    AVLTree& operator=(AVLTree&& other) noexcept;
+    AVLTree(const AVLTree&) = delete;
+    AVLTree& operator=(const AVLTree&) = delete;
+    // Build a tree from records sorted by strictly increasing key in O(n):
+    // the middle record becomes the root and each half, recursively, a
+    // subtree, so no comparison or rotation is done and the result is as
+    // balanced as possible. Throws std::invalid_argument on unsorted input.
+    static AVLTree from_sorted(const vector<KVRecord>& sorted,
+                               int max = numeric_limits<int>::max(),
+                               size_t max_bytes = numeric_limits<size_t>::max());
     bool insert(const string& key, const string& value);
+    // Record a deletion marker for key instead of physically removing it, so the
+    // deletion shadows older copies of the key once flushed to an SSTable.
+    // Like insert(), returns false when the tree is full.
+    bool insert_tombstone(const string& key);
     void remove(const string& key);
     [[nodiscard]] bool search(const string& key) const;
+    // Look the key up, copying the value out when it is live.
+    [[nodiscard]] LookupResult get(const string& key, string& value_out) const;
     [[nodiscard]] string inorder() const;
+    // Append every entry (tombstones included) in ascending key order.
+    void collect(vector<KVRecord>& out) const;
+    // Visit every node (tombstones included) in ascending key order, without copying.
+    void for_each(const function<void(const AVLNode&)>& visit) const;
+    // Visit live key-value pairs with start <= key <= end in ascending key order
+    // (same contract as SSTable::scan).
+    void scan(const string& start, const string& end,
+              const function<void(const string&, const string&)>& visit) const;
+
+    // Iterator: forward walk in key order, tombstones included, driven by an
+    // explicit stack of the ancestors still to visit (at most the tree height).
+    // key() and value() point into the tree's arena. Any insert or remove
+    // invalidates the iterator.
+    class Iterator : public ::Iterator {
+    public:
+        explicit Iterator(const AVLTree& tree) : root(tree.root) {}
+
+        void seek_to_first() override;
+        // Position at the first key >= 'target'.
+        void seek(string_view target) override;
+        void next() override;
+
+        [[nodiscard]] bool valid() const override { return !path.empty(); }
+        [[nodiscard]] string_view key() const override { return path.back()->key; }
+        [[nodiscard]] string_view value() const override { return path.back()->value; }
+        [[nodiscard]] bool deleted() const override { return path.back()->deleted; }
+
+    private:
+        const AVLNode* root;
+        // Top is the current node; below it are the ancestors still to visit,
+        // keys growing towards the bottom of the stack.
+        vector<const AVLNode*> path;
+
+        void push_left(const AVLNode* node);
+    };
+
+    // Unpositioned iterator; call seek_to_first() or seek() first.
+    [[nodiscard]] Iterator iterator() const { return Iterator(*this); }
     [[nodiscard]] int get_size() const;
+    // Levels of nodes on the longest root-to-leaf path (0 when empty).
+    [[nodiscard]] int get_height() const;
+    // Arena bytes taken by nodes, keys and values (overwritten and removed
+    // entries included until the tree is discarded).
+    [[nodiscard]] size_t memory_usage() const;
+    // True once insert() would be refused because max_size or max_bytes is reached.
+    [[nodiscard]] bool is_full() const;
 };
 
 #endif //KVDATABASE_AVL_TREE_H
@@ -3,6 +3,7 @@
 
 #include "avl_tree.h"
 #include <cassert>
+#include <stdexcept>
 #include <iostream>
 
 void test_insert_and_inorder() {
@@ -126,6 +127,93 @@ void test_insert_overwrite() {
     assert(inorder == " (key1, value2) ");
 }
 
+void test_max_bytes() {
+    AVLTree tree(numeric_limits<int>::max(), 256);
+    int inserted = 0;
+    while (tree.insert("key" + to_string(inserted), string(20, 'v'))) inserted++;
+    assert(tree.is_full());
+    assert(inserted > 3 && inserted < 10);
+    assert(tree.memory_usage() >= 256);
+
+    // moving hands the arena over; the tree contents survive
+    AVLTree moved(std::move(tree));
+    assert(moved.search("key0") && moved.get_size() == inserted);
+    assert(tree.get_size() == 0 && tree.memory_usage() == 0);
+}
+
+void test_iterator_and_scan() {
+    AVLTree tree;
+    for (int i = 0; i < 100; i += 2) tree.insert("k" + to_string(100 + i), "v" + to_string(i));
+    tree.insert_tombstone("k120");
+
+    AVLTree::Iterator it(tree);
+    it.seek_to_first();
+    int n = 0;
+    string prev;
+    for (; it.valid(); it.next(), ++n) {
+        assert(n == 0 || string(it.key()) > prev);
+        prev = it.key();
+    }
+    assert(n == 50);
+
+    it.seek("k131");   // between keys: lands on the next one
+    assert(it.valid() && it.key() == "k132" && it.value() == "v32");
+    it.seek("k120");
+    assert(it.valid() && it.deleted());
+    it.next();
+    assert(it.key() == "k122");
+    it.seek("k999");
+    assert(!it.valid());
+
+    vector<string> keys;
+    tree.scan("k115", "k126", [&](const string& k, const string& v) {
+        assert(v == "v" + to_string(stoi(k.substr(1)) - 100));
+        keys.push_back(k);
+    });
+    // k120 is a tombstone and is skipped
+    assert((keys == vector<string>{"k116", "k118", "k122", "k124", "k126"}));
+
+    AVLTree empty;
+    AVLTree::Iterator none(empty);
+    none.seek_to_first();
+    assert(!none.valid());
+}
+
+void test_from_sorted() {
+    vector<KVRecord> sorted;
+    for (int i = 0; i < 1000; ++i) {
+        string k = "k" + to_string(1000 + i);
+        if (i % 7 == 0) sorted.emplace_back(k, nullopt);
+        else sorted.emplace_back(k, "v" + to_string(i));
+    }
+    AVLTree tree = AVLTree::from_sorted(sorted);
+    assert(tree.get_size() == 1000);
+    assert(tree.get_height() == 10);   // ceil(log2(1001)): as low as a binary tree of 1000 nodes gets
+
+    string v;
+    assert(tree.get("k1003", v) == LookupResult::Found && v == "v3");
+    assert(tree.get("k1007", v) == LookupResult::Deleted);
+    assert(tree.get("k0999", v) == LookupResult::NotFound);
+    vector<KVRecord> back;
+    tree.collect(back);
+    assert(back == sorted);
+
+    // a normal tree afterwards: inserts and removes keep it balanced
+    for (int i = 0; i < 1000; ++i) tree.insert("k" + to_string(2000 + i), "w");
+    tree.remove("k1500");
+    assert(tree.get_size() == 1999 && !tree.search("k1500") && tree.search("k2999"));
+    assert(tree.get_height() <= 16);
+
+    bool threw = false;
+    try {
+        AVLTree::from_sorted({{"b", "1"}, {"a", "2"}});
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+    assert(AVLTree::from_sorted({}).get_size() == 0);
+}
+
 void run_avl_tests() {
     test_insert_and_inorder();
     test_search();
@@ -134,6 +222,9 @@ void run_avl_tests() {
     test_delete_root();
     test_max_size();
     test_insert_overwrite();
+    test_max_bytes();
+    test_iterator_and_scan();
+    test_from_sorted();
     std::cout << "✅ All AVL tree tests passed!" << std::endl;
 }
 
@@ -0,0 +1,59 @@
+#include "block_cache.h"
+
+BlockCache::BlockCache(size_t capacity) : capacity_bytes(capacity) {}
+
+uint64_t BlockCache::register_file() {
+    std::lock_guard<std::mutex> lock(mu);
+    return next_file_id++;
+}
+
+void BlockCache::forget_file(uint64_t file_id) {
+    std::lock_guard<std::mutex> lock(mu);
+    for (auto it = lru.begin(); it != lru.end();) {
+        auto cur = it++;
+        if (cur->key.file_id == file_id) erase(cur);
+    }
+}
+
+BlockCache::Block BlockCache::lookup(uint64_t file_id, uint64_t offset) {
+    std::lock_guard<std::mutex> lock(mu);
+    auto it = table.find({file_id, offset});
+    if (it == table.end()) {
+        ++counters.misses;
+        return nullptr;
+    }
+    ++counters.hits;
+    lru.splice(lru.begin(), lru, it->second);
+    return it->second->block;
+}
+
+void BlockCache::insert(uint64_t file_id, uint64_t offset, Block block) {
+    size_t size = block->size();
+    if (size > capacity_bytes) return;
+    std::lock_guard<std::mutex> lock(mu);
+    Key key{file_id, offset};
+    if (auto it = table.find(key); it != table.end()) erase(it->second);
+    while (used + size > capacity_bytes && !lru.empty()) {
+        erase(std::prev(lru.end()));
+        ++counters.evictions;
+    }
+    lru.push_front({key, std::move(block)});
+    table.emplace(key, lru.begin());
+    used += size;
+}
+
+size_t BlockCache::charge() const {
+    std::lock_guard<std::mutex> lock(mu);
+    return used;
+}
+
+BufferPoolStats BlockCache::stats() const {
+    std::lock_guard<std::mutex> lock(mu);
+    return counters;
+}
+
+void BlockCache::erase(std::list<Entry>::iterator it) {
+    used -= it->block->size();
+    table.erase(it->key);
+    lru.erase(it);
+}
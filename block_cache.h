@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "buffer_pool.h"
+
+// BlockCache: database-wide cache of decompressed SSTable blocks
+// ----------------------------------------
+// The BufferPool caches file pages as they are on disk; for a compressed
+// table that would still cost a decompression per block read. This cache
+// holds blocks after decompression, keyed by (file id, block offset), and
+// evicts the least recently used ones once their bytes pass capacity_bytes.
+// Entries are shared_ptrs, so a reader keeps its block alive after an
+// eviction for as long as it uses it.
+//
+// File ids come from register_file(); forget_file() drops a closed file's blocks.
+class BlockCache {
+public:
+    using Block = std::shared_ptr<const std::string>;
+
+    explicit BlockCache(size_t capacity_bytes);
+
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    uint64_t register_file();
+    void forget_file(uint64_t file_id);
+
+    // The cached block, or null on a miss.
+    Block lookup(uint64_t file_id, uint64_t offset);
+
+    // Cache a block (replacing any entry under the same key), evicting as needed.
+    void insert(uint64_t file_id, uint64_t offset, Block block);
+
+    [[nodiscard]] size_t capacity() const { return capacity_bytes; }
+    [[nodiscard]] size_t charge() const;   // bytes held
+    [[nodiscard]] BufferPoolStats stats() const;
+
+private:
+    struct Key {
+        uint64_t file_id, offset;
+        bool operator==(const Key& o) const { return file_id == o.file_id && offset == o.offset; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            return std::hash<uint64_t>()(k.file_id * 0x9E3779B97F4A7C15ull ^ k.offset);
+        }
+    };
+    struct Entry {
+        Key key;
+        Block block;
+    };
+
+    size_t capacity_bytes;
+    size_t used{0};
+    std::list<Entry> lru;   // front = most recently used
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> table;
+    uint64_t next_file_id{1};
+    BufferPoolStats counters;
+    mutable std::mutex mu;
+
+    void erase(std::list<Entry>::iterator it);   // caller holds mu
+};
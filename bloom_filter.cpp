@@ -0,0 +1,84 @@
+#include "bloom_filter.h"
+#include <algorithm>
+#include <cstring>
+
+uint64_t hash_key(std::string_view key, uint64_t seed) {
+    const uint64_t m = 0xC6A4A7935BD1E995ull;
+    const int r = 47;
+    uint64_t h = seed ^ (key.size() * m);
+
+    const char* p = key.data();
+    size_t n = key.size();
+    while (n >= 8) {
+        uint64_t k;
+        std::memcpy(&k, p, sizeof(k));
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+        h ^= k;
+        h *= m;
+        p += 8;
+        n -= 8;
+    }
+    switch (n) {
+        case 7: h ^= uint64_t((uint8_t)p[6]) << 48; [[fallthrough]];
+        case 6: h ^= uint64_t((uint8_t)p[5]) << 40; [[fallthrough]];
+        case 5: h ^= uint64_t((uint8_t)p[4]) << 32; [[fallthrough]];
+        case 4: h ^= uint64_t((uint8_t)p[3]) << 24; [[fallthrough]];
+        case 3: h ^= uint64_t((uint8_t)p[2]) << 16; [[fallthrough]];
+        case 2: h ^= uint64_t((uint8_t)p[1]) << 8;  [[fallthrough]];
+        case 1: h ^= uint64_t((uint8_t)p[0]);
+                h *= m;
+    }
+    h ^= h >> r;
+    h *= m;
+    h ^= h >> r;
+    return h;
+}
+
+BloomFilterBuilder::BloomFilterBuilder(int bits_per_key_)
+    : bits_per_key(std::max(1, bits_per_key_)) {
+    // k = bits_per_key * ln(2) minimizes the false-positive rate
+    num_probes = std::clamp((int)(bits_per_key * 0.69), 1, 30);
+}
+
+void BloomFilterBuilder::add(std::string_view key) {
+    hashes.push_back(hash_key(key));
+}
+
+std::string BloomFilterBuilder::finish() const {
+    // Small filters have a high false-positive rate, so enforce a minimum size
+    uint64_t bits = std::max<uint64_t>((uint64_t)hashes.size() * bits_per_key, 64);
+    uint64_t bytes = (bits + 7) / 8;
+    bits = bytes * 8;
+
+    std::string out(bytes, '\0');
+    for (uint64_t h : hashes) {
+        uint64_t delta = (h >> 33) | (h << 31);   // second hash from rotating the first
+        for (int i = 0; i < num_probes; ++i) {
+            uint64_t bit = h % bits;
+            out[bit / 8] |= (char)(1 << (bit % 8));
+            h += delta;
+        }
+    }
+    out.push_back((char)num_probes);
+    return out;
+}
+
+BloomFilter::BloomFilter(std::string data_) : data(std::move(data_)) {}
+
+bool BloomFilter::may_contain(std::string_view key) const {
+    if (data.size() < 2) return true;
+    int num_probes = (uint8_t)data.back();
+    if (num_probes < 1 || num_probes > 30) return true;   // unknown encoding: don't filter
+    uint64_t bits = (uint64_t)(data.size() - 1) * 8;
+
+    uint64_t h = hash_key(key);
+    uint64_t delta = (h >> 33) | (h << 31);
+    for (int i = 0; i < num_probes; ++i) {
+        uint64_t bit = h % bits;
+        if ((data[bit / 8] & (1 << (bit % 8))) == 0) return false;
+        h += delta;
+    }
+    return true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+// 64-bit hash of a key (MurmurHash64A). Used by the Bloom filter; stable
+// across runs because the result is persisted inside SSTable files.
+uint64_t hash_key(std::string_view key, uint64_t seed = 0xC70F6907ull);
+
+// BloomFilterBuilder
+// ----------------------------------------
+// Collects key hashes while an SSTable is being written and produces the
+// serialized filter: [bit array][num_probes u8].
+// Probes use double hashing (h1 + i*h2), so one hash per key is enough.
+class BloomFilterBuilder {
+public:
+    explicit BloomFilterBuilder(int bits_per_key);
+
+    void add(std::string_view key);
+
+    // Serialize the filter for every key added so far.
+    [[nodiscard]] std::string finish() const;
+
+    [[nodiscard]] size_t num_keys() const { return hashes.size(); }
+
+private:
+    int bits_per_key;
+    int num_probes;
+    std::vector<uint64_t> hashes;
+};
+
+// BloomFilter: read side of a serialized filter.
+// A default-constructed (empty) filter answers "maybe" for every key, which is
+// what tables written without a filter need.
+class BloomFilter {
+public:
+    BloomFilter() = default;
+    explicit BloomFilter(std::string data);
+
+    // False means the key is definitely not in the table.
+    [[nodiscard]] bool may_contain(std::string_view key) const;
+
+    [[nodiscard]] bool empty() const { return data.empty(); }
+    [[nodiscard]] size_t size_bytes() const { return data.size(); }
+
+private:
+    std::string data;
+};
@@ -0,0 +1,280 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string_view>
+#include "arena.h"
+
+// BPlusTree: cache-conscious in-memory B+tree over arena-resident items
+// ----------------------------------------
+// An ordered index of T* items keyed by KeyOf{}(item) (a string_view that
+// must stay put while the item is in the tree, e.g. bytes in the same arena).
+// Items are only ever added, never removed.
+//
+// Nodes are kNodeBytes (four cache lines), cache-line aligned and carved out
+// of an Arena back to back. Next to every item or separator, a node keeps
+// the first 8 key bytes as a big-endian integer, in one dense array at the
+// front of the node. Finding a key's slot is a branch-free count over that
+// array - one or two cache lines, no pointer chased - and only keys whose
+// prefix ties are compared in full. A lookup therefore touches about two
+// lines per level of a tree that is ~log10(n) levels deep, instead of one
+// node per level of a binary tree.
+//
+// Leaves are chained left to right for scans. A leaf that overflows is
+// split in half, except the rightmost leaf when the new key goes at its end
+// (ascending inserts): that leaf stays full and the new leaf starts with the
+// one key, so sequential loads fill leaves completely.
+//
+// Not thread-safe. find_or_insert() allocates from the arena given to the
+// constructor; the caller serializes it with any other use of that arena.
+template <class T, class KeyOf>
+class BPlusTree {
+public:
+    static constexpr size_t kNodeBytes = 256;
+    static constexpr size_t kCacheLine = 64;
+
+private:
+    struct Node {
+        uint16_t count{0};
+        bool leaf;
+        explicit Node(bool is_leaf) : leaf(is_leaf) {}
+    };
+
+public:
+    // (8 header + 8 next) + 16 per slot
+    static constexpr size_t kLeafSlots = (kNodeBytes - 16) / 16;
+    // 8 header + 16 per separator + 8 per child (one more child than separators)
+    static constexpr size_t kInnerSlots = (kNodeBytes - 16) / 24;
+
+    struct Leaf : Node {
+        uint64_t prefix[kLeafSlots];
+        T* items[kLeafSlots];
+        Leaf* next{nullptr};
+        Leaf() : Node(true) {}
+    };
+
+    struct Inner : Node {
+        uint64_t prefix[kInnerSlots];
+        T* seps[kInnerSlots];              // seps[i]: smallest key under children[i + 1]
+        Node* children[kInnerSlots + 1];
+        Inner() : Node(false) {}
+    };
+
+    static_assert(sizeof(Leaf) <= kNodeBytes && sizeof(Inner) <= kNodeBytes);
+
+    // Position in the leaf chain; stays valid until the next insert (see version()).
+    class Cursor {
+    public:
+        Cursor() = default;
+        [[nodiscard]] bool valid() const { return leaf != nullptr; }
+        [[nodiscard]] T* item() const { return leaf->items[slot]; }
+        void next() {
+            if (++slot < leaf->count) return;
+            leaf = leaf->next;
+            slot = 0;
+        }
+
+    private:
+        friend class BPlusTree;
+        Cursor(const Leaf* l, size_t s) : leaf(l), slot(s) {
+            if (leaf && slot >= leaf->count) {
+                leaf = leaf->next;
+                slot = 0;
+            }
+        }
+        const Leaf* leaf{nullptr};
+        size_t slot{0};
+    };
+
+    explicit BPlusTree(Arena& arena_) : arena(arena_), root(new_leaf()) {}
+    BPlusTree(const BPlusTree&) = delete;
+    BPlusTree& operator=(const BPlusTree&) = delete;
+
+    // Item with exactly this key, or nullptr.
+    [[nodiscard]] T* find(std::string_view key) const {
+        uint64_t pfx = prefix_of(key);
+        const Leaf* leaf = find_leaf(key, pfx);
+        size_t i = lower_bound(leaf, key, pfx);
+        return i < leaf->count && KeyOf{}(leaf->items[i]) == key ? leaf->items[i] : nullptr;
+    }
+
+    // The item with 'key' if there is one; otherwise make() (a new T* whose
+    // key is 'key') is inserted and returned, and 'inserted' set.
+    template <class Make>
+    T* find_or_insert(std::string_view key, Make&& make, bool& inserted) {
+        inserted = false;
+        uint64_t pfx = prefix_of(key);
+        struct Step {
+            Inner* node;
+            size_t child;
+        };
+        Step path[kMaxHeight];
+        size_t depth = 0;
+        Node* n = root;
+        while (!n->leaf) {
+            auto* in = static_cast<Inner*>(n);
+            size_t c = route(in, key, pfx);
+            path[depth++] = {in, c};
+            n = in->children[c];
+        }
+        auto* leaf = static_cast<Leaf*>(n);
+        size_t pos = lower_bound(leaf, key, pfx);
+        if (pos < leaf->count && KeyOf{}(leaf->items[pos]) == key) return leaf->items[pos];
+
+        T* item = make();
+        inserted = true;
+        ++items;
+        ++version_;
+        if (leaf->count < kLeafSlots) {
+            insert_slot(leaf->prefix, leaf->items, leaf->count, pos, pfx, item);
+            ++leaf->count;
+            return item;
+        }
+
+        // split the leaf; its new right sibling's first key goes up
+        uint64_t all_prefix[kLeafSlots + 1];
+        T* all_items[kLeafSlots + 1];
+        std::copy_n(leaf->prefix, kLeafSlots, all_prefix);
+        std::copy_n(leaf->items, kLeafSlots, all_items);
+        insert_slot(all_prefix, all_items, kLeafSlots, pos, pfx, item);
+        size_t keep = (pos == kLeafSlots && leaf->next == nullptr) ? kLeafSlots : (kLeafSlots + 1) / 2;
+        Leaf* right = new_leaf();
+        leaf->count = (uint16_t)keep;
+        std::copy_n(all_prefix, keep, leaf->prefix);
+        std::copy_n(all_items, keep, leaf->items);
+        right->count = (uint16_t)(kLeafSlots + 1 - keep);
+        std::copy_n(all_prefix + keep, right->count, right->prefix);
+        std::copy_n(all_items + keep, right->count, right->items);
+        right->next = leaf->next;
+        leaf->next = right;
+
+        uint64_t sep_prefix = right->prefix[0];
+        T* sep = right->items[0];
+        Node* child = right;
+        while (depth > 0) {
+            auto [in, c] = path[--depth];
+            if (in->count < kInnerSlots) {
+                insert_slot(in->prefix, in->seps, in->count, c, sep_prefix, sep);
+                std::copy_backward(in->children + c + 1, in->children + in->count + 1, in->children + in->count + 2);
+                in->children[c + 1] = child;
+                ++in->count;
+                return item;
+            }
+            // split the inner node; the middle separator goes up
+            uint64_t p[kInnerSlots + 1];
+            T* s[kInnerSlots + 1];
+            Node* ch[kInnerSlots + 2];
+            std::copy_n(in->prefix, kInnerSlots, p);
+            std::copy_n(in->seps, kInnerSlots, s);
+            std::copy_n(in->children, kInnerSlots + 1, ch);
+            insert_slot(p, s, kInnerSlots, c, sep_prefix, sep);
+            std::copy_backward(ch + c + 1, ch + kInnerSlots + 1, ch + kInnerSlots + 2);
+            ch[c + 1] = child;
+
+            size_t mid = (kInnerSlots + 1) / 2;
+            Inner* r = new_inner();
+            in->count = (uint16_t)mid;
+            std::copy_n(p, mid, in->prefix);
+            std::copy_n(s, mid, in->seps);
+            std::copy_n(ch, mid + 1, in->children);
+            r->count = (uint16_t)(kInnerSlots - mid);
+            std::copy_n(p + mid + 1, r->count, r->prefix);
+            std::copy_n(s + mid + 1, r->count, r->seps);
+            std::copy_n(ch + mid + 1, r->count + 1, r->children);
+            sep_prefix = p[mid];
+            sep = s[mid];
+            child = r;
+        }
+        Inner* top = new_inner();
+        top->count = 1;
+        top->prefix[0] = sep_prefix;
+        top->seps[0] = sep;
+        top->children[0] = root;
+        top->children[1] = child;
+        root = top;
+        ++height_;
+        return item;
+    }
+
+    // First item with key >= 'key'.
+    [[nodiscard]] Cursor seek(std::string_view key) const {
+        uint64_t pfx = prefix_of(key);
+        const Leaf* leaf = find_leaf(key, pfx);
+        return Cursor(leaf, lower_bound(leaf, key, pfx));
+    }
+
+    [[nodiscard]] Cursor first() const {
+        const Node* n = root;
+        while (!n->leaf) n = static_cast<const Inner*>(n)->children[0];
+        return Cursor(static_cast<const Leaf*>(n), 0);
+    }
+
+    [[nodiscard]] size_t size() const { return items; }
+    [[nodiscard]] int height() const { return height_; }
+    // Bumped by every insert; a Cursor taken at the same version is still valid.
+    [[nodiscard]] uint64_t version() const { return version_; }
+
+    // Key bytes 0..7 as a big-endian integer, zero-padded: a < b implies
+    // prefix(a) <= prefix(b), and unequal prefixes order like the keys.
+    static uint64_t prefix_of(std::string_view key) {
+        uint64_t p = 0;
+        if (key.size() >= 8 && std::endian::native == std::endian::little) {
+            std::memcpy(&p, key.data(), 8);
+            return __builtin_bswap64(p);
+        }
+        size_t n = std::min<size_t>(key.size(), 8);
+        for (size_t i = 0; i < n; ++i) p |= (uint64_t)(uint8_t)key[i] << (56 - 8 * i);
+        return p;
+    }
+
+private:
+    // Enough for 2^64 items at the minimum fan-out.
+    static constexpr size_t kMaxHeight = 64;
+
+    Arena& arena;
+    Node* root;
+    size_t items{0};
+    int height_{1};
+    uint64_t version_{0};
+
+    Leaf* new_leaf() { return new (arena.allocate_aligned(kNodeBytes, kCacheLine)) Leaf(); }
+    Inner* new_inner() { return new (arena.allocate_aligned(kNodeBytes, kCacheLine)) Inner(); }
+
+    // Branch-free count of prefixes below 'pfx' (the array is sorted), then
+    // full comparisons only across the run of equal prefixes.
+    static size_t lower_bound(const Leaf* leaf, std::string_view key, uint64_t pfx) {
+        size_t i = 0;
+        for (size_t j = 0; j < leaf->count; ++j) i += leaf->prefix[j] < pfx;
+        while (i < leaf->count && leaf->prefix[i] == pfx && KeyOf{}(leaf->items[i]) < key) ++i;
+        return i;
+    }
+
+    // Child to descend into: the number of separators <= key.
+    static size_t route(const Inner* in, std::string_view key, uint64_t pfx) {
+        size_t i = 0;
+        for (size_t j = 0; j < in->count; ++j) i += in->prefix[j] < pfx;
+        while (i < in->count && in->prefix[i] == pfx && KeyOf{}(in->seps[i]) <= key) ++i;
+        return i;
+    }
+
+    const Leaf* find_leaf(std::string_view key, uint64_t pfx) const {
+        const Node* n = root;
+        while (!n->leaf) {
+            auto* in = static_cast<const Inner*>(n);
+            n = in->children[route(in, key, pfx)];
+        }
+        return static_cast<const Leaf*>(n);
+    }
+
+    // Shift slots [pos, count) right by one and store (pfx, item) at pos.
+    template <class P>
+    static void insert_slot(uint64_t* prefix, P* ptrs, size_t count, size_t pos, uint64_t pfx, P item) {
+        std::copy_backward(prefix + pos, prefix + count, prefix + count + 1);
+        std::copy_backward(ptrs + pos, ptrs + count, ptrs + count + 1);
+        prefix[pos] = pfx;
+        ptrs[pos] = item;
+    }
+};
@@ -0,0 +1,261 @@
+#include "buffer_pool.h"
+#include <unistd.h>
+#include <algorithm>
+#include <stdexcept>
+
+const char* BufferPool::PageHandle::data() const {
+    return pool->frame_data(frame);
+}
+
+size_t BufferPool::PageHandle::size() const {
+    return pool->frames[frame].valid_bytes;
+}
+
+void BufferPool::PageHandle::release() {
+    if (pool) {
+        pool->unpin(frame);
+        pool = nullptr;
+    }
+}
+
+BufferPool::BufferPool(BufferPoolOptions options_) : options(options_) {
+    if (options.page_size == 0) throw std::invalid_argument("page_size must be positive");
+    size_t n = std::max<size_t>(options.capacity_bytes / options.page_size, 1);
+    memory = std::make_unique<char[]>(n * options.page_size);
+    frames.resize(n);
+    free_frames.reserve(n);
+    for (size_t i = n; i-- > 0;) free_frames.push_back((uint32_t)i);
+    protected_cap = std::max<size_t>(1, (size_t)((double)n * options.protected_fraction));
+}
+
+uint64_t BufferPool::register_file() {
+    std::lock_guard<std::mutex> lock(mu);
+    return next_file_id++;
+}
+
+void BufferPool::forget_file(uint64_t file_id) {
+    std::lock_guard<std::mutex> lock(mu);
+    for (uint32_t f = 0; f < frames.size(); ++f) {
+        const Frame& fr = frames[f];
+        if (fr.state == FrameState::Ready && fr.file_id == file_id && fr.pin_count == 0) drop_frame(f);
+    }
+}
+
+size_t BufferPool::resident_pages() const {
+    std::lock_guard<std::mutex> lock(mu);
+    return table.size();
+}
+
+BufferPoolStats BufferPool::stats() const {
+    std::lock_guard<std::mutex> lock(mu);
+    return counters;
+}
+
+// BufferPool::fetch()
+// --------------------------------------------------------------------
+// Hit: pin, let the policy record the access, return.
+// Miss: claim a frame (evicting if needed), publish it as Loading so other
+// threads wait for it, pread outside the lock, then mark it Ready.
+BufferPool::PageHandle BufferPool::fetch(uint64_t file_id, int fd, uint64_t page_no, AccessHint hint) {
+    std::unique_lock<std::mutex> lock(mu);
+    PageKey key{file_id, page_no};
+
+    for (;;) {
+        auto it = table.find(key);
+        if (it == table.end()) break;
+        uint32_t f = it->second;
+        if (frames[f].state == FrameState::Loading) {
+            // someone else is reading this page; the read may also fail, so look again afterwards
+            loaded_cv.wait(lock);
+            continue;
+        }
+        ++frames[f].pin_count;
+        ++counters.hits;
+        on_hit(f, hint);
+        return {this, f};
+    }
+
+    ++counters.misses;
+    int32_t victim = obtain_frame();
+    if (victim < 0) throw std::runtime_error("buffer pool exhausted: every page is pinned");
+    uint32_t f = (uint32_t)victim;
+    Frame& fr = frames[f];
+    fr.file_id = file_id;
+    fr.page_no = page_no;
+    fr.pin_count = 1;
+    fr.valid_bytes = 0;
+    fr.state = FrameState::Loading;
+    table[key] = f;
+    on_insert(f, hint);
+
+    lock.unlock();
+    ssize_t n = ::pread(fd, frame_data(f), options.page_size, (off_t)(page_no * options.page_size));
+    lock.lock();
+
+    if (n < 0) {
+        fr.pin_count = 0;
+        drop_frame(f);
+        loaded_cv.notify_all();
+        throw std::runtime_error("pread page");
+    }
+    fr.valid_bytes = (uint32_t)n;
+    fr.state = FrameState::Ready;
+    loaded_cv.notify_all();
+    return {this, f};
+}
+
+void BufferPool::unpin(uint32_t f) {
+    std::lock_guard<std::mutex> lock(mu);
+    if (frames[f].pin_count > 0) --frames[f].pin_count;
+}
+
+int32_t BufferPool::obtain_frame() {
+    if (!free_frames.empty()) {
+        uint32_t f = free_frames.back();
+        free_frames.pop_back();
+        return (int32_t)f;
+    }
+    int32_t v = pick_victim();
+    if (v < 0) return -1;
+    drop_frame((uint32_t)v);
+    ++counters.evictions;
+    free_frames.pop_back();   // drop_frame() just pushed it
+    return v;
+}
+
+// Unmap a frame and return it to the free list. Caller holds mu.
+void BufferPool::drop_frame(uint32_t f) {
+    Frame& fr = frames[f];
+    table.erase(PageKey{fr.file_id, fr.page_no});
+    on_remove(f);
+    fr.state = FrameState::Free;
+    fr.pin_count = 0;
+    fr.valid_bytes = 0;
+    free_frames.push_back(f);
+}
+
+// ---- intrusive list helpers ----
+
+void BufferPool::list_push_front(FrameList& l, uint32_t f) {
+    Frame& fr = frames[f];
+    fr.prev = -1;
+    fr.next = l.head;
+    if (l.head >= 0) frames[l.head].prev = (int32_t)f;
+    l.head = (int32_t)f;
+    if (l.tail < 0) l.tail = (int32_t)f;
+    ++l.size;
+}
+
+void BufferPool::list_push_back(FrameList& l, uint32_t f) {
+    Frame& fr = frames[f];
+    fr.next = -1;
+    fr.prev = l.tail;
+    if (l.tail >= 0) frames[l.tail].next = (int32_t)f;
+    l.tail = (int32_t)f;
+    if (l.head < 0) l.head = (int32_t)f;
+    ++l.size;
+}
+
+void BufferPool::list_remove(FrameList& l, uint32_t f) {
+    Frame& fr = frames[f];
+    if (fr.prev >= 0) frames[fr.prev].next = fr.next;
+    else l.head = fr.next;
+    if (fr.next >= 0) frames[fr.next].prev = fr.prev;
+    else l.tail = fr.prev;
+    fr.prev = fr.next = -1;
+    --l.size;
+}
+
+// ---- eviction policies ----
+
+void BufferPool::on_insert(uint32_t f, AccessHint hint) {
+    Frame& fr = frames[f];
+    switch (options.policy) {
+        case EvictionPolicy::LRU:
+            // plain LRU treats scans like any other access
+            fr.segment = Segment::Probation;
+            list_push_front(recency, f);
+            break;
+        case EvictionPolicy::Clock:
+            fr.referenced = true;
+            break;
+        case EvictionPolicy::SegmentedLRU:
+            fr.segment = Segment::Probation;
+            // scan pages go to the cold end: first in line for eviction
+            if (hint == AccessHint::Scan) list_push_back(recency, f);
+            else list_push_front(recency, f);
+            break;
+    }
+}
+
+void BufferPool::on_hit(uint32_t f, AccessHint hint) {
+    Frame& fr = frames[f];
+    switch (options.policy) {
+        case EvictionPolicy::LRU:
+            list_remove(recency, f);
+            list_push_front(recency, f);
+            break;
+        case EvictionPolicy::Clock:
+            fr.referenced = true;
+            break;
+        case EvictionPolicy::SegmentedLRU:
+            if (hint == AccessHint::Scan) break;   // scans never promote or refresh
+            if (fr.segment == Segment::Probation) {
+                list_remove(recency, f);
+                fr.segment = Segment::Protected;
+                list_push_front(protected_list, f);
+                // keep the protected segment bounded: demote its coldest page
+                if (protected_list.size > protected_cap) {
+                    uint32_t d = (uint32_t)protected_list.tail;
+                    list_remove(protected_list, d);
+                    frames[d].segment = Segment::Probation;
+                    list_push_front(recency, d);
+                }
+            } else {
+                list_remove(protected_list, f);
+                list_push_front(protected_list, f);
+            }
+            break;
+    }
+}
+
+void BufferPool::on_remove(uint32_t f) {
+    Frame& fr = frames[f];
+    if (fr.segment == Segment::Probation) list_remove(recency, f);
+    else if (fr.segment == Segment::Protected) list_remove(protected_list, f);
+    fr.segment = Segment::None;
+    fr.referenced = false;
+}
+
+int32_t BufferPool::pick_victim() {
+    auto evictable = [&](uint32_t f) {
+        return frames[f].state == FrameState::Ready && frames[f].pin_count == 0;
+    };
+    auto coldest_in = [&](const FrameList& l) -> int32_t {
+        for (int32_t f = l.tail; f >= 0; f = frames[f].prev)
+            if (evictable((uint32_t)f)) return f;
+        return -1;
+    };
+
+    switch (options.policy) {
+        case EvictionPolicy::LRU:
+            return coldest_in(recency);
+        case EvictionPolicy::SegmentedLRU: {
+            int32_t v = coldest_in(recency);
+            return v >= 0 ? v : coldest_in(protected_list);
+        }
+        case EvictionPolicy::Clock: {
+            // two sweeps: the first may only clear reference bits
+            size_t n = frames.size();
+            for (size_t step = 0; step < 2 * n; ++step) {
+                uint32_t f = clock_hand;
+                clock_hand = (uint32_t)((clock_hand + 1) % n);
+                if (!evictable(f)) continue;
+                if (frames[f].referenced) { frames[f].referenced = false; continue; }
+                return (int32_t)f;
+            }
+            return -1;
+        }
+    }
+    return -1;
+}
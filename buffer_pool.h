@@ -0,0 +1,163 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_map>
+#include <vector>
+
+// Which unpinned page is evicted when the pool is full.
+enum class EvictionPolicy {
+    LRU,            // least recently used page goes first
+    Clock,          // second-chance approximation of LRU: one reference bit per frame
+    SegmentedLRU,   // scan resistant: new pages enter a probation segment and only a
+                    // second (non-scan) access promotes them to the protected segment
+};
+
+// How a page is being accessed. Scan accesses never promote a page under
+// SegmentedLRU and are inserted at the cold end, so a long range scan
+// cannot push the hot point-lookup set out of the pool.
+enum class AccessHint {
+    Point,
+    Scan,
+};
+
+struct BufferPoolOptions {
+    size_t page_size = 4096;
+    size_t capacity_bytes = 64ull << 20;   // memory cap: capacity_bytes / page_size frames
+    EvictionPolicy policy = EvictionPolicy::LRU;
+    double protected_fraction = 0.8;       // SegmentedLRU: share of frames for re-referenced pages
+};
+
+struct BufferPoolStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+
+    [[nodiscard]] double hit_rate() const {
+        return hits + misses == 0 ? 0.0 : (double)hits / (double)(hits + misses);
+    }
+};
+
+// BufferPool: database-wide cache of fixed-size file pages
+// ----------------------------------------
+// Pages are keyed by (file id, page number) and live in one contiguous
+// allocation of capacity_bytes. fetch() returns a pinned page; a pinned page
+// is never evicted, and the PageHandle unpins it when destroyed. On a miss the
+// page is read with a single pread while the pool lock is released; concurrent
+// fetches of the same page wait for that read instead of issuing their own.
+//
+// File ids come from register_file() so that a reopened or recycled file
+// never sees stale pages; forget_file() drops a closed file's pages early.
+class BufferPool {
+public:
+    class PageHandle {
+    public:
+        PageHandle() = default;
+        ~PageHandle() { release(); }
+        PageHandle(PageHandle&& o) noexcept : pool(o.pool), frame(o.frame) { o.pool = nullptr; }
+        PageHandle& operator=(PageHandle&& o) noexcept {
+            if (this != &o) { release(); pool = o.pool; frame = o.frame; o.pool = nullptr; }
+            return *this;
+        }
+        PageHandle(const PageHandle&) = delete;
+        PageHandle& operator=(const PageHandle&) = delete;
+
+        [[nodiscard]] const char* data() const;
+        [[nodiscard]] size_t size() const;      // valid bytes; short for the last page of a file
+        explicit operator bool() const { return pool != nullptr; }
+
+        void release();
+
+    private:
+        friend class BufferPool;
+        PageHandle(BufferPool* p, uint32_t f) : pool(p), frame(f) {}
+        BufferPool* pool{nullptr};
+        uint32_t frame{0};
+    };
+
+    explicit BufferPool(BufferPoolOptions options = {});
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    // Unique id for a newly opened file.
+    uint64_t register_file();
+
+    // Drop every unpinned page of a file that is being closed.
+    void forget_file(uint64_t file_id);
+
+    // Return page 'page_no' of file 'file_id' pinned, reading it from 'fd' on a miss.
+    // Throws if every frame is pinned.
+    PageHandle fetch(uint64_t file_id, int fd, uint64_t page_no, AccessHint hint = AccessHint::Point);
+
+    [[nodiscard]] size_t page_size() const { return options.page_size; }
+    [[nodiscard]] size_t capacity_pages() const { return frames.size(); }
+    [[nodiscard]] size_t resident_pages() const;
+    [[nodiscard]] BufferPoolStats stats() const;
+
+private:
+    enum class FrameState : uint8_t { Free, Loading, Ready };
+    enum class Segment : uint8_t { None, Probation, Protected };
+
+    struct Frame {
+        uint64_t file_id{0};
+        uint64_t page_no{0};
+        uint32_t pin_count{0};
+        uint32_t valid_bytes{0};
+        FrameState state{FrameState::Free};
+        Segment segment{Segment::None};
+        bool referenced{false};            // Clock
+        int32_t prev{-1}, next{-1};        // links in 'recency' or 'protected_list'
+    };
+
+    // Intrusive doubly linked list over frame indices; head = most recent.
+    struct FrameList {
+        int32_t head{-1}, tail{-1};
+        size_t size{0};
+    };
+
+    struct PageKey {
+        uint64_t file_id, page_no;
+        bool operator==(const PageKey& o) const { return file_id == o.file_id && page_no == o.page_no; }
+    };
+    struct PageKeyHash {
+        size_t operator()(const PageKey& k) const {
+            return std::hash<uint64_t>()(k.file_id * 0x9E3779B97F4A7C15ull ^ k.page_no);
+        }
+    };
+
+    BufferPoolOptions options;
+    std::unique_ptr<char[]> memory;
+    std::vector<Frame> frames;
+    std::vector<uint32_t> free_frames;
+    std::unordered_map<PageKey, uint32_t, PageKeyHash> table;
+
+    FrameList recency;          // LRU: all resident pages; SegmentedLRU: probation segment
+    FrameList protected_list;   // SegmentedLRU only
+    size_t protected_cap{0};
+    uint32_t clock_hand{0};
+
+    uint64_t next_file_id{1};
+    BufferPoolStats counters;
+    mutable std::mutex mu;
+    std::condition_variable loaded_cv;
+
+    char* frame_data(uint32_t f) const { return memory.get() + (size_t)f * options.page_size; }
+
+    void list_push_front(FrameList& l, uint32_t f);
+    void list_push_back(FrameList& l, uint32_t f);
+    void list_remove(FrameList& l, uint32_t f);
+
+    // Policy hooks. Caller holds mu.
+    void on_insert(uint32_t f, AccessHint hint);
+    void on_hit(uint32_t f, AccessHint hint);
+    void on_remove(uint32_t f);
+    int32_t pick_victim();
+
+    // A free frame, evicting if needed; -1 if everything is pinned. Caller holds mu.
+    int32_t obtain_frame();
+    void drop_frame(uint32_t f);
+    void unpin(uint32_t f);
+};
@@ -0,0 +1,213 @@
+#ifndef KVDATABASE_BUFFER_POOL_UNIT_TESTS_H
+#define KVDATABASE_BUFFER_POOL_UNIT_TESTS_H
+
+#include "buffer_pool.h"
+#include "block_cache.h"
+#include "sstable.h"
+#include "sstable_writer.h"
+#include <cassert>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <fcntl.h>
+
+// A file of 'pages' pages; every byte of page i is ('a' + i % 26).
+inline int make_paged_file(const std::string& name, size_t page_size, int pages) {
+    auto dir = std::filesystem::temp_directory_path() / "kvdb_pool_tests";
+    std::filesystem::create_directories(dir);
+    std::string path = (dir / name).string();
+    int fd = ::open(path.c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+    assert(fd >= 0);
+    for (int i = 0; i < pages; ++i) {
+        std::string page(page_size, (char)('a' + i % 26));
+        ssize_t w = ::write(fd, page.data(), page.size());
+        assert(w == (ssize_t)page.size());
+    }
+    return fd;
+}
+
+inline BufferPoolOptions small_pool(EvictionPolicy policy, size_t pages) {
+    BufferPoolOptions o;
+    o.page_size = 256;
+    o.capacity_bytes = pages * o.page_size;
+    o.policy = policy;
+    return o;
+}
+
+void test_pool_hits_and_data() {
+    BufferPool pool(small_pool(EvictionPolicy::LRU, 4));
+    int fd = make_paged_file("hits", 256, 3);
+    uint64_t id = pool.register_file();
+
+    for (int round = 0; round < 2; ++round)
+        for (int p = 0; p < 3; ++p) {
+            auto h = pool.fetch(id, fd, p);
+            assert(h.size() == 256);
+            assert(h.data()[0] == 'a' + p && h.data()[255] == 'a' + p);
+        }
+    BufferPoolStats s = pool.stats();
+    assert(s.misses == 3 && s.hits == 3 && s.evictions == 0);
+
+    // past the end of the file: an empty page, not an error
+    assert(pool.fetch(id, fd, 10).size() == 0);
+
+    pool.forget_file(id);
+    assert(pool.resident_pages() == 0);
+    ::close(fd);
+}
+
+void test_pool_lru_evicts_least_recent() {
+    BufferPool pool(small_pool(EvictionPolicy::LRU, 3));
+    int fd = make_paged_file("lru", 256, 5);
+    uint64_t id = pool.register_file();
+
+    pool.fetch(id, fd, 0);
+    pool.fetch(id, fd, 1);
+    pool.fetch(id, fd, 2);
+    pool.fetch(id, fd, 0);   // 1 is now the least recently used
+    pool.fetch(id, fd, 3);   // evicts 1
+    assert(pool.stats().evictions == 1);
+
+    uint64_t misses = pool.stats().misses;
+    pool.fetch(id, fd, 0);
+    pool.fetch(id, fd, 2);
+    pool.fetch(id, fd, 3);
+    assert(pool.stats().misses == misses);
+    pool.fetch(id, fd, 1);
+    assert(pool.stats().misses == misses + 1);
+    ::close(fd);
+}
+
+void test_pool_clock_respects_capacity() {
+    BufferPool pool(small_pool(EvictionPolicy::Clock, 4));
+    int fd = make_paged_file("clock", 256, 20);
+    uint64_t id = pool.register_file();
+
+    for (int round = 0; round < 3; ++round)
+        for (int p = 0; p < 20; ++p) {
+            auto h = pool.fetch(id, fd, p);
+            assert(h.data()[0] == 'a' + p % 26);
+            assert(pool.resident_pages() <= pool.capacity_pages());
+        }
+    assert(pool.stats().evictions == 60 - 4);
+    ::close(fd);
+}
+
+// A large scan between point lookups: segmented LRU keeps the hot pages, LRU does not.
+void test_pool_segmented_lru_resists_scans() {
+    auto hot_misses_after_scan = [](EvictionPolicy policy) {
+        BufferPool pool(small_pool(policy, 8));
+        int fd = make_paged_file("slru", 256, 64);
+        uint64_t id = pool.register_file();
+
+        for (int round = 0; round < 2; ++round)
+            for (int p = 0; p < 4; ++p) pool.fetch(id, fd, p, AccessHint::Point);
+        for (int p = 10; p < 64; ++p) pool.fetch(id, fd, p, AccessHint::Scan);
+
+        uint64_t before = pool.stats().misses;
+        for (int p = 0; p < 4; ++p) pool.fetch(id, fd, p, AccessHint::Point);
+        ::close(fd);
+        return pool.stats().misses - before;
+    };
+    assert(hot_misses_after_scan(EvictionPolicy::SegmentedLRU) == 0);
+    assert(hot_misses_after_scan(EvictionPolicy::LRU) == 4);
+}
+
+void test_pool_pinned_pages_not_evicted() {
+    BufferPool pool(small_pool(EvictionPolicy::LRU, 2));
+    int fd = make_paged_file("pinned", 256, 4);
+    uint64_t id = pool.register_file();
+
+    auto a = pool.fetch(id, fd, 0);
+    auto b = pool.fetch(id, fd, 1);
+    bool threw = false;
+    try {
+        pool.fetch(id, fd, 2);
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+    assert(a.data()[0] == 'a' && b.data()[0] == 'b');
+
+    b.release();
+    auto c = pool.fetch(id, fd, 2);   // page 1 was the only candidate
+    assert(c.data()[0] == 'c' && a.data()[0] == 'a');
+    ::close(fd);
+}
+
+void test_pool_sstable_reads() {
+    auto dir = std::filesystem::temp_directory_path() / "kvdb_pool_tests";
+    std::filesystem::create_directories(dir);
+    std::string base = (dir / "table").string();
+
+    BufferPoolOptions po;
+    po.capacity_bytes = 1 << 20;
+    SSTableOptions opts;
+    opts.block_size = 512;
+    opts.buffer_pool = std::make_shared<BufferPool>(po);
+
+    std::vector<std::pair<std::string, std::string>> kv;
+    for (int i = 0; i < 3000; ++i) {
+        char key[16];
+        std::snprintf(key, sizeof(key), "key%06d", i);
+        kv.emplace_back(key, "value" + std::to_string(i));
+    }
+    SSTable t = SSTable::build(base, kv, opts);
+
+    std::string v;
+    for (int round = 0; round < 2; ++round)
+        for (const auto& [k, val] : kv) assert(t.get(k, v) && v == val);
+    BufferPoolStats s = opts.buffer_pool->stats();
+    assert(s.misses > 0 && s.hits > s.misses);
+
+    int n = 0;
+    t.scan(kv.front().first, kv.back().first, [&](const std::string&, const std::string&) { ++n; });
+    assert(n == 3000);
+    assert(opts.buffer_pool->stats().misses == s.misses);   // everything was already cached
+
+    t.close();
+    assert(opts.buffer_pool->resident_pages() == 0);
+}
+
+void test_block_cache_lru() {
+    BlockCache cache(1000);
+    uint64_t a = cache.register_file(), b = cache.register_file();
+    assert(a != b);
+    auto block = [](char c) { return std::make_shared<const std::string>(300, c); };
+    cache.insert(a, 0, block('x'));
+    cache.insert(a, 300, block('y'));
+    cache.insert(b, 0, block('z'));
+    assert(cache.charge() == 900);
+    assert(cache.lookup(a, 0) && *cache.lookup(b, 0) == std::string(300, 'z'));
+    assert(!cache.lookup(b, 300));
+
+    // (a, 300) is least recently used and makes room for the fourth block
+    BlockCache::Block held = cache.lookup(a, 0);
+    cache.insert(b, 300, block('w'));
+    assert(!cache.lookup(a, 300) && cache.lookup(a, 0) && cache.lookup(b, 300));
+    assert(cache.charge() == 900 && cache.stats().evictions == 1);
+
+    cache.insert(a, 0, block('v'));   // replaces
+    assert(*cache.lookup(a, 0) == std::string(300, 'v') && *held == std::string(300, 'x'));
+    cache.insert(a, 5, std::make_shared<const std::string>(2000, 'b'));   // larger than the cache: not kept
+    assert(!cache.lookup(a, 5));
+
+    cache.forget_file(a);
+    assert(!cache.lookup(a, 0) && cache.lookup(b, 0) && cache.charge() == 600);
+}
+
+void run_buffer_pool_tests() {
+    test_pool_hits_and_data();
+    test_pool_lru_evicts_least_recent();
+    test_pool_clock_respects_capacity();
+    test_pool_segmented_lru_resists_scans();
+    test_pool_pinned_pages_not_evicted();
+    test_pool_sstable_reads();
+    test_block_cache_lru();
+    std::cout << "✅ All BufferPool tests passed!" << std::endl;
+}
+
+#endif
@@ -0,0 +1,221 @@
+#include "bulk_loader.h"
+#include "sstable_writer.h"
+#include <filesystem>
+#include <algorithm>
+#include <iterator>
+#include <optional>
+#include <stdexcept>
+#include <cstdio>
+
+namespace fs = std::filesystem;
+
+BulkLoader::BulkLoader(std::string tmp_dir_, SSTableOptions sstable, BulkLoadOptions options_)
+    : tmp_dir(std::move(tmp_dir_))
+    , output_options(std::move(sstable))
+    , options(options_) {
+    if (options.max_merge_width < 2) throw std::invalid_argument("max_merge_width must be at least 2");
+    fs::create_directories(tmp_dir);
+
+    // Runs are written once and read once, sequentially
+    run_options = output_options;
+    run_options.bloom_bits_per_key = 0;
+    run_options.index_page_size = 0;
+    run_options.read_mode = SSTableReadMode::Pread;
+    run_options.buffer_pool.reset();
+    run_options.block_cache.reset();
+    run_options.async_reader.reset();
+    run_options.sync_policy = SSTableSyncPolicy::None;
+
+    int n = options.sort_threads > 0 ? options.sort_threads : (int)std::max(1u, std::thread::hardware_concurrency());
+    buffer_limit = std::max<size_t>(options.memory_bytes / (size_t)(n + 1), 1);
+    current.number = next_run_number++;
+    for (int i = 0; i < n; ++i) threads.emplace_back([this] { sort_loop(); });
+}
+
+BulkLoader::~BulkLoader() {
+    stop_threads();
+    discard_runs();
+}
+
+std::string BulkLoader::run_base(uint64_t n) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "run_%06llu", (unsigned long long)n);
+    return (fs::path(tmp_dir) / name).string();
+}
+
+std::pair<uint64_t, std::string> BulkLoader::next_run() {
+    std::lock_guard<std::mutex> lock(mu);
+    uint64_t n = next_run_number++;
+    return {n, run_base(n)};
+}
+
+void BulkLoader::add(std::string_view key, std::string_view value) {
+    append(key, &value);
+}
+
+void BulkLoader::add_tombstone(std::string_view key) {
+    append(key, nullptr);
+}
+
+void BulkLoader::append(std::string_view key, const std::string_view* value) {
+    if (finished) throw std::logic_error("BulkLoader used after finish()");
+    Buffer::Entry e{current.bytes.size(), (uint32_t)key.size(), value ? (uint32_t)value->size() : kTombstoneVlen};
+    current.bytes.append(key);
+    if (value) current.bytes.append(*value);
+    current.entries.push_back(e);
+    ++added;
+    if (current.memory() >= buffer_limit) submit_current();
+}
+
+void BulkLoader::submit_current() {
+    std::unique_lock<std::mutex> lock(mu);
+    done_cv.wait(lock, [&] { return in_flight < threads.size() || error; });
+    if (error) std::rethrow_exception(error);
+    ++in_flight;
+    queued.push_back(std::move(current));
+    current = Buffer{};
+    current.number = next_run_number++;
+    work_cv.notify_one();
+}
+
+void BulkLoader::sort_loop() {
+    std::unique_lock<std::mutex> lock(mu);
+    for (;;) {
+        work_cv.wait(lock, [&] { return stopping || !queued.empty(); });
+        if (queued.empty()) return;   // stopping, and nothing left to sort
+        Buffer buf = std::move(queued.front());
+        queued.pop_front();
+        lock.unlock();
+
+        std::optional<TableFile> run;
+        std::exception_ptr failure;
+        try {
+            run = write_run(buf);
+        } catch (...) {
+            failure = std::current_exception();
+        }
+        buf = Buffer{};   // release the memory before the next buffer is admitted
+
+        lock.lock();
+        if (run) runs.push_back(std::move(*run));
+        if (failure && !error) error = failure;
+        --in_flight;
+        done_cv.notify_all();
+    }
+}
+
+TableFile BulkLoader::write_run(Buffer& buf) {
+    std::stable_sort(buf.entries.begin(), buf.entries.end(), [&](const Buffer::Entry& a, const Buffer::Entry& b) {
+        return buf.key(a) < buf.key(b);
+    });
+    SSTableWriter writer(run_base(buf.number), run_options);
+    for (size_t i = 0; i < buf.entries.size(); ++i) {
+        const Buffer::Entry& e = buf.entries[i];
+        // equal keys sit in add order: only the last one is kept
+        if (i + 1 < buf.entries.size() && buf.key(buf.entries[i + 1]) == buf.key(e)) continue;
+        if (e.value_size == kTombstoneVlen) writer.add_tombstone(buf.key(e));
+        else writer.add(buf.key(e), buf.value(e));
+    }
+    return make_table_file(buf.number, writer.finish());
+}
+
+void BulkLoader::stop_threads() {
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        stopping = true;
+    }
+    work_cv.notify_all();
+    for (auto& t : threads)
+        if (t.joinable()) t.join();
+    threads.clear();
+}
+
+void BulkLoader::discard_runs() {
+    for (auto& f : runs) delete_table_file(f);
+    runs.clear();
+    std::error_code ec;
+    fs::remove(tmp_dir, ec);   // only if empty: the directory may be shared
+}
+
+// BulkLoader::finish()
+// --------------------------------------------------------------------
+// Runs are ordered oldest first by the number they were given when their
+// buffer started filling. Merge passes replace groups of adjacent runs by
+// one run each, which keeps that order meaningful: a merged run is newer
+// than every run before its group and older than every run after it.
+BulkLoadResult BulkLoader::finish(const std::function<std::pair<uint64_t, std::string>()>& next_output) {
+    if (finished) throw std::logic_error("BulkLoader::finish() called twice");
+    finished = true;
+    BulkLoadResult result;
+    result.records_added = added;
+
+    if (!current.entries.empty()) {
+        std::unique_lock<std::mutex> lock(mu);
+        ++in_flight;
+        queued.push_back(std::move(current));
+        current = Buffer{};
+        work_cv.notify_one();
+    }
+    {
+        std::unique_lock<std::mutex> lock(mu);
+        done_cv.wait(lock, [&] { return in_flight == 0; });
+        if (error) std::rethrow_exception(error);
+    }
+    size_t parallel = threads.size();
+    stop_threads();
+    std::sort(runs.begin(), runs.end(), [](const TableFile& a, const TableFile& b) { return a.number < b.number; });
+    result.runs = runs.size();
+
+    // CompactionJob inputs are newest first
+    auto job_for = [](std::vector<TableFile>::const_iterator first, std::vector<TableFile>::const_iterator last) {
+        CompactionJob job;
+        job.inputs.assign(std::make_reverse_iterator(last), std::make_reverse_iterator(first));
+        return job;
+    };
+    CompactionOptions merge_options;
+    merge_options.target_file_size = options.target_file_size;
+
+    while (runs.size() > options.max_merge_width) {
+        size_t groups = (runs.size() + options.max_merge_width - 1) / options.max_merge_width;
+        std::vector<std::optional<TableFile>> merged(groups);
+        std::exception_ptr failure;
+        std::mutex failure_mu;
+        for (size_t first = 0; first < groups; first += parallel) {
+            std::vector<std::thread> workers;
+            for (size_t g = first; g < std::min(groups, first + parallel); ++g) {
+                workers.emplace_back([&, g] {
+                    try {
+                        size_t lo = g * options.max_merge_width;
+                        size_t hi = std::min(runs.size(), lo + options.max_merge_width);
+                        CompactionResult r = run_compaction(job_for(runs.begin() + (std::ptrdiff_t)lo,
+                                                                    runs.begin() + (std::ptrdiff_t)hi),
+                                                            merge_options, run_options, [this] { return next_run(); });
+                        if (!r.outputs.empty()) merged[g] = std::move(r.outputs.front());
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(failure_mu);
+                        if (!failure) failure = std::current_exception();
+                    }
+                });
+            }
+            for (auto& w : workers) w.join();
+        }
+        std::vector<TableFile> next;
+        for (auto& m : merged)
+            if (m) next.push_back(std::move(*m));
+        if (failure) {
+            for (auto& f : next) delete_table_file(f);
+            std::rethrow_exception(failure);
+        }
+        for (auto& f : runs) delete_table_file(f);
+        runs = std::move(next);
+        ++result.merge_passes;
+    }
+
+    CompactionJob job = job_for(runs.begin(), runs.end());
+    job.split_output = true;
+    CompactionResult r = run_compaction(job, merge_options, output_options, next_output);
+    result.outputs = std::move(r.outputs);
+    result.bytes_written = r.bytes_written;
+    discard_runs();
+    return result;
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <utility>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <exception>
+#include <cstdint>
+#include "compaction.h"
+
+// Tunables for a BulkLoader.
+struct BulkLoadOptions {
+    // Records buffered in memory across the buffer being filled and the ones
+    // being sorted; each run is about memory_bytes / (sort_threads + 1).
+    size_t memory_bytes = 256u << 20;
+    int sort_threads = 0;                       // run-generation threads; 0 = hardware_concurrency
+    size_t max_merge_width = 64;                // runs merged at once; more are merged in passes first
+    uint64_t target_file_size = 64ull << 20;    // final output is cut into tables of about this size
+};
+
+// Outcome of BulkLoader::finish().
+struct BulkLoadResult {
+    std::vector<TableFile> outputs;   // disjoint, in key order
+    uint64_t records_added{0};
+    uint64_t runs{0};                 // sorted runs written by run generation
+    uint64_t merge_passes{0};         // intermediate passes before the final merge
+    uint64_t bytes_written{0};        // output tables only
+};
+
+// BulkLoader: external sort of unsorted records into SSTables
+// ----------------------------------------
+// SSTableWriter needs keys in order and SSTable::build() a sorted vector;
+// loading an unsorted data set through put() instead costs a WAL append, a
+// memtable insert and, later, a flush and compactions per record. A
+// BulkLoader takes records in any order and any amount:
+//
+//   run generation  add() appends to an in-memory buffer. A full buffer is
+//                   handed to one of sort_threads threads, which sorts it and
+//                   writes it as a sorted run (an SSTable without filter) in
+//                   'tmp_dir' while add() fills the next buffer. add() only
+//                   waits when every thread is busy.
+//   merge           finish() merges the runs with run_compaction()'s k-way
+//                   merge, straight into tables named by next_output() and
+//                   cut at target_file_size. With more than max_merge_width
+//                   runs, groups of adjacent runs are first merged into
+//                   longer runs, several groups in parallel, so a merge never
+//                   holds more than max_merge_width open files and blocks.
+//
+// Memory stays within memory_bytes plus one block per merged run, whatever
+// the input size; disk use peaks at about twice the (encoded) input.
+//
+// The same key may be added more than once: the last add() wins, as with
+// put(). Tombstones are kept in the output. Not thread-safe: one thread adds.
+// A loader destroyed without finish() (or after a failure) removes its runs.
+class BulkLoader {
+public:
+    // 'sstable' shapes the output tables; runs use it without Bloom filter,
+    // caches or B+tree index. 'tmp_dir' is created if needed.
+    BulkLoader(std::string tmp_dir, SSTableOptions sstable, BulkLoadOptions options = {});
+    ~BulkLoader();
+
+    BulkLoader(const BulkLoader&) = delete;
+    BulkLoader& operator=(const BulkLoader&) = delete;
+
+    // Rethrow the first failure of a sort thread.
+    void add(std::string_view key, std::string_view value);
+    void add_tombstone(std::string_view key);
+
+    // Sort the last buffer, wait for the sort threads, merge every run into
+    // tables named by next_output() -> (number, base path) and return them.
+    // The runs are deleted. The loader cannot be used afterwards.
+    BulkLoadResult finish(const std::function<std::pair<uint64_t, std::string>()>& next_output);
+
+    [[nodiscard]] uint64_t records_added() const { return added; }
+
+private:
+    // Records of one run before sorting: keys and values back to back in
+    // 'bytes', located by 'entries' (value_size kTombstoneVlen = tombstone).
+    struct Buffer {
+        struct Entry {
+            uint64_t offset;
+            uint32_t key_size;
+            uint32_t value_size;
+        };
+        uint64_t number{0};   // age: higher = added later
+        std::string bytes;
+        std::vector<Entry> entries;
+
+        [[nodiscard]] size_t memory() const { return bytes.size() + entries.size() * sizeof(Entry); }
+        [[nodiscard]] std::string_view key(const Entry& e) const { return {bytes.data() + e.offset, e.key_size}; }
+        [[nodiscard]] std::string_view value(const Entry& e) const {
+            return e.value_size == kTombstoneVlen ? std::string_view()
+                                                  : std::string_view(bytes.data() + e.offset + e.key_size, e.value_size);
+        }
+    };
+
+    std::string tmp_dir;
+    SSTableOptions output_options;
+    SSTableOptions run_options;
+    BulkLoadOptions options;
+    size_t buffer_limit;
+    uint64_t added{0};
+    uint64_t next_run_number{1};
+    bool finished{false};
+    Buffer current;
+
+    std::mutex mu;
+    std::condition_variable work_cv;   // a buffer was queued, or shutdown
+    std::condition_variable done_cv;   // a buffer was written as a run
+    std::deque<Buffer> queued;
+    size_t in_flight{0};               // buffers queued or being sorted
+    bool stopping{false};
+    std::exception_ptr error;          // first sort thread failure
+    std::vector<TableFile> runs;       // written runs, any order (sorted by number before merging)
+    std::vector<std::thread> threads;
+
+    void append(std::string_view key, const std::string_view* value);
+
+    // Queue 'current' for sorting, first waiting for a free thread.
+    void submit_current();
+
+    void sort_loop();
+
+    // Sort 'buf' (stable, so the last add of a key comes last) and write each key's last version.
+    TableFile write_run(Buffer& buf);
+
+    [[nodiscard]] std::string run_base(uint64_t n) const;
+    std::pair<uint64_t, std::string> next_run();
+
+    // Stop the sort threads (after they finish what is queued).
+    void stop_threads();
+    void discard_runs();
+};
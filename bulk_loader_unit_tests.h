@@ -0,0 +1,129 @@
+#ifndef KVDATABASE_BULK_LOADER_UNIT_TESTS_H
+#define KVDATABASE_BULK_LOADER_UNIT_TESTS_H
+
+#include "bulk_loader.h"
+#include "kv_database.h"
+#include "kv_database_unit_tests.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+inline std::string bulk_key(uint64_t i) {
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "b%08llu", (unsigned long long)i);
+    return buf;
+}
+
+// Unsorted input with repeated keys and deletions, far more than the memory
+// budget: many runs, merged in passes, last add of a key wins.
+void test_bulk_loader_external_sort() {
+    std::string dir = fresh_db_dir("bulk_sort");
+    std::filesystem::create_directories(dir);
+    BulkLoadOptions opts;
+    opts.memory_bytes = 64 << 10;
+    opts.sort_threads = 3;
+    opts.max_merge_width = 4;
+    opts.target_file_size = 64 << 10;
+    BulkLoader loader(dir + "/runs", SSTableOptions{}, opts);
+
+    std::map<std::string, std::optional<std::string>> expected;
+    std::mt19937_64 rng(11);
+    for (int i = 0; i < 30000; ++i) {
+        std::string k = bulk_key(rng() % 20000);
+        if (i % 13 == 0) {
+            loader.add_tombstone(k);
+            expected[k] = std::nullopt;
+        } else {
+            std::string v = "v" + std::to_string(i);
+            loader.add(k, v);
+            expected[k] = v;
+        }
+    }
+    assert(loader.records_added() == 30000);
+
+    uint64_t next = 1;
+    BulkLoadResult r = loader.finish([&] {
+        uint64_t n = next++;
+        char name[32];
+        std::snprintf(name, sizeof(name), "/out_%03llu", (unsigned long long)n);
+        return std::make_pair(n, dir + name);
+    });
+    assert(r.runs > 16 && r.merge_passes >= 2 && r.outputs.size() > 1);
+    assert(!std::filesystem::exists(dir + "/runs"));
+
+    auto want = expected.begin();
+    for (size_t t = 0; t < r.outputs.size(); ++t) {
+        if (t > 0) assert(r.outputs[t - 1].largest < r.outputs[t].smallest);
+        for (SSTable::Cursor c(*r.outputs[t].table); c.valid(); c.next(), ++want) {
+            assert(want != expected.end() && c.key() == want->first);
+            assert(c.deleted() == !want->second);
+            if (want->second) assert(c.value() == *want->second);
+        }
+    }
+    assert(want == expected.end());
+    for (auto& f : r.outputs) delete_table_file(f);
+}
+
+// Ingested tables land as deep as their ranges allow and shadow older data.
+void test_db_ingest() {
+    std::string dir = fresh_db_dir("bulk_ingest");
+    KVOptions opts;
+    opts.compaction.background = false;
+    opts.compaction.target_file_size = 32 << 10;
+    {
+        KVDatabase db(dir, opts);
+        BulkLoadOptions bulk;
+        bulk.memory_bytes = 128 << 10;
+        auto loader = db.new_bulk_loader(bulk);
+        for (uint64_t i = 0; i < 5000; ++i) loader->add(bulk_key((i * 7919) % 5000), "first");
+        BulkLoadResult r = db.ingest(*loader);
+        assert(r.outputs.size() > 1);
+        // nothing to overlap: straight to the bottom level
+        std::vector<size_t> per_level = db.tables_per_level();
+        assert(per_level.size() == (size_t)opts.compaction.max_levels && per_level.back() == r.outputs.size());
+
+        db.put(bulk_key(10), "put");
+        db.remove(bulk_key(11));
+        auto second = db.new_bulk_loader(bulk);
+        second->add(bulk_key(10), "second");
+        second->add(bulk_key(12), "second");
+        second->add_tombstone(bulk_key(13));
+        db.ingest(*second);
+        // overlaps the flushed puts in level 0: goes on top of them
+        assert(db.tables_per_level()[0] == 2);
+        assert(db.stats().ingested_tables == r.outputs.size() + 1);
+
+        std::string v;
+        assert(db.get(bulk_key(10), v) && v == "second");
+        assert(!db.get(bulk_key(11), v));
+        assert(db.get(bulk_key(12), v) && v == "second");
+        assert(!db.get(bulk_key(13), v));
+        assert(db.get(bulk_key(14), v) && v == "first");
+        db.compact();
+        assert(db.get(bulk_key(10), v) && v == "second");
+    }
+    KVDatabase db(dir, opts);
+    std::string v;
+    size_t n = 0;
+    auto it = db.iterator();
+    for (it->seek_to_first(); it->valid(); it->next()) ++n;
+    assert(n == 4998);
+    assert(db.get(bulk_key(4999), v) && v == "first");
+    for (const auto& e : std::filesystem::directory_iterator(dir))
+        assert(e.path().extension() != ".tmp");
+}
+
+void run_bulk_loader_tests() {
+    test_bulk_loader_external_sort();
+    test_db_ingest();
+    std::cout << "✅ All bulk loader tests passed!" << std::endl;
+}
+
+#endif
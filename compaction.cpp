@@ -0,0 +1,368 @@
+#include "compaction.h"
+#include "sstable_writer.h"
+#include <filesystem>
+#include <algorithm>
+#include <queue>
+#include <unordered_set>
+#include <stdexcept>
+#include <unistd.h>
+
+TableFile open_table_file(uint64_t number, const std::string& base, const SSTableOptions& options) {
+    SSTable t(base);
+    t.use_prefix_index = options.prefix_index;
+    t.open(options.read_mode, options.buffer_pool, options.async_reader, options.block_cache);
+    return make_table_file(number, std::move(t));
+}
+
+TableFile make_table_file(uint64_t number, SSTable table) {
+    TableFile f;
+    f.number = number;
+    f.file_size = std::filesystem::file_size(table.data_path);
+    f.smallest = table.first_key();
+    f.largest = table.last_key();
+    // closed when the last holder (level structure, reader, merge) lets go
+    f.table = std::shared_ptr<SSTable>(new SSTable(std::move(table)), [](SSTable* t) {
+        t->close();
+        delete t;
+    });
+    return f;
+}
+
+void delete_table_file(TableFile& file) {
+    if (!file.table) return;
+    ::unlink(file.table->data_path.c_str());
+    ::unlink(file.table->index_path.c_str());   // legacy tables only; harmless otherwise
+}
+
+// ---- reading ----
+
+namespace {
+
+class LevelIterator : public Iterator {
+public:
+    LevelIterator(std::vector<TableFile> files_, size_t readahead_, TableIteratorFactory open_table_)
+        : files(std::move(files_))
+        , readahead(readahead_)
+        , open_table(std::move(open_table_)) {}
+
+    void seek_to_first() override {
+        open(0);
+        if (cur) cur->seek_to_first();
+        skip_exhausted();
+    }
+
+    // Only the first table whose largest key is >= target can hold it.
+    void seek(std::string_view target) override {
+        auto it = std::lower_bound(files.begin(), files.end(), target,
+            [](const TableFile& f, std::string_view k) { return f.largest < k; });
+        open((size_t)(it - files.begin()));
+        if (cur) cur->seek(target);
+        skip_exhausted();
+    }
+
+    void next() override {
+        cur->next();
+        skip_exhausted();
+    }
+
+    [[nodiscard]] bool valid() const override { return cur && cur->valid(); }
+    [[nodiscard]] std::string_view key() const override { return cur->key(); }
+    [[nodiscard]] std::string_view value() const override { return cur->value(); }
+    [[nodiscard]] bool deleted() const override { return cur->deleted(); }
+
+private:
+    std::vector<TableFile> files;
+    size_t readahead;
+    TableIteratorFactory open_table;
+    size_t pos{0};
+    std::unique_ptr<Iterator> cur;
+
+    void open(size_t i) {
+        pos = i;
+        cur.reset();
+        if (i >= files.size()) return;
+        if (open_table) cur = open_table(files[i]);
+        else cur = std::make_unique<SSTable::Iterator>(*files[i].table, readahead);
+    }
+
+    void skip_exhausted() {
+        while (cur && !cur->valid()) {
+            open(pos + 1);
+            if (cur) cur->seek_to_first();
+        }
+    }
+};
+
+} // namespace
+
+std::unique_ptr<Iterator> new_level_iterator(std::vector<TableFile> files, size_t readahead_bytes,
+                                             TableIteratorFactory open_table) {
+    return std::make_unique<LevelIterator>(std::move(files), readahead_bytes, std::move(open_table));
+}
+
+// ---- picking ----
+
+static uint64_t level_bytes(const std::vector<TableFile>& level) {
+    uint64_t n = 0;
+    for (const auto& f : level) n += f.file_size;
+    return n;
+}
+
+static bool overlaps(const TableFile& f, const std::string& lo, const std::string& hi) {
+    return !(f.largest < lo || f.smallest > hi);
+}
+
+static bool deeper_levels_empty(const LevelVector& levels, int level) {
+    for (size_t i = (size_t)level + 1; i < levels.size(); ++i)
+        if (!levels[i].empty()) return false;
+    return true;
+}
+
+// L0 -> L1: every L0 table plus the L1 tables their union range overlaps.
+static CompactionJob level0_job(const LevelVector& levels) {
+    CompactionJob job;
+    job.input_level = 0;
+    job.output_level = 1;
+    job.split_output = true;
+
+    std::string lo, hi;
+    bool any = false;
+    for (auto it = levels[0].rbegin(); it != levels[0].rend(); ++it) {
+        job.inputs.push_back(*it);
+        if (it->table->num_entries == 0) continue;
+        if (!any || it->smallest < lo) lo = it->smallest;
+        if (!any || it->largest > hi) hi = it->largest;
+        any = true;
+    }
+    if (any && levels.size() > 1)
+        for (const auto& f : levels[1])
+            if (overlaps(f, lo, hi)) job.inputs.push_back(f);
+    job.drop_tombstones = deeper_levels_empty(levels, 1);
+    return job;
+}
+
+// Ln -> Ln+1: the Ln table whose overlap with Ln+1 is smallest relative to its own size.
+static CompactionJob leveled_job(const LevelVector& levels, int level) {
+    static const std::vector<TableFile> none;   // Ln+1 not created yet
+    const auto& next = (size_t)level + 1 < levels.size() ? levels[level + 1] : none;
+    const TableFile* best = nullptr;
+    double best_ratio = 0;
+    for (const auto& f : levels[level]) {
+        uint64_t overlap = 0;
+        for (const auto& g : next)
+            if (overlaps(g, f.smallest, f.largest)) overlap += g.file_size;
+        double ratio = (double)overlap / (double)std::max<uint64_t>(f.file_size, 1);
+        if (!best || ratio < best_ratio) { best = &f; best_ratio = ratio; }
+    }
+
+    CompactionJob job;
+    job.input_level = level;
+    job.output_level = level + 1;
+    job.split_output = true;
+    job.inputs.push_back(*best);
+    for (const auto& g : next)
+        if (overlaps(g, best->smallest, best->largest)) job.inputs.push_back(g);
+    job.drop_tombstones = deeper_levels_empty(levels, level + 1);
+    return job;
+}
+
+static std::optional<CompactionJob> pick_leveled(const LevelVector& levels, const CompactionOptions& options) {
+    int max_levels = std::max(options.max_levels, 2);
+    double best_score = 0;
+    int best_level = -1;
+
+    if (!levels.empty() && options.level0_file_trigger > 0) {
+        best_score = (double)levels[0].size() / options.level0_file_trigger;
+        best_level = 0;
+    }
+    double limit = (double)options.level_base_bytes;
+    for (int n = 1; n + 1 < max_levels && n < (int)levels.size(); ++n) {
+        double score = (double)level_bytes(levels[n]) / std::max(limit, 1.0);
+        if (score > best_score) { best_score = score; best_level = n; }
+        limit *= std::max(options.level_multiplier, 1);
+    }
+    if (best_level < 0 || best_score < 1.0) return std::nullopt;
+    return best_level == 0 ? level0_job(levels) : leveled_job(levels, best_level);
+}
+
+// Size-tiered: the newest run of >= size_tier_min_tables adjacent tables whose
+// sizes stay within size_tier_ratio of the group average. Only adjacent tables
+// may be merged, or the result would sit at the wrong age relative to the
+// tables skipped over.
+static std::optional<CompactionJob> pick_size_tiered(const LevelVector& levels, const CompactionOptions& options) {
+    if (levels.empty()) return std::nullopt;
+    const auto& runs = levels[0];
+    size_t min_tables = (size_t)std::max(options.size_tier_min_tables, 2);
+    double ratio = std::max(options.size_tier_ratio, 1.0);
+    auto size_of = [&](size_t i) { return (double)std::max<uint64_t>(runs[i].file_size, 1); };
+
+    for (size_t newest = runs.size(); newest-- > 0;) {
+        double sum = size_of(newest);
+        size_t len = 1;
+        for (size_t k = newest; k-- > 0;) {
+            double avg = sum / (double)len, s = size_of(k);
+            if (s > avg * ratio || s * ratio < avg) break;
+            sum += s;
+            ++len;
+        }
+        if (len < min_tables) continue;
+
+        CompactionJob job;
+        size_t oldest = newest + 1 - len;
+        for (size_t i = newest + 1; i-- > oldest;) job.inputs.push_back(runs[i]);
+        job.drop_tombstones = (oldest == 0);
+        return job;
+    }
+    return std::nullopt;
+}
+
+std::optional<CompactionJob> pick_compaction(const LevelVector& levels, const CompactionOptions& options) {
+    switch (options.style) {
+        case CompactionStyle::None:       return std::nullopt;
+        case CompactionStyle::Leveled:    return pick_leveled(levels, options);
+        case CompactionStyle::SizeTiered: return pick_size_tiered(levels, options);
+    }
+    return std::nullopt;
+}
+
+// ---- merging ----
+
+// run_compaction()
+// --------------------------------------------------------------------
+// One cursor per input in a min-heap ordered by (key, input position). The
+// top of the heap is the newest version of the smallest key; it is written
+// out (unless it is a droppable tombstone) and every other cursor sitting
+// on the same key is advanced past it.
+CompactionResult run_compaction(const CompactionJob& job, const CompactionOptions& options,
+                                const SSTableOptions& sstable_options,
+                                const std::function<std::pair<uint64_t, std::string>()>& next_output,
+                                const std::atomic<bool>* cancel) {
+    CompactionResult result;
+    std::vector<std::unique_ptr<SSTable::Cursor>> cursors;
+    for (const auto& in : job.inputs) {
+        result.bytes_read += in.file_size;
+        cursors.push_back(std::make_unique<SSTable::Cursor>(*in.table));
+    }
+
+    auto later = [&](size_t a, size_t b) {
+        int c = cursors[a]->key().compare(cursors[b]->key());
+        return c != 0 ? c > 0 : a > b;
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+    for (size_t i = 0; i < cursors.size(); ++i)
+        if (cursors[i]->valid()) heap.push(i);
+
+    std::unique_ptr<SSTableWriter> writer;
+    uint64_t writer_number = 0;
+    auto finish_output = [&] {
+        if (!writer) return;
+        if (writer->num_entries() == 0) {
+            writer->abandon();
+        } else {
+            result.outputs.push_back(make_table_file(writer_number, writer->finish()));
+            result.bytes_written += result.outputs.back().file_size;
+        }
+        writer.reset();
+    };
+    auto discard_outputs = [&] {
+        writer.reset();   // abandons the partial file
+        for (auto& f : result.outputs) delete_table_file(f);
+        result.outputs.clear();
+    };
+
+    try {
+        std::string key, converted;
+        while (!heap.empty()) {
+            if (cancel && cancel->load(std::memory_order_relaxed)) {
+                discard_outputs();
+                result.cancelled = true;
+                return result;
+            }
+
+            size_t top = heap.top();
+            heap.pop();
+            SSTable::Cursor& c = *cursors[top];
+            key.assign(c.key());
+            if (!(c.deleted() && job.drop_tombstones)) {
+                if (!writer) {
+                    auto [number, base] = next_output();
+                    writer_number = number;
+                    writer = std::make_unique<SSTableWriter>(base, sstable_options);
+                }
+                if (c.deleted()) writer->add_tombstone(key);
+                else if (job.convert_value && job.convert_value(*job.inputs[top].table, key, c.value(), converted))
+                    writer->add(key, converted);
+                else writer->add(key, c.value());
+            }
+
+            c.next();
+            if (c.valid()) heap.push(top);
+            // older versions of the same key
+            while (!heap.empty() && cursors[heap.top()]->key() == key) {
+                size_t i = heap.top();
+                heap.pop();
+                if (job.on_discard && !cursors[i]->deleted()) job.on_discard(*job.inputs[i].table, cursors[i]->value());
+                cursors[i]->next();
+                if (cursors[i]->valid()) heap.push(i);
+            }
+
+            if (writer && job.split_output && writer->file_size() >= options.target_file_size) finish_output();
+        }
+        finish_output();
+    } catch (...) {
+        discard_outputs();
+        throw;
+    }
+    return result;
+}
+
+void install_compaction(LevelVector& levels, const CompactionJob& job, const std::vector<TableFile>& outputs) {
+    if (levels.size() <= (size_t)job.output_level) levels.resize(job.output_level + 1);
+
+    std::unordered_set<uint64_t> inputs;
+    for (const auto& f : job.inputs) inputs.insert(f.number);
+
+    size_t insert_at = 0;
+    bool found = false;
+    for (int level : {job.input_level, job.output_level}) {
+        auto& files = levels[level];
+        for (size_t i = 0; i < files.size();) {
+            if (!inputs.count(files[i].number)) { ++i; continue; }
+            if (level == job.output_level && !found) { insert_at = i; found = true; }
+            files.erase(files.begin() + (std::ptrdiff_t)i);
+        }
+    }
+
+    auto& out = levels[job.output_level];
+    if (job.output_level == 0) {
+        // size-tiered: the merged run takes the age (position) of the runs it replaces
+        out.insert(out.begin() + (std::ptrdiff_t)insert_at, outputs.begin(), outputs.end());
+    } else {
+        out.insert(out.end(), outputs.begin(), outputs.end());
+        std::sort(out.begin(), out.end(),
+                  [](const TableFile& a, const TableFile& b) { return a.smallest < b.smallest; });
+    }
+}
+
+void install_ingested(LevelVector& levels, const std::vector<TableFile>& files, const CompactionOptions& options) {
+    int bottom = options.style == CompactionStyle::Leveled ? std::max(options.max_levels, 2) - 1 : 0;
+    std::vector<bool> touched;
+    for (const auto& f : files) {
+        int target = 0;
+        for (int level = 0; level <= bottom; ++level) {
+            if ((size_t)level < levels.size() &&
+                std::any_of(levels[level].begin(), levels[level].end(),
+                            [&](const TableFile& g) { return overlaps(g, f.smallest, f.largest); }))
+                break;
+            target = level;
+        }
+        if (levels.size() <= (size_t)target) levels.resize((size_t)target + 1);
+        levels[target].push_back(f);
+        touched.resize(levels.size(), false);
+        touched[target] = true;
+    }
+    for (size_t level = 1; level < touched.size(); ++level)
+        if (touched[level])
+            std::sort(levels[level].begin(), levels[level].end(),
+                      [](const TableFile& a, const TableFile& b) { return a.smallest < b.smallest; });
+}
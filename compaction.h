@@ -0,0 +1,108 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <optional>
+#include <atomic>
+#include <cstdint>
+#include "sstable.h"
+
+enum class CompactionStyle {
+    None,         // tables pile up in level 0 and are never merged
+    Leveled,      // L0 (overlapping) -> L1..Ln, each level one sorted run ~level_multiplier x the previous
+    SizeTiered,   // one level of overlapping runs; runs of similar size are merged into one
+};
+
+struct CompactionOptions {
+    CompactionStyle style = CompactionStyle::Leveled;
+    bool background = true;                   // run on a background thread after flushes; otherwise only compact()
+
+    // Leveled
+    int level0_file_trigger = 4;              // compact L0 into L1 once it holds this many tables
+    uint64_t level_base_bytes = 10ull << 20;  // L1 size limit; L(n+1) may hold level_multiplier x L(n)
+    int level_multiplier = 10;
+    int max_levels = 7;
+    uint64_t target_file_size = 2ull << 20;   // merged output is cut into tables of about this size
+
+    // SizeTiered
+    int size_tier_min_tables = 4;             // merge once this many adjacent runs have similar sizes
+    double size_tier_ratio = 2.0;             // "similar": within this factor of the group's average
+};
+
+// One SSTable of the engine's level structure, with the metadata the
+// compaction picker needs kept next to it.
+struct TableFile {
+    uint64_t number{0};
+    std::shared_ptr<SSTable> table;
+    uint64_t file_size{0};
+    std::string smallest, largest;   // key range (both "" for an empty table)
+};
+
+// levels[0]: overlapping tables, oldest first (newer tables shadow older ones).
+// levels[1..]: sorted by key, key ranges disjoint (Leveled only).
+using LevelVector = std::vector<std::vector<TableFile>>;
+
+// Open SSTable 'number' at 'base' and collect its metadata.
+TableFile open_table_file(uint64_t number, const std::string& base, const SSTableOptions& options);
+
+// Wrap a freshly finished table. The shared SSTable closes itself when released.
+TableFile make_table_file(uint64_t number, SSTable table);
+
+// Remove the table's files. Open handles keep working; the table is closed
+// when its last shared_ptr goes away.
+void delete_table_file(TableFile& file);
+
+// Iterator over one sorted level (disjoint tables ordered by key), opening
+// one table iterator at a time. Keeps the tables open while it lives.
+// 'open_table', if given, makes each table's iterator instead of a plain
+// SSTable::Iterator (e.g. to decode separated values).
+using TableIteratorFactory = std::function<std::unique_ptr<Iterator>(const TableFile&)>;
+std::unique_ptr<Iterator> new_level_iterator(std::vector<TableFile> files,
+                                             size_t readahead_bytes = SSTable::Iterator::kDefaultReadahead,
+                                             TableIteratorFactory open_table = nullptr);
+
+// A unit of compaction work: merge 'inputs' into output_level.
+struct CompactionJob {
+    int input_level{0};
+    int output_level{0};
+    std::vector<TableFile> inputs;   // newest first: on equal keys the earliest input wins
+    bool drop_tombstones{false};     // nothing older than the inputs can hold the key
+    bool split_output{false};        // cut output at target_file_size (Leveled)
+    // Optional, called with the input table a value comes from: convert_value
+    // may rewrite a value the merge keeps into 'out' and return true (the
+    // engine moves values in and out of its value log this way); on_discard
+    // sees the value of every older version the merge drops.
+    std::function<bool(const SSTable& input, std::string_view key, std::string_view value, std::string& out)>
+        convert_value;
+    std::function<void(const SSTable& input, std::string_view value)> on_discard;
+};
+
+// Pick the most urgent compaction, or nothing if every level is within its limits.
+std::optional<CompactionJob> pick_compaction(const LevelVector& levels, const CompactionOptions& options);
+
+struct CompactionResult {
+    std::vector<TableFile> outputs;
+    uint64_t bytes_read{0};
+    uint64_t bytes_written{0};
+    bool cancelled{false};           // 'cancel' was raised; partial outputs were removed
+};
+
+// Merge the job's inputs with a heap-based k-way merge, streaming the result
+// through SSTableWriter into tables named by next_output() -> (number, base path).
+// Only the newest version of each key is kept.
+CompactionResult run_compaction(const CompactionJob& job, const CompactionOptions& options,
+                                const SSTableOptions& sstable_options,
+                                const std::function<std::pair<uint64_t, std::string>()>& next_output,
+                                const std::atomic<bool>* cancel = nullptr);
+
+// Replace the job's inputs by its outputs in 'levels'. Tables added since the
+// job was picked (newer L0 flushes) are left where they are.
+void install_compaction(LevelVector& levels, const CompactionJob& job, const std::vector<TableFile>& outputs);
+
+// Add tables with disjoint key ranges holding data newer than everything in
+// 'levels' (a bulk load). Leveled: each table goes to the deepest level L
+// such that no table in levels 0..L overlaps it - where compaction would
+// eventually have moved it, since nothing above it can be newer - and on
+// top of level 0 if level 0 or 1 overlaps. Other styles: on top of level 0.
+void install_ingested(LevelVector& levels, const std::vector<TableFile>& files, const CompactionOptions& options);
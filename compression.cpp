@@ -0,0 +1,117 @@
+#include "compression.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace lz {
+
+static constexpr size_t kMinMatch = 4;
+static constexpr size_t kMaxOffset = 0xFFFF;
+static constexpr int kHashBits = 13;
+// Most output one input byte can stand for (a length byte of 255); a
+// sequence's token and offset produce at most 19 from 3 bytes.
+static constexpr size_t kMaxExpansion = 255;
+
+static uint32_t load32(const unsigned char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t hash4(uint32_t v) {
+    return (v * 2654435761u) >> (32 - kHashBits);
+}
+
+// Length beyond a nibble: 255-bytes then the remainder.
+static void put_length(std::string& out, size_t n) {
+    for (; n >= 255; n -= 255) out.push_back((char)255);
+    out.push_back((char)n);
+}
+
+static bool get_length(const unsigned char*& p, const unsigned char* end, size_t& n) {
+    unsigned char b;
+    do {
+        if (p == end) return false;
+        b = *p++;
+        n += b;
+    } while (b == 255);
+    return true;
+}
+
+static void put_sequence(std::string& out, const unsigned char* literals, size_t lit_len,
+                         size_t offset, size_t match_len) {
+    size_t m = match_len ? match_len - kMinMatch : 0;
+    out.push_back((char)((std::min<size_t>(lit_len, 15) << 4) | std::min<size_t>(m, 15)));
+    if (lit_len >= 15) put_length(out, lit_len - 15);
+    out.append(reinterpret_cast<const char*>(literals), lit_len);
+    if (!match_len) return;
+    out.push_back((char)(offset & 0xFF));
+    out.push_back((char)(offset >> 8));
+    if (m >= 15) put_length(out, m - 15);
+}
+
+void compress(std::string_view in, std::string& out) {
+    const auto* src = reinterpret_cast<const unsigned char*>(in.data());
+    const size_t n = in.size();
+    // positions + 1 of earlier 4-byte prefixes; 0 = empty slot
+    thread_local std::vector<uint32_t> table;
+    table.assign((size_t)1 << kHashBits, 0);
+
+    size_t anchor = 0, i = 0;
+    while (i + kMinMatch <= n) {
+        uint32_t seq = load32(src + i);
+        uint32_t& slot = table[hash4(seq)];
+        size_t cand = slot;
+        slot = (uint32_t)(i + 1);
+        if (cand && i - (cand - 1) <= kMaxOffset && load32(src + cand - 1) == seq) {
+            size_t m = cand - 1, len = kMinMatch;
+            while (i + len < n && src[m + len] == src[i + len]) ++len;
+            put_sequence(out, src + anchor, i - anchor, i - m, len);
+            i += len;
+            anchor = i;
+            continue;
+        }
+        // step faster through data that keeps failing to match
+        i += 1 + ((i - anchor) >> 6);
+    }
+    put_sequence(out, src + anchor, n - anchor, 0, 0);
+}
+
+bool decompress(std::string_view in, size_t raw_size, std::string& out) {
+    const auto* p = reinterpret_cast<const unsigned char*>(in.data());
+    const auto* end = p + in.size();
+    // a corrupt size must not turn into a huge allocation
+    if (raw_size / kMaxExpansion > in.size()) return false;
+    size_t base = out.size();
+    out.resize(base + raw_size);
+    char* dst = out.data() + base;
+    size_t pos = 0;
+
+    while (p < end) {
+        unsigned token = *p++;
+        size_t lit = token >> 4;
+        if (lit == 15 && !get_length(p, end, lit)) return false;
+        if ((size_t)(end - p) < lit || raw_size - pos < lit) return false;
+        std::memcpy(dst + pos, p, lit);
+        p += lit;
+        pos += lit;
+        if (p == end) break;   // last sequence: literals only
+
+        if (end - p < 2) return false;
+        size_t offset = p[0] | (size_t)p[1] << 8;
+        p += 2;
+        size_t len = token & 15;
+        if (len == 15 && !get_length(p, end, len)) return false;
+        len += kMinMatch;
+        if (offset == 0 || offset > pos || raw_size - pos < len) return false;
+        if (offset >= len) {
+            std::memcpy(dst + pos, dst + pos - offset, len);
+        } else {
+            for (size_t k = 0; k < len; ++k) dst[pos + k] = dst[pos + k - offset];
+        }
+        pos += len;
+    }
+    return pos == raw_size;
+}
+
+} // namespace lz
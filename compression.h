@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Per-table codec of SSTable data blocks (recorded in the table footer).
+enum class CompressionType : uint8_t {
+    None = 0,
+    LZ = 1,   // lz::compress below
+};
+
+// lz: small, fast LZ77 codec for SSTable blocks
+// ----------------------------------------
+// Byte-oriented format in the style of LZ4: a stream of sequences, each
+//   [token u8][extra literal length][literals][offset u16][extra match length]
+// The token's high nibble is the literal count and its low nibble the match
+// length minus 4; a nibble of 15 is continued by bytes of 255 plus a final
+// byte < 255. The offset (1..65535) counts back from the current output
+// position; a match may overlap the bytes it produces. The last sequence
+// has literals only and ends the stream.
+//
+// The compressor finds matches greedily through a hash table of 4-byte
+// prefixes: one pass, no entropy coding, aimed at speed rather than ratio.
+namespace lz {
+
+// Append the compressed form of 'in' to 'out'.
+void compress(std::string_view in, std::string& out);
+
+// Append the 'raw_size' bytes that 'in' decompresses to to 'out'. Returns
+// false (with 'out' in an unspecified state) if 'in' is not a valid stream
+// of exactly that size; a 'raw_size' more than 'in' could expand to is
+// rejected before anything is allocated.
+bool decompress(std::string_view in, size_t raw_size, std::string& out);
+
+} // namespace lz
@@ -0,0 +1,79 @@
+#ifndef KVDATABASE_COMPRESSION_UNIT_TESTS_H
+#define KVDATABASE_COMPRESSION_UNIT_TESTS_H
+
+#include "compression.h"
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+inline void check_lz_roundtrip(const std::string& in) {
+    std::string packed;
+    lz::compress(in, packed);
+    std::string out = "prefix";   // decompress appends
+    assert(lz::decompress(packed, in.size(), out));
+    assert(out == "prefix" + in);
+}
+
+void test_lz_roundtrip() {
+    std::mt19937 rng(42);
+    std::string random(5000, '\0');
+    for (char& c : random) c = (char)(rng() & 0xFF);
+
+    std::string text;
+    for (int i = 0; i < 300; ++i) text += "{\"user\":" + std::to_string(i % 17) + ",\"status\":\"active\",\"tags\":[]}";
+
+    std::vector<std::string> inputs = {
+        "", "a", "abc", "abcd", "abcdabcd",
+        std::string(10000, 'x'),                  // one long overlapping match
+        std::string(300, 'q') + random.substr(0, 600) + std::string(300, 'q'),   // long literal run
+        random, text,
+    };
+    for (const auto& in : inputs) check_lz_roundtrip(in);
+
+    std::string packed;
+    lz::compress(text, packed);
+    assert(packed.size() * 3 < text.size());
+    packed.clear();
+    lz::compress(random, packed);
+    assert(packed.size() < random.size() + random.size() / 64 + 16);   // bounded growth on noise
+}
+
+void test_lz_rejects_corrupt() {
+    std::string text;
+    for (int i = 0; i < 100; ++i) text += "row" + std::to_string(i % 10) + "-payload;";
+    std::string packed;
+    lz::compress(text, packed);
+
+    std::string out;
+    assert(!lz::decompress(packed, text.size() + 1, out));   // wrong size
+    out.clear();
+    assert(!lz::decompress(packed, text.size() - 1, out));
+    out.clear();
+    assert(!lz::decompress(std::string_view(packed).substr(0, packed.size() / 2), text.size(), out));   // truncated
+
+    // a match reaching back before the start of the output
+    std::string bad = {(char)0x10, 'a', (char)0x05, (char)0x00};
+    out.clear();
+    assert(!lz::decompress(bad, 5, out));
+
+    // a size no stream that short can reach fails before allocating it
+    out.clear();
+    assert(!lz::decompress(packed, (size_t)1 << 40, out) && out.capacity() < ((size_t)1 << 20));
+
+    // while the most compressible input still fits the bound
+    std::string run(1 << 20, 'z');
+    packed.clear();
+    lz::compress(run, packed);
+    out.clear();
+    assert(lz::decompress(packed, run.size(), out) && out == run);
+}
+
+void run_compression_tests() {
+    test_lz_roundtrip();
+    test_lz_rejects_corrupt();
+    std::cout << "✅ All compression tests passed!" << std::endl;
+}
+
+#endif
@@ -0,0 +1,161 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include "arena.h"
+#include "record.h"
+
+// FixedAVLTree: AVLTree for fixed-width keys and values
+// ----------------------------------------
+// The same balanced tree as AVLTree (same rotations, overwrite-in-place,
+// tombstones, entry and byte limits, nodes in an Arena), but K and V are
+// stored inside the node instead of as string_views of separately copied
+// bytes, and keys are ordered by Compare instead of byte-wise. For 8-byte
+// integer keys and small values a node is one allocation of a few dozen
+// bytes and a comparison is a single integer compare.
+//
+// K and V must be trivially copyable (they live in the arena and are never
+// destroyed). FixedTable<FixedWidthTraits<K, V, Compare>> is the matching
+// on-disk table (see fixed_table.h).
+template <class K, class V, class Compare = std::less<K>>
+class FixedAVLTree {
+    static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>,
+                  "FixedAVLTree keys and values must be trivially copyable");
+
+public:
+    struct Node {
+        K key;
+        V value;
+        Node* left{nullptr};
+        Node* right{nullptr};
+        int height{1};
+        bool deleted;   // tombstone: value is default-constructed
+
+        Node(const K& k, const V& v, bool is_deleted) : key(k), value(v), deleted(is_deleted) {}
+    };
+
+    FixedAVLTree() = default;
+    explicit FixedAVLTree(int max, size_t max_bytes_ = std::numeric_limits<size_t>::max())
+        : max_size(max)
+        , max_bytes(max_bytes_) {}
+    FixedAVLTree(FixedAVLTree&& o) noexcept
+        : arena(std::move(o.arena))
+        , root(std::exchange(o.root, nullptr))
+        , size(std::exchange(o.size, 0))
+        , max_size(o.max_size)
+        , max_bytes(o.max_bytes) {}
+    FixedAVLTree& operator=(FixedAVLTree&& o) noexcept {
+        if (this != &o) {
+            arena = std::move(o.arena);
+            root = std::exchange(o.root, nullptr);
+            size = std::exchange(o.size, 0);
+            max_size = o.max_size;
+            max_bytes = o.max_bytes;
+        }
+        return *this;
+    }
+    FixedAVLTree(const FixedAVLTree&) = delete;
+    FixedAVLTree& operator=(const FixedAVLTree&) = delete;
+
+    // Like AVLTree::insert(): overwrites an existing key, returns false when full.
+    bool insert(const K& key, const V& value) { return insert_entry(key, value, false); }
+    bool insert_tombstone(const K& key) { return insert_entry(key, V{}, true); }
+
+    [[nodiscard]] LookupResult get(const K& key, V& value_out) const {
+        const Node* node = root;
+        while (node) {
+            if (less(key, node->key)) node = node->left;
+            else if (less(node->key, key)) node = node->right;
+            else break;
+        }
+        if (node == nullptr) return LookupResult::NotFound;
+        if (node->deleted) return LookupResult::Deleted;
+        value_out = node->value;
+        return LookupResult::Found;
+    }
+
+    // Visit every node (tombstones included) in ascending key order.
+    void for_each(const std::function<void(const Node&)>& visit) const { for_each(root, visit); }
+
+    [[nodiscard]] int get_size() const { return size; }
+    [[nodiscard]] size_t memory_usage() const { return arena.bytes_used(); }
+    [[nodiscard]] bool is_full() const { return size >= max_size || arena.bytes_used() >= max_bytes; }
+
+private:
+    Arena arena;
+    Node* root{nullptr};
+    int size{0};
+    int max_size{std::numeric_limits<int>::max()};
+    size_t max_bytes{std::numeric_limits<size_t>::max()};
+    [[no_unique_address]] Compare less;
+
+    static int height(const Node* node) { return node ? node->height : 0; }
+    static int balance_factor(const Node* node) { return node ? height(node->left) - height(node->right) : 0; }
+    static void update_height(Node* node) { node->height = 1 + std::max(height(node->left), height(node->right)); }
+
+    static Node* right_rotate(Node* y) {
+        Node* x = y->left;
+        y->left = x->right;
+        x->right = y;
+        update_height(y);
+        update_height(x);
+        return x;
+    }
+
+    static Node* left_rotate(Node* x) {
+        Node* y = x->right;
+        x->right = y->left;
+        y->left = x;
+        update_height(x);
+        update_height(y);
+        return y;
+    }
+
+    bool insert_entry(const K& key, const V& value, bool deleted) {
+        if (is_full()) return false;
+        bool added = false;
+        root = insert(root, key, value, deleted, added);
+        if (added) ++size;
+        return true;
+    }
+
+    Node* insert(Node* node, const K& key, const V& value, bool deleted, bool& added) {
+        if (node == nullptr) {
+            added = true;
+            return arena.make<Node>(key, value, deleted);
+        }
+        if (less(key, node->key)) {
+            node->left = insert(node->left, key, value, deleted, added);
+        } else if (less(node->key, key)) {
+            node->right = insert(node->right, key, value, deleted, added);
+        } else {
+            node->value = value;
+            node->deleted = deleted;
+            return node;
+        }
+
+        update_height(node);
+        int balance = balance_factor(node);
+        if (balance > 1 && less(key, node->left->key)) return right_rotate(node);
+        if (balance < -1 && less(node->right->key, key)) return left_rotate(node);
+        if (balance > 1 && less(node->left->key, key)) {
+            node->left = left_rotate(node->left);
+            return right_rotate(node);
+        }
+        if (balance < -1 && less(key, node->right->key)) {
+            node->right = right_rotate(node->right);
+            return left_rotate(node);
+        }
+        return node;
+    }
+
+    static void for_each(const Node* node, const std::function<void(const Node&)>& visit) {
+        if (node == nullptr) return;
+        for_each(node->left, visit);
+        visit(*node);
+        for_each(node->right, visit);
+    }
+};
@@ -0,0 +1,245 @@
+#pragma once
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "fixed_avl_tree.h"
+#include "record.h"
+#include "sstable_format.h"
+
+// Key and value types of a FixedTable, and the key order.
+template <class K, class V, class Compare = std::less<K>>
+struct FixedWidthTraits {
+    static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>,
+                  "fixed-width keys and values must be trivially copyable");
+    using Key = K;
+    using Value = V;
+    using KeyCompare = Compare;
+    static constexpr size_t kKeySize = sizeof(K);
+    static constexpr size_t kValueSize = sizeof(V);
+};
+
+// FixedTable: immutable on-disk table of fixed-width records
+// ----------------------------------------
+// The SSTable format has to describe every record's key and value lengths
+// and find records through an index of blocks. When every key is a Key and
+// every value a Value, none of that is needed: the file stores the keys as
+// one dense array, then the values as another, in key order. Record i's key
+// is at i * kKeySize and its value at values_offset + i * kValueSize, so a
+// lookup is a binary search over the key array alone (compared with
+// KeyCompare, e.g. as integers) followed by one address computation.
+//
+// File layout ("<base>.fxt"):
+//   [n keys][n values][tombstone bitmap, bit i = record i deleted (only if any)]
+//   [n u64][key_size u32][value_size u32][values_offset u64][bitmap_offset u64 (0 = none)]
+//   [version u32][magic u64]
+// Integers are in host byte order, like the records themselves, so a table
+// is only readable on a machine of the same endianness.
+//
+// The file is read through one read-only mapping; keys and values are
+// copied out with memcpy, so no alignment is assumed.
+template <class Traits>
+class FixedTable {
+public:
+    using Key = typename Traits::Key;
+    using Value = typename Traits::Value;
+    using Record = std::pair<Key, std::optional<Value>>;   // nullopt = tombstone
+
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint64_t kMagic = 0x315458464244564Bull;   // "KVDBFXT1"
+    static constexpr size_t kFooterSize = sizeof(uint64_t) * 4 + sizeof(uint32_t) * 3;
+
+    explicit FixedTable(std::string base_no_ext) : path(std::move(base_no_ext) + ".fxt") {}
+    FixedTable(FixedTable&& o) noexcept { *this = std::move(o); }
+    FixedTable& operator=(FixedTable&& o) noexcept {
+        if (this != &o) {
+            close();
+            path = std::move(o.path);
+            map_base = std::exchange(o.map_base, nullptr);
+            map_size = std::exchange(o.map_size, 0);
+            count = std::exchange(o.count, 0);
+            values = std::exchange(o.values, nullptr);
+            tombstones = std::exchange(o.tombstones, nullptr);
+        }
+        return *this;
+    }
+    FixedTable(const FixedTable&) = delete;
+    FixedTable& operator=(const FixedTable&) = delete;
+    ~FixedTable() { close(); }
+
+    // Write a table from records sorted by KeyCompare (strictly increasing) and open it.
+    static FixedTable build(const std::string& base_no_ext, std::span<const Record> sorted) {
+        typename Traits::KeyCompare less;
+        for (size_t i = 1; i < sorted.size(); ++i)
+            if (!less(sorted[i - 1].first, sorted[i].first))
+                throw std::invalid_argument("FixedTable keys must be strictly increasing");
+
+        std::string out;
+        out.reserve(sorted.size() * (Traits::kKeySize + Traits::kValueSize) + kFooterSize);
+        for (const Record& r : sorted) out.append(reinterpret_cast<const char*>(&r.first), Traits::kKeySize);
+        uint64_t values_offset = out.size();
+        bool any_deleted = false;
+        for (const Record& r : sorted) {
+            Value v = r.second ? *r.second : Value{};
+            out.append(reinterpret_cast<const char*>(&v), Traits::kValueSize);
+            any_deleted |= !r.second;
+        }
+        uint64_t bitmap_offset = 0;
+        if (any_deleted) {
+            bitmap_offset = out.size();
+            std::string bitmap((sorted.size() + 7) / 8, '\0');
+            for (size_t i = 0; i < sorted.size(); ++i)
+                if (!sorted[i].second) bitmap[i / 8] = (char)(bitmap[i / 8] | (1 << (i % 8)));
+            out += bitmap;
+        }
+        sst_format::put_u64(out, sorted.size());
+        sst_format::put_u32(out, (uint32_t)Traits::kKeySize);
+        sst_format::put_u32(out, (uint32_t)Traits::kValueSize);
+        sst_format::put_u64(out, values_offset);
+        sst_format::put_u64(out, bitmap_offset);
+        sst_format::put_u32(out, kVersion);
+        sst_format::put_u64(out, kMagic);
+
+        FixedTable t(base_no_ext);
+        int fd = ::open(t.path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+        if (fd < 0) throw std::runtime_error("open fixed table for write failed");
+        size_t done = 0;
+        while (done < out.size()) {
+            ssize_t w = ::write(fd, out.data() + done, out.size() - done);
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) { ::close(fd); throw std::runtime_error("write fixed table"); }
+            done += (size_t)w;
+        }
+        bool synced = ::fdatasync(fd) == 0;
+        ::close(fd);
+        if (!synced) throw std::runtime_error("fdatasync fixed table");
+        t.open();
+        return t;
+    }
+
+    // Write every entry of a memtable (tombstones included).
+    template <class Compare>
+    static FixedTable build(const std::string& base_no_ext, const FixedAVLTree<Key, Value, Compare>& tree) {
+        std::vector<Record> records;
+        records.reserve((size_t)tree.get_size());
+        tree.for_each([&](const auto& node) {
+            records.emplace_back(node.key, node.deleted ? std::nullopt : std::optional<Value>(node.value));
+        });
+        return build(base_no_ext, records);
+    }
+
+    // Map the file and check its footer against Traits.
+    void open() {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("open fixed table for read failed");
+        struct stat st{};
+        if (::fstat(fd, &st) != 0 || (size_t)st.st_size < kFooterSize) {
+            ::close(fd);
+            throw std::runtime_error("corrupt fixed table");
+        }
+        map_size = (size_t)st.st_size;
+        void* p = ::mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) { map_size = 0; throw std::runtime_error("mmap fixed table"); }
+        map_base = static_cast<const char*>(p);
+        ::madvise(p, map_size, MADV_RANDOM);
+
+        const char* f = map_base + map_size - kFooterSize;
+        uint64_t n = sst_format::get_u64(f);
+        uint32_t key_size = sst_format::get_u32(f + 8);
+        uint32_t value_size = sst_format::get_u32(f + 12);
+        uint64_t values_offset = sst_format::get_u64(f + 16);
+        uint64_t bitmap_offset = sst_format::get_u64(f + 24);
+        uint32_t version = sst_format::get_u32(f + 32);
+        uint64_t magic = sst_format::get_u64(f + 36);
+        uint64_t data_end = map_size - kFooterSize;
+        bool ok = magic == kMagic && version == kVersion && n <= data_end / Traits::kKeySize &&
+                  key_size == Traits::kKeySize &&
+                  value_size == Traits::kValueSize && values_offset == n * key_size &&
+                  values_offset + n * value_size <= data_end &&
+                  (bitmap_offset == 0 || (bitmap_offset == values_offset + n * value_size &&
+                                          bitmap_offset + (n + 7) / 8 <= data_end));
+        if (!ok) {
+            close();
+            throw std::runtime_error("not a fixed table of this key/value width");
+        }
+        count = (size_t)n;
+        values = map_base + values_offset;
+        tombstones = bitmap_offset ? map_base + bitmap_offset : nullptr;
+    }
+
+    void close() {
+        if (map_base) ::munmap(const_cast<char*>(map_base), map_size);
+        map_base = nullptr;
+        map_size = 0;
+        count = 0;
+        values = tombstones = nullptr;
+    }
+
+    [[nodiscard]] size_t size() const { return count; }
+
+    [[nodiscard]] Key key_at(size_t i) const {
+        Key k;
+        std::memcpy(&k, map_base + i * Traits::kKeySize, Traits::kKeySize);
+        return k;
+    }
+    [[nodiscard]] Value value_at(size_t i) const {
+        Value v;
+        std::memcpy(&v, values + i * Traits::kValueSize, Traits::kValueSize);
+        return v;
+    }
+    [[nodiscard]] bool deleted_at(size_t i) const { return tombstones && (tombstones[i / 8] >> (i % 8) & 1); }
+
+    // Position of the first key >= 'key' (size() if none). Branch-free halving:
+    // the loop runs log2(n) times whatever the keys, so it pipelines well.
+    [[nodiscard]] size_t lower_bound(const Key& key) const {
+        typename Traits::KeyCompare less;
+        size_t lo = 0, n = count;
+        while (n > 1) {
+            size_t half = n / 2;
+            lo = less(key_at(lo + half - 1), key) ? lo + half : lo;
+            n -= half;
+        }
+        return lo + (n == 1 && less(key_at(lo), key));
+    }
+
+    [[nodiscard]] LookupResult lookup(const Key& key, Value& value_out) const {
+        typename Traits::KeyCompare less;
+        size_t i = lower_bound(key);
+        if (i == count || less(key, key_at(i))) return LookupResult::NotFound;
+        if (deleted_at(i)) return LookupResult::Deleted;
+        value_out = value_at(i);
+        return LookupResult::Found;
+    }
+
+    // Visit live records with start <= key <= end in key order.
+    void scan(const Key& start, const Key& end, const std::function<void(const Key&, const Value&)>& visit) const {
+        typename Traits::KeyCompare less;
+        for (size_t i = lower_bound(start); i < count; ++i) {
+            Key k = key_at(i);
+            if (less(end, k)) break;
+            if (!deleted_at(i)) visit(k, value_at(i));
+        }
+    }
+
+private:
+    std::string path;
+    const char* map_base{nullptr};
+    size_t map_size{0};
+    size_t count{0};
+    const char* values{nullptr};
+    const char* tombstones{nullptr};
+};
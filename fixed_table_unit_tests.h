@@ -0,0 +1,124 @@
+#ifndef KVDATABASE_FIXED_TABLE_UNIT_TESTS_H
+#define KVDATABASE_FIXED_TABLE_UNIT_TESTS_H
+
+#include "fixed_avl_tree.h"
+#include "fixed_table.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using FixedValue16 = std::array<char, 16>;
+using U64Traits = FixedWidthTraits<uint64_t, FixedValue16>;
+
+inline FixedValue16 fixed_value(uint64_t i) {
+    FixedValue16 v{};
+    std::string s = "v" + std::to_string(i);
+    std::memcpy(v.data(), s.data(), std::min(s.size(), v.size()));
+    return v;
+}
+
+inline std::string fresh_fixed_base(const std::string& name) {
+    auto dir = std::filesystem::temp_directory_path() / "kvdb_fixed_tests";
+    std::filesystem::create_directories(dir);
+    auto base = dir / name;
+    std::filesystem::remove(base.string() + ".fxt");
+    return base.string();
+}
+
+void test_fixed_avl_tree() {
+    FixedAVLTree<uint64_t, FixedValue16> tree;
+    std::mt19937_64 rng(7);
+    std::vector<uint64_t> keys;
+    for (int i = 0; i < 5000; ++i) keys.push_back(rng() % 100000);
+    for (uint64_t k : keys) assert(tree.insert(k, fixed_value(k)));
+    assert(tree.insert(keys[0], fixed_value(1)));   // overwrite
+    assert(tree.insert_tombstone(keys[1]));
+
+    FixedValue16 v;
+    assert(tree.get(keys[0], v) == LookupResult::Found && v == fixed_value(1));
+    assert(tree.get(keys[1], v) == LookupResult::Deleted);
+    assert(tree.get(100001, v) == LookupResult::NotFound);
+
+    uint64_t prev = 0, n = 0;
+    tree.for_each([&](const auto& node) {
+        assert(n == 0 || node.key > prev);
+        prev = node.key;
+        ++n;
+    });
+    assert(n == (uint64_t)tree.get_size());
+
+    FixedAVLTree<uint64_t, uint64_t, std::greater<uint64_t>> desc(3);
+    assert(desc.insert(1, 10) && desc.insert(3, 30) && desc.insert(2, 20));
+    assert(desc.is_full() && !desc.insert(4, 40));
+    std::vector<uint64_t> order;
+    desc.for_each([&](const auto& node) { order.push_back(node.key); });
+    assert((order == std::vector<uint64_t>{3, 2, 1}));
+}
+
+void test_fixed_table_roundtrip() {
+    FixedAVLTree<uint64_t, FixedValue16> tree;
+    for (uint64_t k = 0; k < 20000; k += 2) tree.insert(k * 3, fixed_value(k));
+    for (uint64_t k = 0; k < 20000; k += 10) tree.insert_tombstone(k * 3);
+
+    std::string base = fresh_fixed_base("roundtrip");
+    {
+        FixedTable<U64Traits> t = FixedTable<U64Traits>::build(base, tree);
+        assert(t.size() == 10000);
+    }
+    FixedTable<U64Traits> t(base);
+    t.open();
+    FixedValue16 v;
+    for (uint64_t k = 0; k < 20000; ++k) {
+        LookupResult r = t.lookup(k * 3, v);
+        if (k % 10 == 0) assert(r == LookupResult::Deleted);
+        else if (k % 2 == 0) assert(r == LookupResult::Found && v == fixed_value(k));
+        else assert(r == LookupResult::NotFound);
+        assert(t.lookup(k * 3 + 1, v) == LookupResult::NotFound);
+    }
+    assert(t.lower_bound(0) == 0 && t.lower_bound(1) == 1 && t.lower_bound(UINT64_MAX) == t.size());
+
+    std::vector<uint64_t> seen;
+    t.scan(30, 90, [&](const uint64_t& k, const FixedValue16& val) {
+        assert(val == fixed_value(k / 3));
+        seen.push_back(k);
+    });
+    assert((seen == std::vector<uint64_t>{36, 42, 48, 54, 66, 72, 78, 84}));
+
+    // the footer records the widths: a table of other types is refused
+    bool threw = false;
+    try {
+        FixedTable<FixedWidthTraits<uint32_t, FixedValue16>> other(base);
+        other.open();
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    assert(threw);
+
+    std::vector<FixedTable<U64Traits>::Record> unsorted = {{5, fixed_value(5)}, {4, fixed_value(4)}};
+    threw = false;
+    try {
+        FixedTable<U64Traits>::build(fresh_fixed_base("unsorted"), unsorted);
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw);
+
+    FixedTable<U64Traits> empty = FixedTable<U64Traits>::build(fresh_fixed_base("empty"), {});
+    assert(empty.size() == 0 && empty.lookup(1, v) == LookupResult::NotFound);
+}
+
+void run_fixed_table_tests() {
+    test_fixed_avl_tree();
+    test_fixed_table_roundtrip();
+    std::cout << "✅ All fixed-width table tests passed!" << std::endl;
+}
+
+#endif
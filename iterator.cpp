@@ -0,0 +1,52 @@
+#include "iterator.h"
+#include <algorithm>
+
+MergingIterator::MergingIterator(std::vector<std::unique_ptr<Iterator>> children_)
+    : children(std::move(children_)) {
+    heap.reserve(children.size());
+    advance.reserve(children.size());
+}
+
+bool MergingIterator::after(size_t a, size_t b) const {
+    int c = children[a]->key().compare(children[b]->key());
+    return c > 0 || (c == 0 && a > b);
+}
+
+void MergingIterator::build_heap() {
+    heap.clear();
+    for (size_t i = 0; i < children.size(); ++i)
+        if (children[i]->valid()) heap.push_back(i);
+    std::make_heap(heap.begin(), heap.end(), [this](size_t a, size_t b) { return after(a, b); });
+}
+
+void MergingIterator::seek_to_first() {
+    for (auto& c : children) c->seek_to_first();
+    build_heap();
+}
+
+void MergingIterator::seek(std::string_view target) {
+    for (auto& c : children) c->seek(target);
+    build_heap();
+}
+
+// MergingIterator::next()
+// --------------------------------------------------------------------
+// Pop the top child and every older child sitting on the same key before
+// moving any of them (moving one invalidates the key it is compared with),
+// then advance them all and push back the ones that are still valid.
+void MergingIterator::next() {
+    auto cmp = [this](size_t a, size_t b) { return after(a, b); };
+    std::string_view current = key();
+    advance.clear();
+    while (!heap.empty() && children[heap.front()]->key() == current) {
+        std::pop_heap(heap.begin(), heap.end(), cmp);
+        advance.push_back(heap.back());
+        heap.pop_back();
+    }
+    for (size_t i : advance) {
+        children[i]->next();
+        if (!children[i]->valid()) continue;
+        heap.push_back(i);
+        std::push_heap(heap.begin(), heap.end(), cmp);
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+// Iterator: forward walk over one sorted source of records
+// ----------------------------------------
+// Implemented by the memtables (MemTable, AVLTree) and SSTable, and by
+// MergingIterator, which combines several of them. Tombstones are reported
+// (deleted() == true) so a merge can let them shadow older versions.
+//
+// A fresh iterator is unpositioned: call seek_to_first() or seek() first.
+// key() and value() may only be called while valid(), and the views they
+// return stay valid until the iterator moves.
+class Iterator {
+public:
+    virtual ~Iterator() = default;
+
+    virtual void seek_to_first() = 0;
+    // Position at the first key >= 'target'.
+    virtual void seek(std::string_view target) = 0;
+    virtual void next() = 0;
+
+    [[nodiscard]] virtual bool valid() const = 0;
+    [[nodiscard]] virtual std::string_view key() const = 0;
+    [[nodiscard]] virtual std::string_view value() const = 0;   // empty for a tombstone
+    [[nodiscard]] virtual bool deleted() const = 0;
+};
+
+// MergingIterator: k-way merge of sorted iterators
+// ----------------------------------------
+// Children are given newest first. A min-heap on (key, child index) keeps
+// the child holding the smallest key on top; when several children hold the
+// same key the newest one wins and the older copies are skipped, so every
+// key comes out once, with its newest value or tombstone.
+class MergingIterator : public Iterator {
+public:
+    explicit MergingIterator(std::vector<std::unique_ptr<Iterator>> children);
+
+    void seek_to_first() override;
+    void seek(std::string_view target) override;
+    void next() override;
+
+    [[nodiscard]] bool valid() const override { return !heap.empty(); }
+    [[nodiscard]] std::string_view key() const override { return children[heap.front()]->key(); }
+    [[nodiscard]] std::string_view value() const override { return children[heap.front()]->value(); }
+    [[nodiscard]] bool deleted() const override { return children[heap.front()]->deleted(); }
+
+private:
+    std::vector<std::unique_ptr<Iterator>> children;
+    std::vector<size_t> heap;      // indices of valid children, smallest (key, index) in front
+    std::vector<size_t> advance;   // scratch for next(): children sitting on the current key
+
+    // Heap order: true if child a should sit below child b.
+    [[nodiscard]] bool after(size_t a, size_t b) const;
+
+    void build_heap();
+};
@@ -0,0 +1,709 @@
+// kv_bench: db_bench / YCSB style benchmarks
+// ----------------------------------------
+// Runs a list of workloads against the in-memory AVLTree, a lone MemTable
+// (target "memtable", of type --memtable), a single SSTable, the whole
+// KVDatabase engine (memtables + SSTables together) and the hash-sharded
+// ShardedKVDatabase (target "sharded", --shards), and prints throughput and
+// p50/p99/p99.9 latency of each (target, workload) pair.
+//
+//   kv_bench --benchmarks=fillseq,readrandom --num=1000000 --threads=4 --targets=db
+//
+// Workloads:
+//   fillseq, fillrandom   start from an empty store; num writes in key order / at random keys
+//   overwrite             num writes at random existing keys
+//   readrandom            reads of random existing keys
+//   readmissing           reads of keys that sort between existing ones and are never present
+//   seekrandom            seek to a random key, then read the next --scan_length entries
+//   readwhilewriting      readrandom while one extra thread keeps writing (readers are measured)
+//   bulkload              start from an empty store; num records at random keys through the
+//                         target's bulk-load path from one thread (avl: sort + AVLTree::from_sorted,
+//                         db: BulkLoader + ingest()), timed until the store is readable
+//   ycsba .. ycsbf        YCSB core workloads over Zipfian-distributed keys:
+//                         A 50% read/50% update, B 95/5, C read only, D 95% read of recent
+//                         keys/5% insert, E 95% short scans/5% insert, F 50% read/50% read-modify-write
+//
+// Read workloads and YCSB load num sequential keys first (not timed) if the
+// store is empty. The SSTable target buffers writes in a sorted map and writes
+// the table when a fill ends (included in its time); it is read-only after
+// that, so workloads that write into a loaded store are skipped for it.
+#include "avl_tree.h"
+#include "memtable.h"
+#include "sstable.h"
+#include "sstable_writer.h"
+#include "kv_database.h"
+#include "sharded_database.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+
+struct BenchConfig {
+    std::string benchmarks = "fillseq,fillrandom,overwrite,readrandom,readmissing,seekrandom,readwhilewriting,"
+                             "ycsba,ycsbb,ycsbc,ycsbd,ycsbe,ycsbf";
+    std::string targets = "avl,sstable,db";
+    uint64_t num = 100000;          // entries written by fills and loaded before reads
+    uint64_t reads = 0;             // operations of non-fill workloads (0: num)
+    size_t key_size = 16;
+    size_t value_size = 100;
+    double compression_ratio = 0.5; // share of each value that is random (the rest repeats)
+    int threads = 1;
+    size_t memtable_bytes = 4u << 20;
+    MemTableType memtable_type = MemTableType::SkipList;
+    size_t cache_bytes = 0;         // KVDatabase buffer pool
+    size_t value_log = 0;           // KVDatabase: values at least this long go to the value log (0: off)
+    int scan_length = 10;
+    size_t scan_readahead = SSTable::Iterator::kDefaultReadahead;   // per-table read-ahead of scans (seeks grow up to it)
+    double zipf_theta = 0.99;
+    CompressionType compression = CompressionType::None;
+    SSTableReadMode read_mode = SSTableReadMode::Pread;
+    bool prefix_index = true;       // PrefixIndex search of SSTable indexes (0: std::lower_bound)
+    uint32_t index_page_size = 0;   // > 0: on-disk B+tree SSTable indexes with pages of this size
+    size_t shards = 0;              // ShardedKVDatabase shards (0: one per hardware thread)
+    WalSyncMode wal_sync = WalSyncMode::Interval;
+    std::string dir = (fs::temp_directory_path() / "kv_bench").string();
+    uint64_t seed = 301;
+    std::string stats = "none";     // engine stats dump after each target: none, text or json
+};
+
+// Key i as a fixed-width, zero-padded decimal so key order matches number order.
+static std::string make_key(uint64_t i, size_t key_size) {
+    std::string digits = std::to_string(i);
+    if (digits.size() > key_size) throw std::invalid_argument("key_size too small for --num");
+    return std::string(key_size - digits.size(), '0') + digits;
+}
+
+// Values cut from a pool in which every 100-byte piece is partly random and
+// partly repeated, so they compress to about compression_ratio (as db_bench does).
+class ValueGenerator {
+public:
+    ValueGenerator(double ratio, size_t value_size, uint64_t seed) {
+        std::mt19937_64 rng(seed);
+        size_t random_len = std::max<size_t>(1, (size_t)(100 * ratio));
+        while (pool.size() < std::max<size_t>(1 << 20, value_size * 2)) {
+            std::string piece;
+            for (size_t i = 0; i < random_len; ++i) piece.push_back((char)(' ' + rng() % 95));
+            while (piece.size() < 100) piece += piece.substr(0, std::min(random_len, 100 - piece.size()));
+            pool += piece;
+        }
+    }
+
+    std::string_view next(size_t len, uint64_t& pos) const {
+        if (pos + len > pool.size()) pos = 0;
+        std::string_view v(pool.data() + pos, len);
+        pos += len;
+        return v;
+    }
+
+private:
+    std::string pool;
+};
+
+// ZipfianGenerator: YCSB's generator (Gray et al., "Quickly generating
+// billion-record synthetic databases"): item 0 is the most popular.
+class ZipfianGenerator {
+public:
+    ZipfianGenerator(uint64_t items, double theta) : n(items), theta(theta) {
+        zetan = zeta(n);
+        double zeta2 = zeta(2);
+        alpha = 1.0 / (1.0 - theta);
+        eta = (1.0 - std::pow(2.0 / (double)n, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+    }
+
+    uint64_t next(std::mt19937_64& rng) const {
+        double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+        double uz = u * zetan;
+        if (uz < 1.0) return 0;
+        if (uz < 1.0 + std::pow(0.5, theta)) return 1;
+        return std::min<uint64_t>(n - 1, (uint64_t)((double)n * std::pow(eta * u - eta + 1.0, alpha)));
+    }
+
+    // Popular items scattered over the key space instead of clustered at 0.
+    uint64_t next_scrambled(std::mt19937_64& rng) const {
+        uint64_t v = next(rng), h = 0xcbf29ce484222325ull;
+        for (int i = 0; i < 8; ++i, v >>= 8) h = (h ^ (v & 0xFF)) * 0x100000001b3ull;
+        return h % n;
+    }
+
+private:
+    uint64_t n;
+    double theta, zetan, alpha, eta;
+
+    double zeta(uint64_t count) const {
+        double sum = 0;
+        for (uint64_t i = 1; i <= count; ++i) sum += 1.0 / std::pow((double)i, theta);
+        return sum;
+    }
+};
+
+// Target: one store under test.
+class Target {
+public:
+    virtual ~Target() = default;
+    [[nodiscard]] virtual const char* name() const = 0;
+    virtual void reset() = 0;                 // drop everything, start empty
+    virtual void put(const std::string& key, std::string_view value) = 0;
+    virtual void finish_writes() {}           // end of a fill
+    virtual bool get(const std::string& key, std::string& value) = 0;
+    virtual int seek_scan(const std::string& start, int n) = 0;   // entries read
+    [[nodiscard]] virtual bool writable_after_load() const { return true; }
+    // Bulk load (workload "bulkload"): reset, bulk_add() in any key order, finish_bulk_load().
+    [[nodiscard]] virtual bool can_bulk_load() const { return false; }
+    virtual void bulk_add(const std::string& /*key*/, std::string_view /*value*/) {}
+    virtual void finish_bulk_load() {}
+    // Engine counters and latencies since the last reset ("" if the target has none).
+    [[nodiscard]] virtual std::string stats_dump(bool /*json*/) const { return {}; }
+};
+
+class AvlTarget : public Target {
+public:
+    [[nodiscard]] const char* name() const override { return "avl"; }
+    void reset() override {
+        std::unique_lock lock(mu);
+        tree = AVLTree();
+    }
+    void put(const std::string& key, std::string_view value) override {
+        std::string v(value);
+        std::unique_lock lock(mu);
+        tree.insert(key, v);
+    }
+    bool get(const std::string& key, std::string& value) override {
+        std::shared_lock lock(mu);
+        return tree.get(key, value) == LookupResult::Found;
+    }
+    int seek_scan(const std::string& start, int n) override {
+        std::shared_lock lock(mu);
+        AVLTree::Iterator it = tree.iterator();
+        int seen = 0;
+        for (it.seek(start); it.valid() && seen < n; it.next()) ++seen;
+        return seen;
+    }
+    [[nodiscard]] bool can_bulk_load() const override { return true; }
+    void bulk_add(const std::string& key, std::string_view value) override {
+        pending.emplace_back(key, std::string(value));
+    }
+    void finish_bulk_load() override {
+        // stable: the last write of a key stays last among its equals
+        std::stable_sort(pending.begin(), pending.end(),
+                         [](const KVRecord& a, const KVRecord& b) { return a.first < b.first; });
+        std::vector<KVRecord> sorted;
+        sorted.reserve(pending.size());
+        for (size_t i = 0; i < pending.size(); ++i)
+            if (i + 1 == pending.size() || pending[i + 1].first != pending[i].first) sorted.push_back(std::move(pending[i]));
+        pending = {};
+        std::unique_lock lock(mu);
+        tree = AVLTree::from_sorted(sorted);
+    }
+
+private:
+    std::shared_mutex mu;   // AVLTree is not thread-safe
+    AVLTree tree;
+    std::vector<KVRecord> pending;   // bulk load input
+};
+
+// A MemTable without size limit: the engine's write buffer on its own.
+class MemTableTarget : public Target {
+public:
+    explicit MemTableTarget(const BenchConfig& c) : type(c.memtable_type) {}
+
+    [[nodiscard]] const char* name() const override { return "memtable"; }
+    void reset() override { table = std::make_unique<MemTable>(0, 0, type); }
+    void put(const std::string& key, std::string_view value) override {
+        table->add(key, &value, seq.fetch_add(1, std::memory_order_relaxed) + 1);
+    }
+    bool get(const std::string& key, std::string& value) override {
+        return table->get(key, value) == LookupResult::Found;
+    }
+    int seek_scan(const std::string& start, int n) override {
+        MemTable::Iterator it(*table);
+        int seen = 0;
+        for (it.seek(start); it.valid() && seen < n; it.next()) ++seen;
+        return seen;
+    }
+
+private:
+    MemTableType type;
+    std::unique_ptr<MemTable> table;
+    std::atomic<uint64_t> seq{0};
+};
+
+class SSTableTarget : public Target {
+public:
+    explicit SSTableTarget(const BenchConfig& c)
+        : base((fs::path(c.dir) / "bench_table").string())
+        , readahead(c.scan_readahead) {
+        options.compression = c.compression;
+        options.read_mode = c.read_mode;
+        options.prefix_index = c.prefix_index;
+        options.index_page_size = c.index_page_size;
+        options.sync_policy = SSTableSyncPolicy::None;
+    }
+    ~SSTableTarget() override { table.close(); }
+
+    [[nodiscard]] const char* name() const override { return "sstable"; }
+    void reset() override {
+        table.close();
+        pending.clear();
+    }
+    void put(const std::string& key, std::string_view value) override {
+        std::lock_guard lock(mu);
+        pending[key] = value;
+    }
+    void finish_writes() override {
+        table.close();
+        SSTableWriter w(base, options);
+        for (const auto& [k, v] : pending) w.add(k, v);
+        table = w.finish();
+    }
+    bool get(const std::string& key, std::string& value) override { return table.get(key, value); }
+    int seek_scan(const std::string& start, int n) override {
+        SSTable::Iterator it(table, readahead);
+        int seen = 0;
+        for (it.seek(start); it.valid() && seen < n; it.next()) ++seen;
+        return seen;
+    }
+    [[nodiscard]] bool writable_after_load() const override { return false; }
+
+private:
+    std::string base;
+    size_t readahead;
+    SSTableOptions options;
+    std::mutex mu;
+    std::map<std::string, std::string> pending;   // everything written so far
+    SSTable table;
+};
+
+class DbTarget : public Target {
+public:
+    explicit DbTarget(const BenchConfig& c) : dir((fs::path(c.dir) / "bench_db").string()), options(db_options(c)) {}
+
+    static KVOptions db_options(const BenchConfig& c) {
+        KVOptions options;
+        options.memtable_max_bytes = c.memtable_bytes;
+        options.memtable_type = c.memtable_type;
+        options.block_cache_bytes = c.cache_bytes;
+        options.value_log.min_value_size = c.value_log;
+        options.wal_sync_mode = c.wal_sync;
+        options.sstable.compression = c.compression;
+        options.sstable.read_mode = c.read_mode;
+        options.sstable.prefix_index = c.prefix_index;
+        options.sstable.index_page_size = c.index_page_size;
+        options.scan_readahead_bytes = c.scan_readahead;
+        return options;
+    }
+
+    [[nodiscard]] const char* name() const override { return "db"; }
+    void reset() override {
+        db.reset();
+        fs::remove_all(dir);
+        db = std::make_unique<KVDatabase>(dir, options);
+    }
+    void put(const std::string& key, std::string_view value) override { db->put(key, std::string(value)); }
+    bool get(const std::string& key, std::string& value) override { return db->get(key, value); }
+    int seek_scan(const std::string& start, int n) override {
+        auto it = db->iterator();
+        int seen = 0;
+        for (it->seek(start); it->valid() && seen < n; it->next()) ++seen;
+        return seen;
+    }
+    [[nodiscard]] bool can_bulk_load() const override { return true; }
+    void bulk_add(const std::string& key, std::string_view value) override {
+        if (!loader) loader = db->new_bulk_loader();
+        loader->add(key, value);
+    }
+    void finish_bulk_load() override {
+        if (!loader) return;
+        db->ingest(*loader);
+        loader.reset();
+    }
+    [[nodiscard]] std::string stats_dump(bool json) const override {
+        KVStats s = db->stats();
+        return json ? s.to_json() + "\n" : s.to_text();
+    }
+
+private:
+    std::string dir;
+    KVOptions options;
+    std::unique_ptr<KVDatabase> db;
+    std::unique_ptr<BulkLoader> loader;
+};
+
+class ShardedDbTarget : public Target {
+public:
+    explicit ShardedDbTarget(const BenchConfig& c)
+        : dir((fs::path(c.dir) / "bench_sharded").string()) {
+        options.shards = c.shards;
+        options.shard = DbTarget::db_options(c);
+    }
+
+    [[nodiscard]] const char* name() const override { return "sharded"; }
+    void reset() override {
+        db.reset();
+        fs::remove_all(dir);
+        db = std::make_unique<ShardedKVDatabase>(dir, options);
+    }
+    void put(const std::string& key, std::string_view value) override { db->put(key, std::string(value)); }
+    bool get(const std::string& key, std::string& value) override { return db->get(key, value); }
+    int seek_scan(const std::string& start, int n) override {
+        auto it = db->iterator();
+        int seen = 0;
+        for (it->seek(start); it->valid() && seen < n; it->next()) ++seen;
+        return seen;
+    }
+    [[nodiscard]] std::string stats_dump(bool json) const override {
+        KVStats s = db->stats();
+        return json ? s.to_json() + "\n" : s.to_text();
+    }
+
+private:
+    std::string dir;
+    ShardedKVOptions options;
+    std::unique_ptr<ShardedKVDatabase> db;
+};
+
+// Per-thread results; latencies in nanoseconds.
+struct ThreadStats {
+    std::vector<uint64_t> latencies;
+    uint64_t found = 0;
+};
+
+struct Result {
+    double seconds = 0;
+    uint64_t ops = 0;
+    int threads = 0;   // threads that shared the ops (0: --threads)
+    uint64_t found = 0;
+    std::vector<uint64_t> latencies;
+};
+
+class Benchmark {
+public:
+    explicit Benchmark(BenchConfig c) : cfg(std::move(c)), values(cfg.compression_ratio, cfg.value_size, cfg.seed) {}
+
+    void run() {
+        fs::create_directories(cfg.dir);
+        print_header();
+        for (const std::string& t : split(cfg.targets)) {
+            std::unique_ptr<Target> target;
+            if (t == "avl") target = std::make_unique<AvlTarget>();
+            else if (t == "memtable") target = std::make_unique<MemTableTarget>(cfg);
+            else if (t == "sstable") target = std::make_unique<SSTableTarget>(cfg);
+            else if (t == "db") target = std::make_unique<DbTarget>(cfg);
+            else if (t == "sharded") target = std::make_unique<ShardedDbTarget>(cfg);
+            else throw std::invalid_argument("unknown target: " + t);
+            target->reset();
+            loaded = 0;
+            for (const std::string& b : split(cfg.benchmarks)) run_one(*target, b);
+            if (cfg.stats != "none") {
+                std::string dump = target->stats_dump(cfg.stats == "json");
+                if (!dump.empty()) std::printf("\n%s stats:\n%s\n", target->name(), dump.c_str());
+            }
+        }
+        fs::remove_all(cfg.dir);
+    }
+
+private:
+    BenchConfig cfg;
+    ValueGenerator values;
+    uint64_t loaded = 0;              // keys [0, loaded) are present
+    std::atomic<uint64_t> next_insert{0};
+
+    static std::vector<std::string> split(const std::string& list) {
+        std::vector<std::string> out;
+        std::stringstream ss(list);
+        for (std::string item; std::getline(ss, item, ',');)
+            if (!item.empty()) out.push_back(item);
+        return out;
+    }
+
+    [[nodiscard]] uint64_t ops() const { return cfg.reads ? cfg.reads : cfg.num; }
+
+    void print_header() const {
+        std::printf("kv_bench: %llu entries, %zu-byte keys, %zu-byte values, %d thread(s), memtable %zu KiB, "
+                    "compression %s\n",
+                    (unsigned long long)cfg.num, cfg.key_size, cfg.value_size, cfg.threads, cfg.memtable_bytes >> 10,
+                    cfg.compression == CompressionType::LZ ? "lz" : "none");
+        std::printf("%-8s %-17s %10s %12s %9s %9s %9s  %s\n", "target", "benchmark", "micros/op", "ops/sec",
+                    "p50(us)", "p99(us)", "p99.9(us)", "note");
+    }
+
+    void load(Target& t) {
+        t.reset();
+        uint64_t pos = 0;
+        for (uint64_t i = 0; i < cfg.num; ++i) t.put(make_key(i, cfg.key_size), values.next(cfg.value_size, pos));
+        t.finish_writes();
+        loaded = cfg.num;
+    }
+
+    // Run 'op' count times on each of 'threads' threads (thread t, iteration i).
+    Result run_threads(int threads, uint64_t count, const std::function<bool(int, uint64_t, std::mt19937_64&)>& op) {
+        std::vector<ThreadStats> stats(threads);
+        std::vector<std::thread> pool;
+        auto start = Clock::now();
+        for (int t = 0; t < threads; ++t) {
+            pool.emplace_back([&, t] {
+                std::mt19937_64 rng(cfg.seed + 7919 * (uint64_t)t);
+                ThreadStats& s = stats[t];
+                s.latencies.reserve(count);
+                for (uint64_t i = 0; i < count; ++i) {
+                    auto t0 = Clock::now();
+                    bool found = op(t, i, rng);
+                    s.latencies.push_back((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        Clock::now() - t0).count());
+                    s.found += found;
+                }
+            });
+        }
+        for (auto& th : pool) th.join();
+        Result r;
+        r.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        for (auto& s : stats) {
+            r.latencies.insert(r.latencies.end(), s.latencies.begin(), s.latencies.end());
+            r.found += s.found;
+        }
+        r.ops = r.latencies.size();
+        return r;
+    }
+
+    void report(const Target& t, const std::string& bench, Result r, const std::string& note) const {
+        auto pct = [&](double p) {
+            if (r.latencies.empty()) return 0.0;
+            size_t k = std::min(r.latencies.size() - 1, (size_t)(p * (double)r.latencies.size()));
+            std::nth_element(r.latencies.begin(), r.latencies.begin() + (ptrdiff_t)k, r.latencies.end());
+            return (double)r.latencies[k] / 1000.0;
+        };
+        double micros = r.ops ? r.seconds * 1e6 / (double)r.ops * (r.threads ? r.threads : cfg.threads) : 0;
+        double p50 = pct(0.50), p99 = pct(0.99), p999 = pct(0.999);
+        std::printf("%-8s %-17s %10.3f %12.0f %9.2f %9.2f %9.2f  %s\n", t.name(), bench.c_str(), micros,
+                    r.seconds > 0 ? (double)r.ops / r.seconds : 0.0, p50, p99, p999, note.c_str());
+        std::fflush(stdout);
+    }
+
+    void skip(const Target& t, const std::string& bench, const char* why) const {
+        std::printf("%-8s %-17s %10s  (skipped: %s)\n", t.name(), bench.c_str(), "-", why);
+    }
+
+    std::string found_note(const Result& r) const {
+        return "(" + std::to_string(r.found) + " of " + std::to_string(r.ops) + " found)";
+    }
+
+    void run_one(Target& t, const std::string& bench) {
+        const int T = cfg.threads;
+        const uint64_t per_thread = std::max<uint64_t>(1, ops() / (uint64_t)T);
+        const uint64_t fill_per_thread = std::max<uint64_t>(1, cfg.num / (uint64_t)T);
+
+        if (bench == "fillseq" || bench == "fillrandom") {
+            t.reset();
+            bool seq = bench == "fillseq";
+            auto start = Clock::now();
+            Result r = run_threads(T, fill_per_thread, [&](int th, uint64_t i, std::mt19937_64& rng) {
+                thread_local uint64_t pos = 0;
+                uint64_t k = seq ? (uint64_t)th * fill_per_thread + i : rng() % cfg.num;
+                t.put(make_key(k, cfg.key_size), values.next(cfg.value_size, pos));
+                return false;
+            });
+            t.finish_writes();
+            r.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            loaded = seq ? fill_per_thread * (uint64_t)T : cfg.num;   // random fills leave gaps; reads report them
+            return report(t, bench, std::move(r), "");
+        }
+
+        if (bench == "bulkload") {
+            if (!t.can_bulk_load()) return skip(t, bench, "target has no bulk-load path");
+            t.reset();
+            std::mt19937_64 rng(cfg.seed);
+            uint64_t pos = 0;
+            auto start = Clock::now();
+            for (uint64_t i = 0; i < cfg.num; ++i)
+                t.bulk_add(make_key(rng() % cfg.num, cfg.key_size), values.next(cfg.value_size, pos));
+            t.finish_bulk_load();
+            Result r;
+            r.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            r.ops = cfg.num;
+            r.threads = 1;
+            loaded = cfg.num;
+            return report(t, bench, std::move(r), "(one loading thread, no per-op latencies)");
+        }
+
+        if (loaded == 0) load(t);
+        bool writes = bench == "overwrite" || bench == "readwhilewriting" || bench == "ycsba" || bench == "ycsbb" ||
+                      bench == "ycsbd" || bench == "ycsbe" || bench == "ycsbf";
+        if (writes && !t.writable_after_load()) return skip(t, bench, "target is read-only once loaded");
+
+        if (bench == "overwrite") {
+            Result r = run_threads(T, per_thread, [&](int, uint64_t, std::mt19937_64& rng) {
+                thread_local uint64_t pos = 0;
+                t.put(make_key(rng() % loaded, cfg.key_size), values.next(cfg.value_size, pos));
+                return false;
+            });
+            return report(t, bench, std::move(r), "");
+        }
+        if (bench == "readrandom" || bench == "readmissing") {
+            bool missing = bench == "readmissing";
+            Result r = run_threads(T, per_thread, [&](int, uint64_t, std::mt19937_64& rng) {
+                thread_local std::string v;
+                std::string key = make_key(rng() % loaded, cfg.key_size);
+                if (missing) key += '.';
+                return t.get(key, v);
+            });
+            std::string note = found_note(r);
+            return report(t, bench, std::move(r), note);
+        }
+        if (bench == "seekrandom") {
+            Result r = run_threads(T, per_thread, [&](int, uint64_t, std::mt19937_64& rng) {
+                return t.seek_scan(make_key(rng() % loaded, cfg.key_size), cfg.scan_length) > 0;
+            });
+            std::string note = found_note(r);
+            return report(t, bench, std::move(r), note);
+        }
+        if (bench == "readwhilewriting") {
+            std::atomic<bool> done{false};
+            std::thread writer([&] {
+                std::mt19937_64 rng(cfg.seed ^ 0x5eed);
+                uint64_t pos = 0;
+                while (!done.load(std::memory_order_relaxed))
+                    t.put(make_key(rng() % loaded, cfg.key_size), values.next(cfg.value_size, pos));
+            });
+            Result r = run_threads(T, per_thread, [&](int, uint64_t, std::mt19937_64& rng) {
+                thread_local std::string v;
+                return t.get(make_key(rng() % loaded, cfg.key_size), v);
+            });
+            done = true;
+            writer.join();
+            std::string note = found_note(r);
+            return report(t, bench, std::move(r), note);
+        }
+        if (bench.size() == 5 && bench.compare(0, 4, "ycsb") == 0 && bench[4] >= 'a' && bench[4] <= 'f')
+            return run_ycsb(t, bench, bench[4], per_thread);
+        throw std::invalid_argument("unknown benchmark: " + bench);
+    }
+
+    // YCSB core workloads: operation mix per workload letter, keys drawn from
+    // a scrambled Zipfian over the loaded records (D: skewed to the newest).
+    void run_ycsb(Target& t, const std::string& bench, char w, uint64_t per_thread) {
+        double read = 0, update = 0, insert = 0, scan = 0, rmw = 0;
+        switch (w) {
+            case 'a': read = 0.5; update = 0.5; break;
+            case 'b': read = 0.95; update = 0.05; break;
+            case 'c': read = 1.0; break;
+            case 'd': read = 0.95; insert = 0.05; break;
+            case 'e': scan = 0.95; insert = 0.05; break;
+            case 'f': read = 0.5; rmw = 0.5; break;
+        }
+        ZipfianGenerator zipf(loaded, cfg.zipf_theta);
+        next_insert = loaded;
+        const uint64_t base = loaded;
+        Result r = run_threads(cfg.threads, per_thread, [&](int, uint64_t, std::mt19937_64& rng) {
+            thread_local std::string v;
+            thread_local uint64_t pos = 0;
+            double dice = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+            uint64_t present = next_insert.load(std::memory_order_relaxed);
+            uint64_t k = w == 'd' ? present - 1 - std::min(present - 1, zipf.next(rng)) : zipf.next_scrambled(rng);
+            std::string key = make_key(k, cfg.key_size);
+            if ((dice -= read) < 0) return t.get(key, v);
+            if ((dice -= update) < 0) { t.put(key, values.next(cfg.value_size, pos)); return false; }
+            if ((dice -= scan) < 0) {
+                int len = 1 + (int)(rng() % 100);
+                return t.seek_scan(key, len) > 0;
+            }
+            if ((dice -= rmw) < 0) {
+                bool found = t.get(key, v);
+                t.put(key, values.next(cfg.value_size, pos));
+                return found;
+            }
+            (void)insert;
+            t.put(make_key(next_insert.fetch_add(1), cfg.key_size), values.next(cfg.value_size, pos));
+            return false;
+        });
+        loaded = std::max(loaded, next_insert.load());
+        std::string note = "(" + std::to_string(loaded - base) + " inserted)";
+        report(t, bench, std::move(r), w == 'd' || w == 'e' ? note : "");
+    }
+};
+
+static void usage() {
+    std::cerr << "usage: kv_bench [--benchmarks=a,b,...] [--targets=avl,memtable,sstable,db,sharded] [--num=N] [--reads=N]\n"
+                 "                [--key_size=N] [--value_size=N] [--compression_ratio=F] [--threads=N]\n"
+                 "                [--memtable_bytes=N] [--memtable=skiplist|btree] [--cache_bytes=N] [--value_log=N] [--scan_length=N] [--scan_readahead=N]\n"
+                 "                [--zipf_theta=F] [--compression=none|lz] [--read_mode=pread|mmap] [--wal_sync=write|batch|interval]\n"
+                 "                [--prefix_index=0|1] [--index_page_size=N] [--shards=N] [--dir=PATH] [--seed=N] [--stats=none|text|json]\n";
+}
+
+int main(int argc, char** argv) {
+    BenchConfig cfg;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            auto eq = arg.find('=');
+            if (arg.rfind("--", 0) != 0 || eq == std::string::npos) { usage(); return 2; }
+            std::string name = arg.substr(2, eq - 2), value = arg.substr(eq + 1);
+            if (name == "benchmarks") cfg.benchmarks = value;
+            else if (name == "targets") cfg.targets = value;
+            else if (name == "num") cfg.num = std::stoull(value);
+            else if (name == "reads") cfg.reads = std::stoull(value);
+            else if (name == "key_size") cfg.key_size = std::stoul(value);
+            else if (name == "value_size") cfg.value_size = std::stoul(value);
+            else if (name == "compression_ratio") cfg.compression_ratio = std::stod(value);
+            else if (name == "threads") cfg.threads = std::max(1, std::stoi(value));
+            else if (name == "memtable_bytes") cfg.memtable_bytes = std::stoull(value);
+            else if (name == "cache_bytes") cfg.cache_bytes = std::stoull(value);
+            else if (name == "value_log") cfg.value_log = std::stoull(value);
+            else if (name == "scan_length") cfg.scan_length = std::stoi(value);
+            else if (name == "scan_readahead") cfg.scan_readahead = std::stoull(value);
+            else if (name == "zipf_theta") cfg.zipf_theta = std::stod(value);
+            else if (name == "dir") cfg.dir = value;
+            else if (name == "seed") cfg.seed = std::stoull(value);
+            else if (name == "prefix_index") cfg.prefix_index = std::stoi(value) != 0;
+            else if (name == "shards") cfg.shards = std::stoull(value);
+            else if (name == "index_page_size") cfg.index_page_size = (uint32_t)std::stoul(value);
+            else if (name == "stats") {
+                if (value != "none" && value != "text" && value != "json")
+                    throw std::invalid_argument("--stats must be none, text or json");
+                cfg.stats = value;
+            }
+            else if (name == "compression") {
+                if (value == "lz") cfg.compression = CompressionType::LZ;
+                else if (value == "none") cfg.compression = CompressionType::None;
+                else throw std::invalid_argument("--compression must be none or lz");
+            } else if (name == "memtable") {
+                if (value == "skiplist") cfg.memtable_type = MemTableType::SkipList;
+                else if (value == "btree") cfg.memtable_type = MemTableType::BPlusTree;
+                else throw std::invalid_argument("--memtable must be skiplist or btree");
+            } else if (name == "read_mode") {
+                if (value == "mmap") cfg.read_mode = SSTableReadMode::Mmap;
+                else if (value == "pread") cfg.read_mode = SSTableReadMode::Pread;
+                else throw std::invalid_argument("--read_mode must be pread or mmap");
+            } else if (name == "wal_sync") {
+                if (value == "write") cfg.wal_sync = WalSyncMode::PerWrite;
+                else if (value == "batch") cfg.wal_sync = WalSyncMode::PerBatch;
+                else if (value == "interval") cfg.wal_sync = WalSyncMode::Interval;
+                else throw std::invalid_argument("--wal_sync must be write, batch or interval");
+            } else {
+                usage();
+                return 2;
+            }
+        }
+        if (cfg.num == 0) throw std::invalid_argument("--num must be positive");
+        Benchmark(cfg).run();
+    } catch (const std::exception& e) {
+        std::cerr << "kv_bench: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
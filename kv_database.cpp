@@ -0,0 +1,1074 @@
+#include "kv_database.h"
+#include "sstable_writer.h"
+#include <filesystem>
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <cstdio>
+#include <unistd.h>
+#include <fcntl.h>
+
+namespace fs = std::filesystem;
+
+// Parse "sst_000042.sst" -> 42. Returns 0 for anything that is not an SSTable data file.
+static uint64_t parse_table_number(const std::string& filename) {
+    const std::string prefix = "sst_", suffix = ".sst";
+    if (filename.size() <= prefix.size() + suffix.size()) return 0;
+    if (filename.compare(0, prefix.size(), prefix) != 0) return 0;
+    if (filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) != 0) return 0;
+    std::string digits = filename.substr(prefix.size(), filename.size() - prefix.size() - suffix.size());
+    if (digits.empty() || !std::all_of(digits.begin(), digits.end(), ::isdigit)) return 0;
+    return std::stoull(digits);
+}
+
+// Parse "wal_000042.log" -> 42 and the pre-rotation "wal.log" -> 0. Returns -1 otherwise.
+static int64_t parse_log_number(const std::string& filename) {
+    if (filename == "wal.log") return 0;
+    const std::string prefix = "wal_", suffix = ".log";
+    if (filename.size() <= prefix.size() + suffix.size()) return -1;
+    if (filename.compare(0, prefix.size(), prefix) != 0) return -1;
+    if (filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) != 0) return -1;
+    std::string digits = filename.substr(prefix.size(), filename.size() - prefix.size() - suffix.size());
+    if (digits.empty() || !std::all_of(digits.begin(), digits.end(), ::isdigit)) return -1;
+    return (int64_t)std::stoull(digits);
+}
+
+KVDatabase::KVDatabase(std::string dir_, KVOptions options_)
+    : dir(std::move(dir_))
+    , options(options_) {
+    if (options.memtable_max_entries < 0) throw std::invalid_argument("memtable_max_entries must not be negative");
+    if (options.memtable_max_entries == 0 && options.memtable_max_bytes == 0)
+        throw std::invalid_argument("memtable needs an entry or byte limit");
+    fs::create_directories(dir);
+    if (options.block_cache_bytes > 0 && !options.sstable.buffer_pool) {
+        BufferPoolOptions cache;
+        cache.capacity_bytes = options.block_cache_bytes;
+        cache.policy = options.block_cache_policy;
+        options.sstable.buffer_pool = std::make_shared<BufferPool>(cache);
+    }
+    if (options.decompressed_cache_bytes > 0 && !options.sstable.block_cache)
+        options.sstable.block_cache = std::make_shared<BlockCache>(options.decompressed_cache_bytes);
+    options.sstable.separated_values = options.value_log.min_value_size > 0;
+    if (options.sstable.separated_values || ValueLog::exists(dir))
+        vlog = std::make_unique<ValueLog>(dir, options.value_log);
+    load_tables();
+    mem.table = new_memtable();
+    recover_logs();
+
+    flush_thread = std::thread([this] { flush_loop(); });
+    if (options.compaction.style != CompactionStyle::None && options.compaction.background)
+        compaction_thread = std::thread([this] { compaction_loop(); });
+}
+
+KVDatabase::~KVDatabase() {
+    try {
+        flush();
+    } catch (...) {
+        // never throw from a destructor; unflushed writes stay in their logs
+    }
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        stopping = true;   // also cancels a merge in progress
+    }
+    flush_cv.notify_all();
+    compaction_cv.notify_all();
+    if (flush_thread.joinable()) flush_thread.join();
+    if (compaction_thread.joinable()) compaction_thread.join();
+
+    // a clean shutdown leaves no log behind
+    wal.reset();
+    if (mem.table->empty())
+        for (const auto& path : mem.logs) ::unlink(path.c_str());
+}
+
+std::shared_ptr<MemTable> KVDatabase::new_memtable() const {
+    return std::make_shared<MemTable>(options.memtable_max_bytes, (size_t)options.memtable_max_entries,
+                                      options.memtable_type);
+}
+
+std::string KVDatabase::table_base(uint64_t n) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "sst_%06llu", (unsigned long long)n);
+    return (fs::path(dir) / name).string();
+}
+
+std::string KVDatabase::log_path(uint64_t n) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "wal_%06llu.log", (unsigned long long)n);
+    return (fs::path(dir) / name).string();
+}
+
+void KVDatabase::load_tables() {
+    std::vector<uint64_t> on_disk;
+    std::vector<fs::path> bulk_dirs;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        std::string name = entry.path().filename().string();
+        if (entry.is_directory() && name.rfind("bulk_", 0) == 0 && entry.path().extension() == ".tmp")
+            bulk_dirs.push_back(entry.path());
+        if (!entry.is_regular_file()) continue;
+        uint64_t n = parse_table_number(entry.path().filename().string());
+        if (n != 0) on_disk.push_back(n);
+    }
+    // runs of a bulk load interrupted by a crash
+    for (const auto& p : bulk_dirs) fs::remove_all(p);
+    std::sort(on_disk.begin(), on_disk.end());
+    if (!on_disk.empty()) next_table_number = on_disk.back() + 1;
+    auto loaded = std::make_shared<LevelVector>(1);
+    levels = loaded;
+
+    std::ifstream manifest(fs::path(dir) / "MANIFEST");
+    if (!manifest) {
+        for (uint64_t n : on_disk) (*loaded)[0].push_back(open_table_file(n, table_base(n), options.sstable));
+        return;
+    }
+
+    std::set<uint64_t> live;
+    std::string line;
+    while (std::getline(manifest, line)) {
+        std::istringstream fields(line);
+        if (line.rfind("vlog ", 0) == 0) {
+            std::string tag;
+            uint64_t file, garbage;
+            if (fields >> tag >> file >> garbage && vlog) vlog->set_garbage(file, garbage);
+            continue;
+        }
+        size_t level;
+        uint64_t n;
+        if (!(fields >> level >> n)) break;
+        if (loaded->size() <= level) loaded->resize(level + 1);
+        (*loaded)[level].push_back(open_table_file(n, table_base(n), options.sstable));
+        live.insert(n);
+    }
+    // Outputs of an interrupted flush or compaction, or inputs of one that
+    // was installed but not yet cleaned up
+    for (uint64_t n : on_disk) {
+        if (live.count(n)) continue;
+        ::unlink((table_base(n) + ".sst").c_str());
+        ::unlink((table_base(n) + ".idx").c_str());
+    }
+}
+
+// Write MANIFEST.tmp, sync it and rename it over MANIFEST, so a crash leaves
+// either the old or the new table set.
+void KVDatabase::save_manifest_locked() {
+    std::string body;
+    for (size_t level = 0; level < levels->size(); ++level)
+        for (const auto& f : (*levels)[level])
+            body += std::to_string(level) + " " + std::to_string(f.number) + "\n";
+    if (vlog)
+        for (const auto& f : vlog->files())
+            if (f.garbage > 0) body += "vlog " + std::to_string(f.number) + " " + std::to_string(f.garbage) + "\n";
+
+    std::string path = (fs::path(dir) / "MANIFEST").string();
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (fd < 0) throw std::runtime_error("open manifest for write failed");
+    bool ok = ::write(fd, body.data(), body.size()) == (ssize_t)body.size() && ::fdatasync(fd) == 0;
+    ::close(fd);
+    if (!ok || ::rename(tmp.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        throw std::runtime_error("write manifest failed");
+    }
+    int dfd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dfd >= 0) { ::fsync(dfd); ::close(dfd); }
+}
+
+// Replay every leftover log, oldest first, into the memtable. Memtables that
+// fill up during replay are flushed right away, but the logs are only
+// deleted once everything they hold is in SSTables; until then they stay
+// attached to the last memtable, whose log (the newest) keeps receiving writes.
+void KVDatabase::recover_logs() {
+    std::vector<std::pair<int64_t, std::string>> found;
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        if (!entry.is_regular_file()) continue;
+        int64_t n = parse_log_number(entry.path().filename().string());
+        if (n < 0) continue;
+        found.emplace_back(n, entry.path().string());
+        next_log_number = std::max(next_log_number, (uint64_t)n + 1);
+    }
+    std::sort(found.begin(), found.end());
+
+    std::unique_lock<std::mutex> lock(mu);
+    std::vector<std::string> replayed;
+    std::shared_ptr<WriteAheadLog> last;
+    for (const auto& [n, path] : found) {
+        auto log = std::make_shared<WriteAheadLog>(path, options.wal_sync_mode, options.wal_sync_interval);
+        log->replay([&](const std::string& key, const std::string* value) {
+            if (mem.table->is_full()) {
+                freeze_memtable_locked();   // wal is still null: no new log
+                flush_oldest(lock);
+            }
+            std::string_view v = value ? std::string_view(*value) : std::string_view();
+            mem.table->add(key, value ? &v : nullptr, ++last_sequence);
+        });
+        replayed.push_back(path);
+        last = std::move(log);
+    }
+
+    if (mem.table->empty()) {
+        last.reset();
+        for (const auto& path : replayed) ::unlink(path.c_str());
+        replayed.clear();
+    }
+    if (last) {
+        wal = std::move(last);
+        mem.logs = std::move(replayed);
+    } else {
+        std::string path = log_path(next_log_number++);
+        wal = std::make_shared<WriteAheadLog>(path, options.wal_sync_mode, options.wal_sync_interval);
+        mem.logs = {path};
+    }
+}
+
+void KVDatabase::put(const std::string& key, const std::string& value) {
+    write(key, &value);
+}
+
+void KVDatabase::remove(const std::string& key) {
+    write(key, nullptr);
+}
+
+// KVDatabase::write()
+// --------------------------------------------------------------------
+// Under mu: make room, take a sequence number, append to the WAL buffer and
+// pin the memtable. The memtable insert and the wait for durability run
+// without the lock, so concurrent writers insert in parallel and share
+// group-commit syncs.
+void KVDatabase::write(const std::string& key, const std::string* value) {
+    LatencyTimer timer(timed(metrics.put));
+    (value ? metrics.puts : metrics.deletes).add();
+    metrics.bytes_written.add(key.size() + (value ? value->size() : 0));
+    std::unique_lock<std::mutex> lock(mu);
+    make_room(lock);
+    uint64_t seq = ++last_sequence;
+    std::shared_ptr<MemTable> table = mem.table;
+    std::shared_ptr<WriteAheadLog> log = wal;
+    uint64_t wal_seq = log->append(key, value);
+    table->begin_write();
+    lock.unlock();
+
+    {
+        struct WriteDone {
+            MemTable& m;
+            ~WriteDone() { m.end_write(); }
+        } done{*table};
+        std::string_view v = value ? std::string_view(*value) : std::string_view();
+        table->add(key, value ? &v : nullptr, seq);
+    }
+    LatencyTimer sync_timer(timed(metrics.wal_sync));
+    log->sync_to(wal_seq);
+}
+
+void KVDatabase::make_room(std::unique_lock<std::mutex>& lock) {
+    std::optional<LatencyTimer> stall;
+    while (mem.table->is_full()) {
+        if (flush_error) std::rethrow_exception(flush_error);
+        if (imm.size() < (size_t)std::max(options.max_immutable_memtables, 1)) {
+            freeze_memtable_locked();
+            return;
+        }
+        // too many memtables waiting for the flush thread: stall this writer
+        if (!stall) {
+            metrics.write_stalls.add();
+            stall.emplace(timed(metrics.write_stall));
+        }
+        flushed_cv.wait(lock);
+    }
+}
+
+void KVDatabase::freeze_memtable_locked() {
+    imm.push_back(std::move(mem));
+    mem = MemTableState{new_memtable(), {}};
+    if (wal) {
+        std::string path = log_path(next_log_number++);
+        wal = std::make_shared<WriteAheadLog>(path, options.wal_sync_mode, options.wal_sync_interval);
+        mem.logs.push_back(path);
+    }
+    flush_cv.notify_one();
+}
+
+void KVDatabase::flush_oldest(std::unique_lock<std::mutex>& lock) {
+    MemTableState state = imm.front();
+    uint64_t n = next_table_number++;
+    lock.unlock();
+    LatencyTimer timer(timed(metrics.flush));
+
+    std::optional<TableFile> file;
+    try {
+        // writers that picked this memtable before it was frozen finish first
+        state.table->wait_for_writers();
+        SSTableWriter writer(table_base(n), options.sstable);
+        std::string stored;
+        bool appended = false;
+        state.table->for_each([&](std::string_view key, const std::string_view* value) {
+            if (!value) {
+                writer.add_tombstone(key);
+            } else if (options.sstable.separated_values) {
+                appended |= separate_value(key, *value, stored);
+                writer.add(key, stored);
+            } else {
+                writer.add(key, *value);
+            }
+        });
+        if (writer.num_entries() > 0) file = make_table_file(n, writer.finish());
+        // the values must be durable before the table pointing at them is installed
+        if (appended) vlog->sync();
+    } catch (...) {
+        lock.lock();
+        throw;
+    }
+    lock.lock();
+
+    auto next = std::make_shared<LevelVector>(*levels);
+    if (file) {
+        metrics.flushes.add();
+        metrics.flush_bytes_written.add(file->file_size);
+        (*next)[0].push_back(std::move(*file));
+    }
+    levels = next;
+    save_manifest_locked();
+    imm.erase(imm.begin());
+    // Everything those logs hold is now in an SSTable
+    for (const auto& path : state.logs) ::unlink(path.c_str());
+    flushed_cv.notify_all();
+    compaction_cv.notify_all();
+}
+
+void KVDatabase::flush_loop() {
+    std::unique_lock<std::mutex> lock(mu);
+    for (;;) {
+        flush_cv.wait(lock, [&] { return stopping || !imm.empty(); });
+        if (imm.empty()) return;   // stopping, and nothing left to flush
+        try {
+            flush_oldest(lock);
+        } catch (...) {
+            flush_error = std::current_exception();
+            flushed_cv.notify_all();
+            return;
+        }
+    }
+}
+
+void KVDatabase::flush() {
+    std::unique_lock<std::mutex> lock(mu);
+    if (flush_error) std::rethrow_exception(flush_error);
+    if (!mem.table->empty()) freeze_memtable_locked();
+    flushed_cv.wait(lock, [&] { return imm.empty() || flush_error; });
+    if (flush_error) std::rethrow_exception(flush_error);
+}
+
+KVDatabase::ReadView KVDatabase::read_view() const {
+    std::lock_guard<std::mutex> lock(mu);
+    ReadView view;
+    view.mem = mem.table;
+    for (const auto& m : imm) view.imm.push_back(m.table);
+    view.levels = levels;
+    if (vlog) view.vlog_files = vlog->snapshot();
+    return view;
+}
+
+// Newest version of 'key' in the tables, as stored: level 0 newest to oldest,
+// then at most one table per deeper level. 'from' is set to the table that
+// settled it (Found or Deleted).
+static LookupResult lookup_tables(const LevelVector& levels, const std::string& key, std::string& value_out,
+                                  const TableFile*& from) {
+    for (auto it = levels[0].rbegin(); it != levels[0].rend(); ++it) {
+        LookupResult r = it->table->lookup(key, value_out);
+        if (r != LookupResult::NotFound) {
+            from = &*it;
+            return r;
+        }
+    }
+    for (size_t level = 1; level < levels.size(); ++level) {
+        const auto& files = levels[level];
+        auto it = std::lower_bound(files.begin(), files.end(), key,
+            [](const TableFile& f, const std::string& k) { return f.largest < k; });
+        if (it == files.end() || it->smallest > key) continue;
+        LookupResult r = it->table->lookup(key, value_out);
+        if (r != LookupResult::NotFound) {
+            from = &*it;
+            return r;
+        }
+    }
+    return LookupResult::NotFound;
+}
+
+bool KVDatabase::compact_once(std::unique_lock<std::mutex>& lock) {
+    compaction_cv.wait(lock, [&] { return !compacting; });
+    std::optional<CompactionJob> job = pick_compaction(*levels, options.compaction);
+    if (!job) return false;
+
+    compacting = true;
+    lock.unlock();
+    LatencyTimer timer(timed(metrics.compaction));
+    CompactionResult result;
+    std::map<uint64_t, uint64_t> dropped;   // value log file -> bytes of the pointers the merge dropped
+    bool appended = false;
+    set_value_hooks(*job, dropped, appended);
+    try {
+        result = run_compaction(*job, options.compaction, options.sstable, [&] {
+            std::lock_guard<std::mutex> guard(mu);
+            uint64_t n = next_table_number++;
+            return std::make_pair(n, table_base(n));
+        }, &stopping);
+        if (appended && !result.cancelled) vlog->sync();
+    } catch (...) {
+        lock.lock();
+        compacting = false;
+        compaction_cv.notify_all();
+        throw;
+    }
+    lock.lock();
+    compacting = false;
+    compaction_cv.notify_all();
+    if (result.cancelled) return false;
+
+    auto next = std::make_shared<LevelVector>(*levels);
+    install_compaction(*next, *job, result.outputs);
+    levels = next;
+    for (const auto& [file, bytes] : dropped) vlog->add_garbage(file, bytes);
+    save_manifest_locked();
+    // Readers holding an older view keep the inputs open until they are done
+    for (auto& in : job->inputs) {
+        retired.bloom_checks += in.table->stats.filter_checks.load();
+        retired.bloom_negatives += in.table->stats.filter_negatives.load();
+        retired.bloom_false_positives += in.table->stats.filter_false_positives.load();
+        retired.table_lookups += in.table->stats.lookups.load();
+        retired.table_blocks_read += in.table->stats.blocks_read.load();
+        retired.table_bytes_read += in.table->stats.bytes_read.load();
+        retired.table_read_syscalls += in.table->stats.read_syscalls.load();
+        delete_table_file(in);
+    }
+    ++retired.compactions;
+    retired.compaction_bytes_read += result.bytes_read;
+    retired.compaction_bytes_written += result.bytes_written;
+    return true;
+}
+
+std::unique_ptr<BulkLoader> KVDatabase::new_bulk_loader(BulkLoadOptions bulk) {
+    uint64_t n;
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        n = next_bulk_number++;
+    }
+    char name[32];
+    std::snprintf(name, sizeof(name), "bulk_%06llu.tmp", (unsigned long long)n);
+    if (options.compaction.style == CompactionStyle::Leveled)
+        bulk.target_file_size = options.compaction.target_file_size;
+    // loaded values stay in the tables; compactions move the large ones to the value log
+    SSTableOptions sstable = options.sstable;
+    sstable.separated_values = false;
+    return std::make_unique<BulkLoader>((fs::path(dir) / name).string(), sstable, bulk);
+}
+
+BulkLoadResult KVDatabase::ingest(BulkLoader& loader) {
+    flush();
+    BulkLoadResult result = loader.finish([&] {
+        std::lock_guard<std::mutex> guard(mu);
+        uint64_t n = next_table_number++;
+        return std::make_pair(n, table_base(n));
+    });
+
+    std::unique_lock<std::mutex> lock(mu);
+    // a merge picked before the install could otherwise put older data
+    // into a level the ingested tables were placed in
+    compaction_cv.wait(lock, [&] { return !compacting; });
+    auto next = std::make_shared<LevelVector>(*levels);
+    install_ingested(*next, result.outputs, options.compaction);
+    levels = next;
+    save_manifest_locked();
+    retired.ingested_tables += result.outputs.size();
+    retired.ingest_bytes_written += result.bytes_written;
+    compaction_cv.notify_all();
+    return result;
+}
+
+void KVDatabase::compaction_loop() {
+    std::unique_lock<std::mutex> lock(mu);
+    while (!stopping) {
+        bool did = false;
+        try {
+            did = compact_once(lock) || collect_once(lock);
+        } catch (...) {
+            compaction_error = std::current_exception();
+            return;
+        }
+        if (!did && !stopping) compaction_cv.wait(lock);
+    }
+}
+
+void KVDatabase::compact() {
+    std::unique_lock<std::mutex> lock(mu);
+    if (compaction_error) std::rethrow_exception(compaction_error);
+    while (compact_once(lock)) {}
+}
+
+bool KVDatabase::separate_value(std::string_view key, std::string_view value, std::string& out) {
+    if (value.size() < options.value_log.min_value_size) {
+        encode_inline_value(out, value);
+        return false;
+    }
+    encode_value_pointer(out, vlog->append(key, value));
+    return true;
+}
+
+void KVDatabase::resolve_value(const SSTable& table, std::string& value, const ReadView& view) const {
+    if (!table.separated_values) return;
+    std::string_view inline_value;
+    ValuePointer p;
+    if (!decode_separated_value(value, inline_value, p)) {
+        value.erase(0, 1);
+        return;
+    }
+    if (!view.vlog_files) throw std::runtime_error("value log missing");
+    vlog->read(*view.vlog_files, p, value);
+}
+
+// Values keep their form when input and output agree; otherwise they are
+// separated (a table from before separation was turned on, or a bulk load)
+// or put back inline (separation turned off). Inline values of separated
+// tables that have grown past min_value_size move to the log as well.
+void KVDatabase::set_value_hooks(CompactionJob& job, std::map<uint64_t, uint64_t>& dropped, bool& appended) {
+    if (!vlog) return;
+    job.convert_value = [this, &dropped, &appended](const SSTable& input, std::string_view key,
+                                                    std::string_view value, std::string& out) {
+        bool separate = options.sstable.separated_values;
+        if (!input.separated_values) {
+            if (!separate) return false;
+            appended |= separate_value(key, value, out);
+            return true;
+        }
+        std::string_view inline_value;
+        ValuePointer p;
+        bool pointer = decode_separated_value(value, inline_value, p);
+        if (!separate) {
+            if (!pointer) {
+                out.assign(inline_value);
+                return true;
+            }
+            vlog->read(p, out);
+            dropped[p.file] += p.size;   // back inline: the log copy is dead
+            return true;
+        }
+        if (pointer || inline_value.size() < options.value_log.min_value_size) return false;
+        appended |= separate_value(key, inline_value, out);
+        return true;
+    };
+    job.on_discard = [&dropped](const SSTable& input, std::string_view value) {
+        std::string_view inline_value;
+        ValuePointer p;
+        if (input.separated_values && decode_separated_value(value, inline_value, p)) dropped[p.file] += p.size;
+    };
+}
+
+// KVDatabase::collect_once()
+// --------------------------------------------------------------------
+// A value in the victim file is live if the newest version of its key in
+// the tables is a pointer to it (a newer version still in a memtable leaves
+// it live until flushed; the next collection of wherever it moved finds it
+// dead). Live values are appended to the log again and their new pointers
+// written to one table - or, with separation turned off, the values
+// themselves, in a plain table like any other it writes now. Like a compaction, this holds 'compacting', so the
+// only change to the levels meanwhile is flushes appending to level 0: the
+// table goes into level 0 right after the tables the snapshot had - newer
+// than every version it was checked against, older than anything since.
+// Those flushes must not point into the victim: a flush that was already
+// writing when it was sealed could, so nothing is collected while one is
+// queued (its end wakes the compaction thread again).
+bool KVDatabase::collect_once(std::unique_lock<std::mutex>& lock) {
+    if (!vlog) return false;
+    compaction_cv.wait(lock, [&] { return !compacting; });
+    if (!imm.empty()) return false;
+    uint64_t victim = vlog->pick_for_collection();
+    if (victim == 0) return false;
+
+    compacting = true;
+    std::shared_ptr<const LevelVector> snapshot = levels;
+    uint64_t n = next_table_number++;
+    lock.unlock();
+
+    std::optional<TableFile> file;
+    uint64_t rewritten = 0;
+    bool cancelled = false;
+    try {
+        std::vector<std::pair<std::string, std::string>> moved;   // key -> new pointer, or the value
+        bool separate = options.sstable.separated_values;
+        std::string stored, value;
+        vlog->for_each_record(victim, [&](std::string_view key, const ValuePointer& p) {
+            if (cancelled || (cancelled = stopping.load())) return;
+            std::string k(key);
+            const TableFile* from = nullptr;
+            if (lookup_tables(*snapshot, k, stored, from) != LookupResult::Found || !from->table->separated_values)
+                return;
+            std::string_view inline_value;
+            ValuePointer current;
+            if (!decode_separated_value(stored, inline_value, current) || current != p) return;
+            vlog->read(p, value);
+            rewritten += value.size();
+            if (!separate) {
+                moved.emplace_back(std::move(k), std::move(value));
+                return;
+            }
+            moved.emplace_back(std::move(k), std::string());
+            encode_value_pointer(moved.back().second, vlog->append(key, value));
+        });
+        if (!cancelled && !moved.empty()) {
+            std::sort(moved.begin(), moved.end());
+            if (separate) vlog->sync();
+            SSTableWriter writer(table_base(n), options.sstable);
+            for (const auto& [k, v] : moved) writer.add(k, v);
+            file = make_table_file(n, writer.finish());
+        }
+    } catch (...) {
+        lock.lock();
+        compacting = false;
+        compaction_cv.notify_all();
+        throw;
+    }
+    lock.lock();
+    compacting = false;
+    compaction_cv.notify_all();
+    if (cancelled) return false;
+
+    if (file) {
+        auto next = std::make_shared<LevelVector>(*levels);
+        auto& level0 = (*next)[0];
+        level0.insert(level0.begin() + (std::ptrdiff_t)(*snapshot)[0].size(), std::move(*file));
+        levels = next;
+    }
+    // the new pointers are in the MANIFEST before the old values go
+    save_manifest_locked();
+    vlog->remove_file(victim);
+    ++retired.value_log_gc_files;
+    retired.value_log_gc_bytes_rewritten += rewritten;
+    return true;
+}
+
+size_t KVDatabase::collect_garbage() {
+    std::unique_lock<std::mutex> lock(mu);
+    if (compaction_error) std::rethrow_exception(compaction_error);
+    flushed_cv.wait(lock, [&] { return imm.empty() || flush_error; });
+    if (flush_error) std::rethrow_exception(flush_error);
+    size_t collected = 0;
+    while (collect_once(lock)) ++collected;
+    return collected;
+}
+
+bool KVDatabase::get(const std::string& key, std::string& value_out) const {
+    LatencyTimer timer(timed(metrics.get));
+    metrics.gets.add();
+    bool hit = get_impl(key, value_out);
+    if (hit) metrics.get_hits.add();
+    return hit;
+}
+
+bool KVDatabase::get_impl(const std::string& key, std::string& value_out) const {
+    ReadView view = read_view();
+
+    auto found = [&](LookupResult r) { return r != LookupResult::NotFound; };
+    LookupResult r = view.mem->get(key, value_out);
+    // frozen memtables newest first
+    for (auto it = view.imm.rbegin(); !found(r) && it != view.imm.rend(); ++it) r = (*it)->get(key, value_out);
+    if (found(r)) return r == LookupResult::Found;
+
+    const TableFile* from = nullptr;
+    if (lookup_tables(*view.levels, key, value_out, from) != LookupResult::Found) return false;
+    resolve_value(*from->table, value_out, view);
+    return true;
+}
+
+// KVDatabase::multi_get()
+// --------------------------------------------------------------------
+// Same layer order as get(). 'pending' holds the keys no layer has settled
+// yet, sorted, so every level-0 table gets them as one batch and a deeper
+// level hands each of its tables the run of keys inside that table's range.
+std::vector<std::optional<std::string>> KVDatabase::multi_get(std::span<const std::string> keys) const {
+    LatencyTimer timer(timed(metrics.multi_get));
+    metrics.multi_get_keys.add(keys.size());
+    ReadView view = read_view();
+    std::vector<std::optional<std::string>> out(keys.size());
+
+    std::vector<size_t> pending;
+    std::string v;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        LookupResult r = view.mem->get(keys[i], v);
+        for (auto it = view.imm.rbegin(); r == LookupResult::NotFound && it != view.imm.rend(); ++it)
+            r = (*it)->get(keys[i], v);
+        if (r == LookupResult::Found) out[i] = v;
+        else if (r == LookupResult::NotFound) pending.push_back(i);
+    }
+    std::sort(pending.begin(), pending.end(), [&](size_t a, size_t b) { return keys[a] < keys[b]; });
+
+    // Look pending[from, to) up in one table; settled keys are marked with SIZE_MAX.
+    std::vector<std::string_view> batch;
+    std::vector<std::string> values;
+    auto probe = [&](const TableFile& f, size_t from, size_t to) {
+        batch.clear();
+        for (size_t p = from; p < to; ++p) batch.push_back(keys[pending[p]]);
+        std::vector<LookupResult> res = f.table->multi_get(std::span<const std::string_view>(batch), values);
+        for (size_t p = from; p < to; ++p) {
+            if (res[p - from] == LookupResult::NotFound) continue;
+            if (res[p - from] == LookupResult::Found) {
+                out[pending[p]] = std::move(values[p - from]);
+                resolve_value(*f.table, *out[pending[p]], view);
+            }
+            pending[p] = SIZE_MAX;
+        }
+    };
+    auto drop_settled = [&] { std::erase(pending, SIZE_MAX); };
+    auto key_at = [&](size_t p) -> const std::string& { return keys[pending[p]]; };
+
+    const LevelVector& levels = *view.levels;
+    for (auto it = levels[0].rbegin(); it != levels[0].rend() && !pending.empty(); ++it) {
+        auto lo = std::lower_bound(pending.begin(), pending.end(), it->smallest,
+            [&](size_t i, const std::string& k) { return keys[i] < k; });
+        auto hi = std::upper_bound(lo, pending.end(), it->largest,
+            [&](const std::string& k, size_t i) { return k < keys[i]; });
+        if (lo == hi) continue;
+        probe(*it, (size_t)(lo - pending.begin()), (size_t)(hi - pending.begin()));
+        drop_settled();
+    }
+    for (size_t level = 1; level < levels.size() && !pending.empty(); ++level) {
+        const auto& files = levels[level];
+        size_t p = 0;
+        for (const auto& f : files) {
+            while (p < pending.size() && key_at(p) < f.smallest) ++p;
+            size_t from = p;
+            while (p < pending.size() && key_at(p) <= f.largest) ++p;
+            if (p > from) probe(f, from, p);
+        }
+        drop_settled();
+    }
+    return out;
+}
+
+// KVDatabase::DBIterator
+// --------------------------------------------------------------------
+// MergingIterator over, newest first: the memtable, the frozen memtables,
+// level 0 newest to oldest, then one LevelIterator per deeper level. The
+// merge already picks the newest version of each key; this only steps over
+// the keys whose newest version is a tombstone. Holds the ReadView so the
+// memtables, tables and value log files stay alive. Tables with separated
+// values are wrapped in a SeparatedValueIterator.
+class KVDatabase::DBIterator : public Iterator {
+public:
+    DBIterator(ReadView view_, size_t readahead, const ValueLog* log) : view(std::move(view_)) {
+        std::vector<std::unique_ptr<Iterator>> children;
+        children.push_back(std::make_unique<MemTable::Iterator>(*view.mem));
+        for (auto it = view.imm.rbegin(); it != view.imm.rend(); ++it)
+            children.push_back(std::make_unique<MemTable::Iterator>(**it));
+        TableIteratorFactory open = [log, files = view.vlog_files, readahead](const TableFile& f) {
+            std::unique_ptr<Iterator> it = std::make_unique<SSTable::Iterator>(*f.table, readahead);
+            if (f.table->separated_values) it = std::make_unique<SeparatedValueIterator>(std::move(it), log, files);
+            return it;
+        };
+        const LevelVector& levels = *view.levels;
+        for (auto it = levels[0].rbegin(); it != levels[0].rend(); ++it) children.push_back(open(*it));
+        for (size_t level = 1; level < levels.size(); ++level)
+            if (!levels[level].empty()) children.push_back(new_level_iterator(levels[level], readahead, open));
+        merged = std::make_unique<MergingIterator>(std::move(children));
+    }
+
+    void seek_to_first() override { merged->seek_to_first(); skip_deleted(); }
+    void seek(std::string_view target) override { merged->seek(target); skip_deleted(); }
+    void next() override { merged->next(); skip_deleted(); }
+
+    [[nodiscard]] bool valid() const override { return merged->valid(); }
+    [[nodiscard]] std::string_view key() const override { return merged->key(); }
+    [[nodiscard]] std::string_view value() const override { return merged->value(); }
+    [[nodiscard]] bool deleted() const override { return false; }
+
+private:
+    ReadView view;
+    std::unique_ptr<MergingIterator> merged;
+
+    void skip_deleted() {
+        while (merged->valid() && merged->deleted()) merged->next();
+    }
+};
+
+std::unique_ptr<Iterator> KVDatabase::iterator() const {
+    metrics.scans.add();
+    return std::make_unique<DBIterator>(read_view(), options.scan_readahead_bytes, vlog.get());
+}
+
+void KVDatabase::scan(const std::string& start, const std::string& end,
+                      const std::function<void(const std::string&, const std::string&)>& visit) const {
+    LatencyTimer timer(timed(metrics.scan));
+    std::unique_ptr<Iterator> it = iterator();
+    std::string k, v;
+    for (it->seek(start); it->valid() && it->key() <= end; it->next()) {
+        k.assign(it->key());
+        v.assign(it->value());
+        visit(k, v);
+    }
+}
+
+size_t KVDatabase::sstable_count() const {
+    std::lock_guard<std::mutex> lock(mu);
+    size_t n = 0;
+    for (const auto& level : *levels) n += level.size();
+    return n;
+}
+
+std::vector<size_t> KVDatabase::tables_per_level() const {
+    std::lock_guard<std::mutex> lock(mu);
+    std::vector<size_t> counts;
+    for (const auto& level : *levels) counts.push_back(level.size());
+    return counts;
+}
+
+KVStats KVDatabase::stats() const {
+    std::unique_lock<std::mutex> lock(mu);
+    KVStats s = retired;
+    s.memtable_bytes = mem.table->memory_usage();
+    s.immutable_memtables = imm.size();
+    std::shared_ptr<const LevelVector> live = levels;
+    lock.unlock();
+
+    for (size_t level = 0; level < live->size(); ++level) {
+        for (const auto& f : (*live)[level]) {
+            const SSTableStats& t = f.table->stats;
+            KVTableStats ts;
+            ts.level = level;
+            ts.number = f.number;
+            ts.file_size = f.file_size;
+            ts.entries = f.table->num_entries;
+            ts.lookups = t.lookups.load();
+            ts.blocks_read = t.blocks_read.load();
+            ts.bytes_read = t.bytes_read.load();
+            ts.read_syscalls = t.read_syscalls.load();
+            ts.filter_checks = t.filter_checks.load();
+            ts.filter_negatives = t.filter_negatives.load();
+            ts.filter_false_positives = t.filter_false_positives.load();
+            s.bloom_checks += ts.filter_checks;
+            s.bloom_negatives += ts.filter_negatives;
+            s.bloom_false_positives += ts.filter_false_positives;
+            s.table_lookups += ts.lookups;
+            s.table_blocks_read += ts.blocks_read;
+            s.table_bytes_read += ts.bytes_read;
+            s.table_read_syscalls += ts.read_syscalls;
+            s.tables.push_back(ts);
+        }
+    }
+    uint64_t absent = s.bloom_negatives + s.bloom_false_positives;
+    s.bloom_false_positive_rate = absent == 0 ? 0.0 : (double)s.bloom_false_positives / (double)absent;
+    if (options.sstable.buffer_pool) {
+        BufferPoolStats cache = options.sstable.buffer_pool->stats();
+        s.cache_hits = cache.hits;
+        s.cache_misses = cache.misses;
+        s.cache_evictions = cache.evictions;
+        s.cache_hit_rate = cache.hit_rate();
+    }
+    if (vlog) {
+        s.value_log_bytes_written = vlog->bytes_written();
+        s.value_log_reads = vlog->reads();
+        for (const auto& f : vlog->files()) {
+            ++s.value_log_files;
+            s.value_log_bytes += f.size;
+            s.value_log_garbage_bytes += f.garbage;
+        }
+    }
+    if (options.sstable.block_cache) {
+        BufferPoolStats blocks = options.sstable.block_cache->stats();
+        s.decompressed_cache_hits = blocks.hits;
+        s.decompressed_cache_misses = blocks.misses;
+    }
+
+    s.puts = metrics.puts.load();
+    s.deletes = metrics.deletes.load();
+    s.bytes_written = metrics.bytes_written.load();
+    s.gets = metrics.gets.load();
+    s.get_hits = metrics.get_hits.load();
+    s.multi_get_keys = metrics.multi_get_keys.load();
+    s.scans = metrics.scans.load();
+    s.write_stalls = metrics.write_stalls.load();
+    s.flushes = metrics.flushes.load();
+    s.flush_bytes_written = metrics.flush_bytes_written.load();
+    s.put_latency = metrics.put.snapshot();
+    s.wal_sync_latency = metrics.wal_sync.snapshot();
+    s.write_stall_latency = metrics.write_stall.snapshot();
+    s.get_latency = metrics.get.snapshot();
+    s.multi_get_latency = metrics.multi_get.snapshot();
+    s.scan_latency = metrics.scan.snapshot();
+    s.flush_latency = metrics.flush.snapshot();
+    s.compaction_latency = metrics.compaction.snapshot();
+    return s;
+}
+
+// Name and value of every scalar counter, in dump order.
+static std::vector<std::pair<const char*, uint64_t>> stat_counters(const KVStats& s) {
+    return {
+        {"puts", s.puts}, {"deletes", s.deletes}, {"bytes_written", s.bytes_written},
+        {"gets", s.gets}, {"get_hits", s.get_hits}, {"multi_get_keys", s.multi_get_keys}, {"scans", s.scans},
+        {"write_stalls", s.write_stalls}, {"memtable_bytes", s.memtable_bytes},
+        {"immutable_memtables", s.immutable_memtables},
+        {"flushes", s.flushes}, {"flush_bytes_written", s.flush_bytes_written},
+        {"compactions", s.compactions}, {"compaction_bytes_read", s.compaction_bytes_read},
+        {"compaction_bytes_written", s.compaction_bytes_written},
+        {"ingested_tables", s.ingested_tables}, {"ingest_bytes_written", s.ingest_bytes_written},
+        {"value_log_bytes_written", s.value_log_bytes_written}, {"value_log_reads", s.value_log_reads},
+        {"value_log_files", s.value_log_files}, {"value_log_bytes", s.value_log_bytes},
+        {"value_log_garbage_bytes", s.value_log_garbage_bytes}, {"value_log_gc_files", s.value_log_gc_files},
+        {"value_log_gc_bytes_rewritten", s.value_log_gc_bytes_rewritten},
+        {"table_lookups", s.table_lookups}, {"table_blocks_read", s.table_blocks_read},
+        {"table_bytes_read", s.table_bytes_read}, {"table_read_syscalls", s.table_read_syscalls},
+        {"bloom_checks", s.bloom_checks}, {"bloom_negatives", s.bloom_negatives},
+        {"bloom_false_positives", s.bloom_false_positives},
+        {"cache_hits", s.cache_hits}, {"cache_misses", s.cache_misses}, {"cache_evictions", s.cache_evictions},
+        {"decompressed_cache_hits", s.decompressed_cache_hits},
+        {"decompressed_cache_misses", s.decompressed_cache_misses},
+    };
+}
+
+static std::vector<std::pair<const char*, const HistogramSnapshot*>> stat_latencies(const KVStats& s) {
+    return {
+        {"put", &s.put_latency}, {"wal_sync", &s.wal_sync_latency}, {"write_stall", &s.write_stall_latency},
+        {"get", &s.get_latency}, {"multi_get", &s.multi_get_latency}, {"scan", &s.scan_latency},
+        {"flush", &s.flush_latency}, {"compaction", &s.compaction_latency},
+    };
+}
+
+static double hit_rate(uint64_t hits, uint64_t misses) {
+    return hits + misses == 0 ? 0.0 : (double)hits / (double)(hits + misses);
+}
+
+void KVStats::merge(const KVStats& o) {
+    puts += o.puts;
+    deletes += o.deletes;
+    bytes_written += o.bytes_written;
+    gets += o.gets;
+    get_hits += o.get_hits;
+    multi_get_keys += o.multi_get_keys;
+    scans += o.scans;
+    write_stalls += o.write_stalls;
+    flushes += o.flushes;
+    flush_bytes_written += o.flush_bytes_written;
+    table_lookups += o.table_lookups;
+    table_blocks_read += o.table_blocks_read;
+    table_bytes_read += o.table_bytes_read;
+    table_read_syscalls += o.table_read_syscalls;
+    bloom_checks += o.bloom_checks;
+    bloom_negatives += o.bloom_negatives;
+    bloom_false_positives += o.bloom_false_positives;
+    cache_hits += o.cache_hits;
+    cache_misses += o.cache_misses;
+    cache_evictions += o.cache_evictions;
+    decompressed_cache_hits += o.decompressed_cache_hits;
+    decompressed_cache_misses += o.decompressed_cache_misses;
+    memtable_bytes += o.memtable_bytes;
+    immutable_memtables += o.immutable_memtables;
+    compactions += o.compactions;
+    compaction_bytes_read += o.compaction_bytes_read;
+    compaction_bytes_written += o.compaction_bytes_written;
+    ingested_tables += o.ingested_tables;
+    ingest_bytes_written += o.ingest_bytes_written;
+    value_log_bytes_written += o.value_log_bytes_written;
+    value_log_reads += o.value_log_reads;
+    value_log_files += o.value_log_files;
+    value_log_bytes += o.value_log_bytes;
+    value_log_garbage_bytes += o.value_log_garbage_bytes;
+    value_log_gc_files += o.value_log_gc_files;
+    value_log_gc_bytes_rewritten += o.value_log_gc_bytes_rewritten;
+
+    uint64_t absent = bloom_negatives + bloom_false_positives;
+    bloom_false_positive_rate = absent == 0 ? 0.0 : (double)bloom_false_positives / (double)absent;
+    cache_hit_rate = hit_rate(cache_hits, cache_misses);
+
+    put_latency.merge(o.put_latency);
+    wal_sync_latency.merge(o.wal_sync_latency);
+    write_stall_latency.merge(o.write_stall_latency);
+    get_latency.merge(o.get_latency);
+    multi_get_latency.merge(o.multi_get_latency);
+    scan_latency.merge(o.scan_latency);
+    flush_latency.merge(o.flush_latency);
+    compaction_latency.merge(o.compaction_latency);
+    tables.insert(tables.end(), o.tables.begin(), o.tables.end());
+}
+
+std::string KVStats::to_text() const {
+    std::string out;
+    char line[256];
+    for (const auto& [name, v] : stat_counters(*this)) {
+        std::snprintf(line, sizeof(line), "%-28s %llu\n", name, (unsigned long long)v);
+        out += line;
+    }
+    std::snprintf(line, sizeof(line), "%-28s %.4f\n%-28s %.4f\n%-28s %.4f\n",
+                  "bloom_false_positive_rate", bloom_false_positive_rate, "cache_hit_rate", cache_hit_rate,
+                  "decompressed_cache_hit_rate", hit_rate(decompressed_cache_hits, decompressed_cache_misses));
+    out += line;
+
+    std::snprintf(line, sizeof(line), "\n%-12s %10s %10s %10s %10s %10s %10s\n",
+                  "latency(us)", "count", "mean", "p50", "p99", "p99.9", "max");
+    out += line;
+    for (const auto& [name, h] : stat_latencies(*this)) {
+        std::snprintf(line, sizeof(line), "%-12s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", name,
+                      (unsigned long long)h->count, h->mean() / 1e3, (double)h->percentile(0.50) / 1e3,
+                      (double)h->percentile(0.99) / 1e3, (double)h->percentile(0.999) / 1e3, (double)h->max / 1e3);
+        out += line;
+    }
+
+    std::snprintf(line, sizeof(line), "\n%-5s %-8s %12s %10s %10s %10s %12s %10s %8s\n",
+                  "level", "table", "file_bytes", "entries", "lookups", "blocks", "bytes_read", "syscalls", "bloom_fp");
+    out += line;
+    for (const auto& t : tables) {
+        std::snprintf(line, sizeof(line), "%-5zu %-8llu %12llu %10llu %10llu %10llu %12llu %10llu %8llu\n", t.level,
+                      (unsigned long long)t.number, (unsigned long long)t.file_size, (unsigned long long)t.entries,
+                      (unsigned long long)t.lookups, (unsigned long long)t.blocks_read,
+                      (unsigned long long)t.bytes_read, (unsigned long long)t.read_syscalls,
+                      (unsigned long long)t.filter_false_positives);
+        out += line;
+    }
+    return out;
+}
+
+std::string KVStats::to_json() const {
+    std::string out = "{";
+    char buf[256];
+    auto field = [&](const char* name, uint64_t v) {
+        std::snprintf(buf, sizeof(buf), "\"%s\":%llu,", name, (unsigned long long)v);
+        out += buf;
+    };
+    for (const auto& [name, v] : stat_counters(*this)) field(name, v);
+    std::snprintf(buf, sizeof(buf),
+                  "\"bloom_false_positive_rate\":%.6f,\"cache_hit_rate\":%.6f,\"decompressed_cache_hit_rate\":%.6f,",
+                  bloom_false_positive_rate, cache_hit_rate,
+                  hit_rate(decompressed_cache_hits, decompressed_cache_misses));
+    out += buf;
+
+    out += "\"latency_ns\":{";
+    bool first = true;
+    for (const auto& [name, h] : stat_latencies(*this)) {
+        std::snprintf(buf, sizeof(buf),
+                      "%s\"%s\":{\"count\":%llu,\"mean\":%.1f,\"min\":%llu,\"p50\":%llu,\"p99\":%llu,"
+                      "\"p999\":%llu,\"max\":%llu}",
+                      first ? "" : ",", name, (unsigned long long)h->count, h->mean(), (unsigned long long)h->min,
+                      (unsigned long long)h->percentile(0.50), (unsigned long long)h->percentile(0.99),
+                      (unsigned long long)h->percentile(0.999), (unsigned long long)h->max);
+        out += buf;
+        first = false;
+    }
+    out += "},\"tables\":[";
+    first = true;
+    for (const auto& t : tables) {
+        out += first ? "{" : ",{";
+        first = false;
+        field("level", t.level);
+        field("number", t.number);
+        field("file_size", t.file_size);
+        field("entries", t.entries);
+        field("lookups", t.lookups);
+        field("blocks_read", t.blocks_read);
+        field("bytes_read", t.bytes_read);
+        field("read_syscalls", t.read_syscalls);
+        field("filter_checks", t.filter_checks);
+        field("filter_negatives", t.filter_negatives);
+        field("filter_false_positives", t.filter_false_positives);
+        out.back() = '}';
+    }
+    out += "]}";
+    return out;
+}
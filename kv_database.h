@@ -0,0 +1,373 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <cstdint>
+#include <chrono>
+#include <optional>
+#include <span>
+#include <map>
+#include "memtable.h"
+#include "sstable.h"
+#include "compaction.h"
+#include "bulk_loader.h"
+#include "wal.h"
+#include "value_log.h"
+#include "metrics.h"
+
+// Tunables for a KVDatabase instance.
+struct KVOptions {
+    // A memtable is flushed to an SSTable once it reaches either limit (0 = no limit).
+    size_t memtable_max_bytes = 4u << 20;   // arena bytes: nodes, keys and values
+    int memtable_max_entries = 0;
+    int max_immutable_memtables = 2;   // frozen memtables waiting for flush before writers block
+    // Skiplist, or B+tree for large memtables (fewer cache misses per lookup and insert).
+    MemTableType memtable_type = MemTableType::SkipList;
+    SSTableOptions sstable;            // block size, Bloom filter bits per key, read mode of SSTables
+    WalSyncMode wal_sync_mode = WalSyncMode::PerBatch;
+    std::chrono::milliseconds wal_sync_interval{10};   // used by WalSyncMode::Interval
+    // Shared page cache for Pread-mode SSTable reads; 0 disables it. Ignored if
+    // sstable.buffer_pool is already set (e.g. one pool shared by several databases).
+    size_t block_cache_bytes = 0;
+    EvictionPolicy block_cache_policy = EvictionPolicy::SegmentedLRU;
+    // Decompressed blocks of compressed SSTables (see sstable.compression); 0 disables
+    // it. Ignored if sstable.block_cache is already set.
+    size_t decompressed_cache_bytes = 8u << 20;
+    CompactionOptions compaction;      // policy and triggers for merging SSTables
+    ValueLogOptions value_log;         // key-value separation of large values (off by default)
+    size_t scan_readahead_bytes = SSTable::Iterator::kDefaultReadahead;   // per-table read-ahead of range scans (a seek starts at one block and grows to this)
+    // Time every operation and background job into the KVStats latency
+    // histograms (two clock reads each); counters are kept either way.
+    bool collect_latencies = true;
+};
+
+// Read-path counters of one live SSTable (see SSTableStats).
+struct KVTableStats {
+    size_t level = 0;
+    uint64_t number = 0;
+    uint64_t file_size = 0;
+    uint64_t entries = 0;
+    uint64_t lookups = 0;
+    uint64_t blocks_read = 0;
+    uint64_t bytes_read = 0;
+    uint64_t read_syscalls = 0;
+    uint64_t filter_checks = 0;
+    uint64_t filter_negatives = 0;
+    uint64_t filter_false_positives = 0;
+};
+
+// Engine-wide counters and latencies. SSTable counters are summed over all
+// tables since open, including tables compacted away; 'tables' lists the
+// live ones. Latencies are in nanoseconds.
+struct KVStats {
+    uint64_t puts = 0;                    // put() calls
+    uint64_t deletes = 0;                 // remove() calls
+    uint64_t bytes_written = 0;           // key and value bytes of puts and deletes
+    uint64_t gets = 0;                    // get() calls
+    uint64_t get_hits = 0;                // ... that found a live value
+    uint64_t multi_get_keys = 0;          // keys asked for through multi_get()
+    uint64_t scans = 0;                   // scan() calls and iterators created
+    uint64_t write_stalls = 0;            // writes that waited for a flush (max_immutable_memtables reached)
+    uint64_t flushes = 0;                 // memtables written to SSTables
+    uint64_t flush_bytes_written = 0;
+    uint64_t table_lookups = 0;           // SSTable point lookups
+    uint64_t table_blocks_read = 0;       // SSTable blocks fetched by lookups and scans
+    uint64_t table_bytes_read = 0;
+    uint64_t table_read_syscalls = 0;     // preads and async reads issued by SSTables
+    uint64_t bloom_checks = 0;            // SSTable lookups that consulted a Bloom filter
+    uint64_t bloom_negatives = 0;         // ... answered "absent" by the filter without I/O
+    uint64_t bloom_false_positives = 0;   // ... the filter passed but the table lacked the key
+    double bloom_false_positive_rate = 0.0;
+    uint64_t cache_hits = 0;              // buffer pool page hits (0 without a block cache)
+    uint64_t cache_misses = 0;
+    uint64_t cache_evictions = 0;
+    double cache_hit_rate = 0.0;
+    uint64_t decompressed_cache_hits = 0;     // compressed blocks served without read or decompression
+    uint64_t decompressed_cache_misses = 0;
+    size_t memtable_bytes = 0;            // arena bytes held by the current memtable
+    size_t immutable_memtables = 0;       // frozen memtables waiting to be flushed
+    uint64_t compactions = 0;             // compaction jobs completed since open
+    uint64_t compaction_bytes_read = 0;
+    uint64_t compaction_bytes_written = 0;
+    uint64_t ingested_tables = 0;         // tables installed by ingest()
+    uint64_t ingest_bytes_written = 0;
+    uint64_t value_log_bytes_written = 0;     // values moved into the value log by flushes and compactions
+    uint64_t value_log_reads = 0;             // values read back from it
+    uint64_t value_log_files = 0;
+    uint64_t value_log_bytes = 0;             // size of the value log files
+    uint64_t value_log_garbage_bytes = 0;     // ... known to be dead
+    uint64_t value_log_gc_files = 0;          // files rewritten and removed by garbage collection
+    uint64_t value_log_gc_bytes_rewritten = 0;   // live values they still held
+
+    HistogramSnapshot put_latency;          // put() and remove(), including the WAL sync
+    HistogramSnapshot wal_sync_latency;     // ... the wait for the write to be durable
+    HistogramSnapshot write_stall_latency;  // ... the wait for a flush, when the write stalled
+    HistogramSnapshot get_latency;
+    HistogramSnapshot multi_get_latency;    // one sample per call
+    HistogramSnapshot scan_latency;         // whole scan() calls (iterators are not timed)
+    HistogramSnapshot flush_latency;        // memtable to installed SSTable
+    HistogramSnapshot compaction_latency;   // one sample per compaction job
+
+    std::vector<KVTableStats> tables;       // live tables, level by level
+
+    // Add another engine's stats to these (counters summed, histograms and
+    // table lists merged, rates recomputed).
+    void merge(const KVStats& o);
+
+    // Human-readable dump, and the same data as one JSON object.
+    [[nodiscard]] std::string to_text() const;
+    [[nodiscard]] std::string to_json() const;
+};
+
+// KVDatabase: LSM-style storage engine
+// ----------------------------------------
+// Writes go into a concurrent MemTable (a skiplist, or a B+tree with
+// KVOptions::memtable_type) whose nodes and bytes are bump-allocated from an
+// arena. When the memtable is full it is frozen (immutable) and a fresh one
+// takes over immediately; a background thread writes frozen memtables in
+// key order to new numbered SSTables, so writers only wait for a flush when
+// KVOptions::max_immutable_memtables are already queued. Reads check the
+// memtable, then the frozen memtables, then SSTables from newest to oldest;
+// the first layer that knows about the key (value or tombstone) wins. With
+// KVOptions::block_cache_bytes, SSTable pages are cached in one BufferPool
+// shared by every table of the database; blocks of compressed tables are
+// also kept decompressed in one shared BlockCache.
+//
+// Flushed tables enter level 0. Compaction (KVOptions::compaction) merges
+// tables with a k-way merge on a background thread: leveled compaction moves
+// them down into disjoint, exponentially larger levels, size-tiered compaction
+// merges runs of similar size. Only the final install of a merge's output
+// takes the engine lock, so reads and writes continue while it runs.
+//
+// Every write is first appended to the write-ahead log of its memtable. Each
+// memtable gets a log file of its own, deleted once that memtable is in an
+// SSTable; logs left behind by a crash are replayed on open. put()/remove()
+// return once the record is durable according to KVOptions::wal_sync_mode.
+//
+// With KVOptions::value_log.min_value_size, values at least that long are
+// separated from their keys when a memtable is flushed: they are appended
+// to a ValueLog and the SSTable keeps only a small pointer, so compactions
+// move pointers instead of the values and tables stay small enough for a
+// scan over keys to read little (iterators fetch a separated value on the
+// first value() call). Compactions report the pointers they drop as value
+// log garbage; once a file's share of garbage reaches gc_garbage_ratio,
+// garbage collection (after background compactions, or collect_garbage())
+// copies its live values to the end of the log, installs a table of the
+// new pointers just above the tables it checked them against, and deletes
+// the file.
+//
+// Large loads can skip the memtable and the log: records added to a
+// BulkLoader from new_bulk_loader() are sorted externally into SSTables,
+// which ingest() installs as the newest data, each table as deep in the
+// level structure as its key range allows.
+//
+// stats() reports operation counts, latency histograms of every stage
+// (writes, WAL syncs, stalls, reads, scans, flushes, compactions) and the
+// I/O of each SSTable, all kept in per-thread sharded counters.
+//
+// On-disk layout inside 'dir':
+//   sst_000001.sst, sst_000002.sst, ... (legacy tables also have a .idx)
+//   MANIFEST  live tables as "<level> <number>" lines, level 0 oldest first;
+//             without it every table is in level 0 and higher number = newer
+//   wal_000001.log, ...  logs of memtables not yet flushed (older versions used a single wal.log)
+//   bulk_000001.tmp/     sorted runs of a BulkLoader (removed on open if left by a crash)
+//   vlog_000001.vlog, ...  value log files; the MANIFEST adds "vlog <number> <garbage bytes>" lines
+//
+// All public methods are thread-safe. The engine mutex only guards the
+// structure (current memtable and log, frozen memtables, levels) and WAL
+// appends; memtable inserts, lookups, scans, flushes and merges run outside it.
+class KVDatabase {
+public:
+    // Open (or create) a database in directory 'dir', loading any existing SSTables
+    // and replaying leftover write-ahead logs into the memtable.
+    explicit KVDatabase(std::string dir, KVOptions options = {});
+
+    // Flushes all memtables so a clean shutdown leaves no logs behind, then
+    // stops the background threads.
+    ~KVDatabase();
+
+    KVDatabase(const KVDatabase&) = delete;
+    KVDatabase& operator=(const KVDatabase&) = delete;
+
+    void put(const std::string& key, const std::string& value);
+
+    // Returns true and fills value_out if the key has a live value.
+    bool get(const std::string& key, std::string& value_out) const;
+
+    // Batched get: result[i] is the live value of keys[i], or nullopt. Keys
+    // the memtables do not settle go to each SSTable as one sorted batch
+    // (SSTable::multi_get), so a table's blocks are read once per batch.
+    [[nodiscard]] std::vector<std::optional<std::string>> multi_get(std::span<const std::string> keys) const;
+
+    // Delete a key. Writes a tombstone that shadows older SSTable copies.
+    void remove(const std::string& key);
+
+    // Visit live key-value pairs with start <= key <= end in ascending key order.
+    // Streams through iterator(); nothing is collected in memory.
+    void scan(const std::string& start, const std::string& end,
+              const std::function<void(const std::string&, const std::string&)>& visit) const;
+
+    // Iterator over live key-value pairs in ascending key order, merging the
+    // memtables and every SSTable (tombstones are hidden). It keeps the tables
+    // it started with open; writes made after it was created may or may not
+    // show up.
+    [[nodiscard]] std::unique_ptr<Iterator> iterator() const;
+
+    // Freeze the current memtable (if not empty) and wait until every frozen
+    // memtable is in an SSTable. Rethrows a background flush failure.
+    void flush();
+
+    // Run compactions in the calling thread until no level needs one (waits for
+    // a background compaction in progress first). Rethrows a background failure.
+    void compact();
+
+    // BulkLoader whose runs go to a fresh directory inside 'dir' and whose
+    // output tables are shaped like the database's. Fill it, then ingest() it.
+    [[nodiscard]] std::unique_ptr<BulkLoader> new_bulk_loader(BulkLoadOptions bulk = {});
+
+    // Finish 'loader' (from new_bulk_loader()) and install its tables in one
+    // MANIFEST update, newer than every write made before the call: those are
+    // flushed first. Leveled: each table goes to the deepest level that no
+    // table of that level or any level above overlaps, else on top of level
+    // 0 (see install_ingested()). Writes made while ingest() runs may end up
+    // older or newer than the ingested data.
+    BulkLoadResult ingest(BulkLoader& loader);
+
+    // Garbage-collect value log files whose known garbage has reached
+    // KVOptions::value_log.gc_garbage_ratio, one at a time until none is
+    // left (waits for queued flushes and a compaction in progress first; a
+    // file is only collected while no flush is queued). Returns the number of
+    // files collected; 0 without a value log.
+    size_t collect_garbage();
+
+    [[nodiscard]] size_t sstable_count() const;
+
+    // Number of tables in each level, level 0 first.
+    [[nodiscard]] std::vector<size_t> tables_per_level() const;
+
+    // Counters, latency histograms and per-table I/O since open; see
+    // KVStats::to_text() / to_json() for dumps.
+    [[nodiscard]] KVStats stats() const;
+
+private:
+    // A memtable plus the log files that hold its records.
+    struct MemTableState {
+        std::shared_ptr<MemTable> table;
+        std::vector<std::string> logs;
+    };
+
+    // What a reader needs, grabbed under mu and then used without it.
+    struct ReadView {
+        std::shared_ptr<MemTable> mem;
+        std::vector<std::shared_ptr<MemTable>> imm;      // oldest first
+        std::shared_ptr<const LevelVector> levels;
+        std::shared_ptr<const ValueLog::FileSet> vlog_files;   // null without a value log
+    };
+
+    class DBIterator;
+
+    // Operation counters and stage latencies (SSTable counters live in each SSTable).
+    struct Metrics {
+        ShardedCounter puts, deletes, bytes_written, gets, get_hits, multi_get_keys, scans;
+        ShardedCounter write_stalls, flushes, flush_bytes_written;
+        LatencyHistogram put, wal_sync, write_stall, get, multi_get, scan, flush, compaction;
+    };
+
+    std::string dir;
+    KVOptions options;
+    MemTableState mem;
+    std::vector<MemTableState> imm;                 // frozen, oldest first
+    std::shared_ptr<const LevelVector> levels;      // replaced, never modified in place (see compaction.h)
+    std::shared_ptr<WriteAheadLog> wal;             // log of 'mem'; null while replaying on open
+    uint64_t last_sequence{0};                      // orders writes to the same key inside a memtable
+    uint64_t next_table_number{1};
+    uint64_t next_log_number{1};
+    uint64_t next_bulk_number{1};
+    // Separated values; also opened with separation off if the directory has value log files.
+    std::unique_ptr<ValueLog> vlog;
+    KVStats retired;                      // counters of tables compacted away, compaction totals
+    mutable Metrics metrics;
+    mutable std::mutex mu;
+
+    std::thread flush_thread;
+    std::condition_variable flush_cv;        // a memtable was frozen, or shutdown
+    std::condition_variable flushed_cv;      // a frozen memtable reached an SSTable
+    std::exception_ptr flush_error;          // first background flush failure; stops flushing
+
+    std::thread compaction_thread;
+    std::condition_variable compaction_cv;   // flushes, finished compactions, shutdown
+    bool compacting{false};                  // a job is between pick and install
+    std::atomic<bool> stopping{false};
+    std::exception_ptr compaction_error;     // first background failure; stops background work
+
+    // Log and apply a put (value != nullptr) or delete (value == nullptr).
+    void write(const std::string& key, const std::string* value);
+
+    // Freeze the memtable if it is full, first waiting while too many frozen
+    // memtables are queued. Caller holds 'lock'.
+    void make_room(std::unique_lock<std::mutex>& lock);
+
+    // Move 'mem' to 'imm' and start a new memtable with a new log. Caller holds mu.
+    void freeze_memtable_locked();
+
+    // Write the oldest frozen memtable to an SSTable with 'lock' released, then
+    // install it in level 0 and delete its logs.
+    void flush_oldest(std::unique_lock<std::mutex>& lock);
+
+    void flush_loop();
+
+    // get() without the metrics.
+    bool get_impl(const std::string& key, std::string& value_out) const;
+
+    // Encode 'value' for a separated table into 'out', appending it to the
+    // value log if it is large enough (then returns true).
+    bool separate_value(std::string_view key, std::string_view value, std::string& out);
+
+    // Turn a value stored in 'table' into the value itself, in place.
+    void resolve_value(const SSTable& table, std::string& value, const ReadView& view) const;
+
+    // Give the job the value hooks that move values into or out of the value
+    // log and count the pointers it drops (per value log file) in 'dropped'.
+    void set_value_hooks(CompactionJob& job, std::map<uint64_t, uint64_t>& dropped, bool& appended);
+
+    [[nodiscard]] std::shared_ptr<MemTable> new_memtable() const;
+
+    // 'h' if latencies are collected, else null (for LatencyTimer).
+    [[nodiscard]] LatencyHistogram* timed(LatencyHistogram& h) const {
+        return options.collect_latencies ? &h : nullptr;
+    }
+    [[nodiscard]] ReadView read_view() const;
+
+    // Base path (no extension) for SSTable number n, e.g. "<dir>/sst_000007".
+    [[nodiscard]] std::string table_base(uint64_t n) const;
+
+    // Path of log number n, e.g. "<dir>/wal_000003.log".
+    [[nodiscard]] std::string log_path(uint64_t n) const;
+
+    // Open the tables listed in the MANIFEST (or, without one, every sst_*.sst
+    // file as level 0) and delete table files the manifest does not list and
+    // BulkLoader directories.
+    void load_tables();
+
+    // Replay leftover logs (oldest first) into memtables and set up the log for new writes.
+    void recover_logs();
+
+    // Atomically rewrite the MANIFEST from 'levels'. Caller holds mu.
+    void save_manifest_locked();
+
+    // Pick, run and install one compaction; the merge itself runs with 'lock'
+    // released. Returns false if nothing needed compacting.
+    bool compact_once(std::unique_lock<std::mutex>& lock);
+
+    void compaction_loop();
+
+    // Pick and collect one value log file (see collect_garbage()); the
+    // rewrite runs with 'lock' released. Returns false if none qualifies.
+    bool collect_once(std::unique_lock<std::mutex>& lock);
+};
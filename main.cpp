@@ -1,9 +1,35 @@
 #include "avl_tree.h"
 #include <iostream>
+#include "arena_unit_tests.h"
 #include "avl_unit_tests.h"
+#include "memtable_unit_tests.h"
+#include "compression_unit_tests.h"
+#include "metrics_unit_tests.h"
+#include "prefix_index_unit_tests.h"
+#include "sstable_unit_tests.h"
+#include "fixed_table_unit_tests.h"
+#include "buffer_pool_unit_tests.h"
+#include "compaction_unit_tests.h"
+#include "bulk_loader_unit_tests.h"
+#include "kv_database_unit_tests.h"
+#include "value_log_unit_tests.h"
+#include "sharded_database_unit_tests.h"
 using namespace std;
 
 int main() {
+    run_arena_tests();
     run_avl_tests();
+    run_memtable_tests();
+    run_compression_tests();
+    run_metrics_tests();
+    run_prefix_index_tests();
+    run_sstable_tests();
+    run_fixed_table_tests();
+    run_buffer_pool_tests();
+    run_compaction_tests();
+    run_bulk_loader_tests();
+    run_kv_database_tests();
+    run_value_log_tests();
+    run_sharded_database_tests();
     return 0;
 }
@@ -0,0 +1,239 @@
+#include "memtable.h"
+#include <random>
+#include <thread>
+#include <new>
+
+std::string_view MemTable::NodeKey::operator()(const Node* n) const {
+    return n->key;
+}
+
+MemTable::MemTable(size_t max_bytes_, size_t max_entries_, MemTableType type)
+    : max_bytes(max_bytes_)
+    , max_entries(max_entries_) {
+    std::lock_guard<std::mutex> lock(arena_mu);
+    head = new_node({}, nullptr, kMaxHeight);
+    if (type == MemTableType::BPlusTree) {
+        btree = std::make_unique<BTree>(arena);
+        bytes.store(arena.bytes_used(), std::memory_order_relaxed);
+    }
+}
+
+bool MemTable::is_full() const {
+    return (max_bytes > 0 && memory_usage() >= max_bytes) ||
+           (max_entries > 0 && size() >= max_entries);
+}
+
+void MemTable::wait_for_writers() const {
+    while (writers.load(std::memory_order_acquire) > 0) std::this_thread::yield();
+}
+
+int MemTable::random_height() {
+    // p = 1/4 per extra level
+    thread_local std::minstd_rand rng(std::random_device{}());
+    int h = 1;
+    while (h < kMaxHeight && (rng() & 3) == 0) ++h;
+    return h;
+}
+
+MemTable::Node* MemTable::new_node(std::string_view key, const ValueRecord* value, int height) {
+    size_t size = sizeof(Node) + sizeof(std::atomic<Node*>) * (size_t)(height - 1);
+    char* mem = arena.allocate_aligned(size, alignof(Node));
+    Node* n = new (mem) Node{arena.copy(key), {value}, height, {}};
+    for (int i = 0; i < height; ++i) new (&n->next[i]) std::atomic<Node*>(nullptr);
+    bytes.store(arena.bytes_used(), std::memory_order_relaxed);
+    return n;
+}
+
+const MemTable::ValueRecord* MemTable::new_value(const std::string_view* value, uint64_t seq) {
+    std::string_view copied = value ? arena.copy(*value) : std::string_view();
+    const ValueRecord* rec = arena.make<ValueRecord>(ValueRecord{seq, copied, value == nullptr});
+    bytes.store(arena.bytes_used(), std::memory_order_relaxed);
+    return rec;
+}
+
+void MemTable::set_value(Node* node, const ValueRecord* rec) {
+    const ValueRecord* cur = node->value.load(std::memory_order_acquire);
+    while (cur->seq < rec->seq &&
+           !node->value.compare_exchange_weak(cur, rec, std::memory_order_acq_rel, std::memory_order_acquire)) {
+    }
+}
+
+void MemTable::find_splice_at(std::string_view key, int level, Node* start, Node** prev, Node** next) const {
+    Node* x = start;
+    for (;;) {
+        Node* n = x->load_next(level);
+        if (n == nullptr || n->key >= key) {
+            *prev = x;
+            *next = n;
+            return;
+        }
+        x = n;
+    }
+}
+
+MemTable::Node* MemTable::find_greater_or_equal(std::string_view key) const {
+    if (btree) {
+        std::shared_lock<std::shared_mutex> lock(btree_mu);
+        BTree::Cursor c = btree->seek(key);
+        return c.valid() ? c.item() : nullptr;
+    }
+    Node* x = head;
+    for (int level = max_height.load(std::memory_order_acquire) - 1; level >= 0; --level) {
+        Node* prev;
+        Node* next;
+        find_splice_at(key, level, x, &prev, &next);
+        if (level == 0) return next;
+        x = prev;
+    }
+    return nullptr;
+}
+
+// MemTable::add()
+// --------------------------------------------------------------------
+// Find the splice (predecessor and successor) on every level, then link the
+// new node bottom-up with one CAS per level. A failed CAS means another writer
+// changed that spot: recompute the splice for that level, starting from the
+// old predecessor, and try again. If the level-0 retry finds that someone
+// else has just inserted the same key, fall back to overwriting their node.
+void MemTable::add(std::string_view key, const std::string_view* value, uint64_t seq) {
+    if (btree) return add_to_btree(key, value, seq);
+    Node* prev[kMaxHeight];
+    Node* next[kMaxHeight];
+    int top = max_height.load(std::memory_order_acquire);
+    Node* x = head;
+    for (int level = kMaxHeight - 1; level >= 0; --level) {
+        if (level >= top) { prev[level] = head; next[level] = nullptr; continue; }
+        find_splice_at(key, level, x, &prev[level], &next[level]);
+        x = prev[level];
+    }
+
+    if (next[0] && next[0]->key == key) {
+        const ValueRecord* rec;
+        {
+            std::lock_guard<std::mutex> lock(arena_mu);
+            rec = new_value(value, seq);
+        }
+        set_value(next[0], rec);
+        return;
+    }
+
+    int height = random_height();
+    Node* node;
+    {
+        std::lock_guard<std::mutex> lock(arena_mu);
+        node = new_node(key, new_value(value, seq), height);
+    }
+    int h = max_height.load(std::memory_order_relaxed);
+    while (height > h && !max_height.compare_exchange_weak(h, height)) {
+    }
+
+    for (int level = 0; level < height; ++level) {
+        for (;;) {
+            node->next[level].store(next[level], std::memory_order_relaxed);
+            if (prev[level]->next[level].compare_exchange_strong(next[level], node, std::memory_order_release))
+                break;
+            find_splice_at(key, level, prev[level], &prev[level], &next[level]);
+            if (level == 0 && next[0] && next[0]->key == key) {
+                // lost the race to insert this key: our node is never linked (the arena reclaims it)
+                set_value(next[0], node->value.load(std::memory_order_relaxed));
+                return;
+            }
+        }
+    }
+    entries.fetch_add(1, std::memory_order_relaxed);
+}
+
+// An overwrite only needs the node, so it runs under the shared lock like a
+// lookup; the exclusive lock is taken only to insert a new key, and the
+// tree is searched again under it since another writer may have inserted
+// the key in between.
+void MemTable::add_to_btree(std::string_view key, const std::string_view* value, uint64_t seq) {
+    const ValueRecord* rec;
+    {
+        std::lock_guard<std::mutex> lock(arena_mu);
+        rec = new_value(value, seq);
+    }
+    {
+        std::shared_lock<std::shared_mutex> lock(btree_mu);
+        if (Node* n = btree->find(key)) return set_value(n, rec);
+    }
+    std::unique_lock<std::shared_mutex> lock(btree_mu);
+    std::lock_guard<std::mutex> alloc(arena_mu);
+    bool inserted;
+    Node* n = btree->find_or_insert(key, [&] { return new_node(key, rec, 1); }, inserted);
+    bytes.store(arena.bytes_used(), std::memory_order_relaxed);
+    if (inserted) entries.fetch_add(1, std::memory_order_relaxed);
+    else set_value(n, rec);
+}
+
+LookupResult MemTable::get(std::string_view key, std::string& value_out) const {
+    const Node* n;
+    if (btree) {
+        std::shared_lock<std::shared_mutex> lock(btree_mu);
+        n = btree->find(key);
+    } else {
+        n = find_greater_or_equal(key);
+    }
+    if (n == nullptr || n->key != key) return LookupResult::NotFound;
+    const ValueRecord* rec = n->value.load(std::memory_order_acquire);
+    if (rec->deleted) return LookupResult::Deleted;
+    value_out.assign(rec->bytes);
+    return LookupResult::Found;
+}
+
+void MemTable::for_each(const std::function<void(std::string_view, const std::string_view*)>& visit) const {
+    if (btree) {
+        Iterator it(*this);
+        for (it.seek_to_first(); it.valid(); it.next()) {
+            std::string_view v = it.value();
+            visit(it.key(), it.deleted() ? nullptr : &v);
+        }
+        return;
+    }
+    for (Node* n = head->load_next(0); n != nullptr; n = n->load_next(0)) {
+        const ValueRecord* rec = n->value.load(std::memory_order_acquire);
+        visit(n->key, rec->deleted ? nullptr : &rec->bytes);
+    }
+}
+
+void MemTable::for_each_in_range(std::string_view start, std::string_view end,
+                                 const std::function<void(std::string_view, const std::string_view*)>& visit) const {
+    if (btree) {
+        Iterator it(*this);
+        for (it.seek(start); it.valid() && it.key() <= end; it.next()) {
+            std::string_view v = it.value();
+            visit(it.key(), it.deleted() ? nullptr : &v);
+        }
+        return;
+    }
+    for (Node* n = find_greater_or_equal(start); n != nullptr && n->key <= end; n = n->load_next(0)) {
+        const ValueRecord* rec = n->value.load(std::memory_order_acquire);
+        visit(n->key, rec->deleted ? nullptr : &rec->bytes);
+    }
+}
+
+void MemTable::Iterator::seek_to_first() {
+    if (!table->btree) return set(table->head->load_next(0));
+    std::shared_lock<std::shared_mutex> lock(table->btree_mu);
+    set(table->btree->first());
+}
+
+void MemTable::Iterator::seek(std::string_view target) {
+    if (!table->btree) return set(table->find_greater_or_equal(target));
+    std::shared_lock<std::shared_mutex> lock(table->btree_mu);
+    set(table->btree->seek(target));
+}
+
+void MemTable::Iterator::next() {
+    if (!table->btree) return set(node->load_next(0));
+    std::shared_lock<std::shared_mutex> lock(table->btree_mu);
+    BTree::Cursor c = cursor;
+    if (table->btree->version() != version) {
+        // keys were inserted since: find our place again
+        c = table->btree->seek(node->key);
+        if (c.valid() && c.item() == node) c.next();
+    } else {
+        c.next();
+    }
+    set(c);
+}
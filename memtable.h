@@ -0,0 +1,167 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <memory>
+#include <functional>
+#include <cstdint>
+#include "arena.h"
+#include "bplus_tree.h"
+#include "record.h"
+#include "iterator.h"
+
+// Ordered structure of a MemTable.
+enum class MemTableType {
+    SkipList,    // lock-free concurrent skiplist (default)
+    BPlusTree,   // cache-line B+tree with inline key prefixes (see bplus_tree.h)
+};
+
+// MemTable: concurrent skiplist memtable
+// ----------------------------------------
+// Any number of threads may call add(), get() and the for_each_*() walks at
+// the same time. Readers never lock. A writer links its node into each level
+// with a compare-and-swap, and retries only that level if another writer got
+// there first. The only lock is a short mutex around the arena bump allocator.
+//
+// With MemTableType::BPlusTree the same nodes are indexed by a BPlusTree
+// instead of being linked into skiplist levels. A skiplist lookup follows a
+// pointer to a separately placed node at every step, ~log2(n) cache misses
+// on a large table; the B+tree finds a key in a few cache lines per level of
+// a tree a handful of levels deep. The tree is guarded by a reader/writer
+// lock: lookups, iterator steps and overwrites of existing keys share it,
+// only the insert of a new key takes it exclusively.
+//
+// Each key has one node. A later write to the key swaps in a new value record
+// atomically. Every write carries a sequence number, and a record only
+// replaces one with a lower number. So two racing writes to the same key
+// settle on the one the engine logged last, whatever order they land in.
+//
+// Nodes, keys and values live in the arena and are freed together with the
+// memtable; the size limits are checked against the arena's byte count.
+class MemTable {
+    struct Node;
+    struct ValueRecord;
+    struct NodeKey {
+        std::string_view operator()(const Node* n) const;
+    };
+    using BTree = BPlusTree<Node, NodeKey>;
+
+public:
+    // Full once either limit is reached (0 = no limit for that dimension).
+    explicit MemTable(size_t max_bytes = 4u << 20, size_t max_entries = 0,
+                      MemTableType type = MemTableType::SkipList);
+
+    MemTable(const MemTable&) = delete;
+    MemTable& operator=(const MemTable&) = delete;
+
+    // Insert or overwrite; value == nullptr records a tombstone.
+    void add(std::string_view key, const std::string_view* value, uint64_t seq);
+
+    [[nodiscard]] LookupResult get(std::string_view key, std::string& value_out) const;
+
+    // Visit every entry (tombstones included: value == nullptr) in key order.
+    void for_each(const std::function<void(std::string_view, const std::string_view*)>& visit) const;
+
+    // Same, restricted to start <= key <= end.
+    void for_each_in_range(std::string_view start, std::string_view end,
+                           const std::function<void(std::string_view, const std::string_view*)>& visit) const;
+
+    // Iterator over the skiplist's bottom level (or the B+tree's leaves). Safe
+    // while other threads insert: it sees every entry linked before it
+    // reaches that spot, and an entry's value as of when the iterator
+    // stepped onto it.
+    class Iterator : public ::Iterator {
+    public:
+        explicit Iterator(const MemTable& table) : table(&table) {}
+
+        void seek_to_first() override;
+        void seek(std::string_view target) override;
+        void next() override;
+
+        [[nodiscard]] bool valid() const override { return node != nullptr; }
+        [[nodiscard]] std::string_view key() const override { return node->key; }
+        [[nodiscard]] std::string_view value() const override { return rec->bytes; }
+        [[nodiscard]] bool deleted() const override { return rec->deleted; }
+
+    private:
+        const MemTable* table;
+        const Node* node{nullptr};
+        const ValueRecord* rec{nullptr};
+        // B+tree: where 'node' sits, usable while the tree is at 'version'
+        // (an insert may have moved it; next() then seeks past node->key).
+        BTree::Cursor cursor;
+        uint64_t version{0};
+
+        void set(const Node* n) {
+            node = n;
+            if (n) rec = n->value.load(std::memory_order_acquire);
+        }
+        void set(BTree::Cursor c) {
+            cursor = c;
+            version = table->btree->version();
+            set(c.valid() ? c.item() : nullptr);
+        }
+    };
+
+    [[nodiscard]] size_t size() const { return entries.load(std::memory_order_relaxed); }
+    [[nodiscard]] bool empty() const { return size() == 0; }
+    [[nodiscard]] size_t memory_usage() const { return bytes.load(std::memory_order_relaxed); }
+    [[nodiscard]] bool is_full() const;
+
+    // Writers that have been handed this memtable but not finished add() yet.
+    // The engine waits for them to drain before flushing a frozen memtable.
+    void begin_write() { writers.fetch_add(1, std::memory_order_acq_rel); }
+    void end_write() { writers.fetch_sub(1, std::memory_order_acq_rel); }
+    void wait_for_writers() const;
+
+private:
+    static constexpr int kMaxHeight = 12;
+
+    struct ValueRecord {
+        uint64_t seq;
+        std::string_view bytes;
+        bool deleted;
+    };
+
+    // Allocated with room for 'height' next pointers, although next[] is declared with one.
+    struct Node {
+        std::string_view key;
+        std::atomic<const ValueRecord*> value;
+        int height;
+        std::atomic<Node*> next[1];
+
+        Node* load_next(int level) const { return next[level].load(std::memory_order_acquire); }
+    };
+
+    Arena arena;
+    std::mutex arena_mu;
+    Node* head;                       // skiplist
+    std::unique_ptr<BTree> btree;     // B+tree (allocates from 'arena' under arena_mu)
+    mutable std::shared_mutex btree_mu;
+    std::atomic<int> max_height{1};
+    std::atomic<size_t> entries{0};
+    std::atomic<size_t> bytes{0};
+    std::atomic<int> writers{0};
+    size_t max_bytes;
+    size_t max_entries;
+
+    Node* new_node(std::string_view key, const ValueRecord* value, int height);   // caller holds arena_mu
+    const ValueRecord* new_value(const std::string_view* value, uint64_t seq);     // caller holds arena_mu
+
+    static int random_height();
+
+    // First node at or after 'key' on every level, plus its predecessor.
+    // Starts the search at 'start' (which must sort before key) on level 'level'.
+    void find_splice_at(std::string_view key, int level, Node* start, Node** prev, Node** next) const;
+
+    // First node with key >= 'key', or nullptr.
+    Node* find_greater_or_equal(std::string_view key) const;
+
+    void add_to_btree(std::string_view key, const std::string_view* value, uint64_t seq);
+
+    // Install 'rec' unless the node already holds a newer record.
+    static void set_value(Node* node, const ValueRecord* rec);
+};
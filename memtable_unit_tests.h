@@ -0,0 +1,161 @@
+#ifndef KVDATABASE_MEMTABLE_UNIT_TESTS_H
+#define KVDATABASE_MEMTABLE_UNIT_TESTS_H
+
+#include "memtable.h"
+#include <cassert>
+#include <cstdio>
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+void test_memtable_basic(MemTableType type) {
+    MemTable m(4u << 20, 0, type);
+    std::string_view a = "A", b = "B", b2 = "B2";
+    m.add("b", &b, 1);
+    m.add("a", &a, 2);
+    m.add("c", nullptr, 3);
+    m.add("b", &b2, 4);
+
+    std::string v;
+    assert(m.get("a", v) == LookupResult::Found && v == "A");
+    assert(m.get("b", v) == LookupResult::Found && v == "B2");
+    assert(m.get("c", v) == LookupResult::Deleted);
+    assert(m.get("d", v) == LookupResult::NotFound);
+    assert(m.size() == 3);
+
+    // an older sequence number never replaces a newer record
+    m.add("b", &b, 2);
+    assert(m.get("b", v) == LookupResult::Found && v == "B2");
+
+    std::string keys;
+    m.for_each([&](std::string_view k, const std::string_view*) { keys += k; });
+    assert(keys == "abc");
+    keys.clear();
+    m.for_each_in_range("b", "c", [&](std::string_view k, const std::string_view* val) {
+        keys += k;
+        if (k == "c") assert(val == nullptr);
+    });
+    assert(keys == "bc");
+}
+
+void test_memtable_limits() {
+    MemTable by_entries(0, 3);
+    std::string_view v = "v";
+    for (int i = 0; i < 3; ++i) {
+        assert(!by_entries.is_full());
+        by_entries.add("k" + std::to_string(i), &v, i + 1);
+    }
+    assert(by_entries.is_full());
+
+    MemTable by_bytes(4096, 0);
+    std::string value(1000, 'x');
+    std::string_view val = value;
+    for (int i = 0; !by_bytes.is_full(); ++i) by_bytes.add("k" + std::to_string(i), &val, i + 1);
+    assert(by_bytes.memory_usage() >= 4096);
+    assert(by_bytes.size() <= 4);
+}
+
+// Many writers on overlapping keys while readers walk the list.
+void test_memtable_concurrent(MemTableType type) {
+    MemTable m(0, 0, type);
+    const int threads = 8, per_thread = 2000;
+    std::atomic<uint64_t> seq{0};
+    std::atomic<bool> done{false};
+
+    std::thread reader([&] {
+        while (!done) {
+            std::string prev;
+            bool first = true;
+            m.for_each([&](std::string_view k, const std::string_view*) {
+                assert(first || std::string(k) > prev);   // strictly ascending, no duplicates
+                prev = k;
+                first = false;
+            });
+        }
+    });
+    std::vector<std::thread> writers;
+    for (int t = 0; t < threads; ++t) {
+        writers.emplace_back([&, t] {
+            for (int i = 0; i < per_thread; ++i) {
+                std::string key = "k" + std::to_string(i % 500) + "_" + std::to_string((i + t) % 3);
+                std::string value = std::to_string(t);
+                std::string_view v = value;
+                m.add(key, &v, ++seq);
+            }
+        });
+    }
+    for (auto& w : writers) w.join();
+    done = true;
+    reader.join();
+
+    assert(m.size() == 500 * 3);
+    size_t n = 0;
+    m.for_each([&](std::string_view, const std::string_view* v) { assert(v != nullptr); ++n; });
+    assert(n == 500 * 3);
+}
+
+// Keys sharing long prefixes (ties on the B+tree's inline 8-byte prefixes),
+// checked against std::map, with an iterator that keeps going across inserts.
+void test_memtable_bplus_tree() {
+    MemTable m(0, 0, MemTableType::BPlusTree);
+    std::map<std::string, std::string> expected;
+    std::mt19937_64 rng(5);
+    uint64_t seq = 0;
+    for (int i = 0; i < 50000; ++i) {
+        uint64_t k = rng() % 30000;
+        std::string key = (k % 3 == 0 ? "shared/prefix/" : k % 3 == 1 ? "k" : "") + std::to_string(k);
+        std::string value = std::to_string(i);
+        std::string_view v = value;
+        m.add(key, &v, ++seq);
+        expected[key] = value;
+    }
+    assert(m.size() == expected.size());
+    std::string v;
+    for (const auto& [k, val] : expected) assert(m.get(k, v) == LookupResult::Found && v == val);
+    assert(m.get("shared/prefix/", v) == LookupResult::NotFound && m.get("", v) == LookupResult::NotFound);
+
+    MemTable::Iterator it(m);
+    it.seek("shared/prefix/2");
+    auto want = expected.lower_bound("shared/prefix/2");
+    for (int step = 0; it.valid(); it.next(), ++want, ++step) {
+        assert(want != expected.end() && it.key() == want->first);
+        if (step % 100 == 0) {
+            // splits move entries around under the iterator
+            for (int j = 0; j < 50; ++j) {
+                std::string key = "zz" + std::to_string(step) + "_" + std::to_string(j);
+                std::string_view val = "x";
+                m.add(key, &val, ++seq);
+                expected[key] = "x";
+            }
+        }
+    }
+    assert(want == expected.end());
+
+    // ascending inserts leave the leaves full
+    MemTable seq_table(0, 0, MemTableType::BPlusTree);
+    MemTable skip_table(0, 0, MemTableType::SkipList);
+    for (int i = 0; i < 20000; ++i) {
+        char key[16];
+        std::snprintf(key, sizeof(key), "%08d", i);
+        std::string_view val = "v";
+        seq_table.add(key, &val, i + 1);
+        skip_table.add(key, &val, i + 1);
+    }
+    assert(seq_table.memory_usage() < skip_table.memory_usage() * 2);
+}
+
+void run_memtable_tests() {
+    for (MemTableType type : {MemTableType::SkipList, MemTableType::BPlusTree}) {
+        test_memtable_basic(type);
+        test_memtable_concurrent(type);
+    }
+    test_memtable_limits();
+    test_memtable_bplus_tree();
+    std::cout << "✅ All MemTable tests passed!" << std::endl;
+}
+
+#endif
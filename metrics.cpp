@@ -0,0 +1,77 @@
+#include "metrics.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+size_t metric_shard() {
+    static std::atomic<size_t> next{0};
+    thread_local size_t shard = next.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+    return shard;
+}
+
+size_t LatencyHistogram::bucket_of(uint64_t v) {
+    if (v < kSubBuckets) return (size_t)v;
+    int e = 63 - std::countl_zero(v);   // >= kSubBucketBits
+    size_t sub = (size_t)(v >> (e - kSubBucketBits)) & (kSubBuckets - 1);
+    return (size_t)(e - kSubBucketBits + 1) * kSubBuckets + sub;
+}
+
+uint64_t LatencyHistogram::bucket_upper(size_t b) {
+    if (b < kSubBuckets) return b;
+    int e = (int)(b / kSubBuckets) + kSubBucketBits - 1;
+    uint64_t sub = b % kSubBuckets;
+    uint64_t width = uint64_t(1) << (e - kSubBucketBits);
+    return ((kSubBuckets + sub) << (e - kSubBucketBits)) + (width - 1);
+}
+
+LatencyHistogram::LatencyHistogram() : shards(new Shard[kShards]) {}
+
+void LatencyHistogram::record(uint64_t nanos) {
+    Shard& s = shards[metric_shard() % kShards];
+    s.buckets[bucket_of(nanos)].fetch_add(1, std::memory_order_relaxed);
+    s.count.fetch_add(1, std::memory_order_relaxed);
+    s.sum.fetch_add(nanos, std::memory_order_relaxed);
+    uint64_t cur = s.max.load(std::memory_order_relaxed);
+    while (nanos > cur && !s.max.compare_exchange_weak(cur, nanos, std::memory_order_relaxed)) {}
+    cur = s.min.load(std::memory_order_relaxed);
+    while (nanos < cur && !s.min.compare_exchange_weak(cur, nanos, std::memory_order_relaxed)) {}
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const {
+    HistogramSnapshot out;
+    out.min = UINT64_MAX;
+    for (size_t i = 0; i < kShards; ++i) {
+        const Shard& s = shards[i];
+        uint64_t n = s.count.load(std::memory_order_relaxed);
+        if (n == 0) continue;
+        if (out.buckets.empty()) out.buckets.assign(kBuckets, 0);
+        out.count += n;
+        out.sum += s.sum.load(std::memory_order_relaxed);
+        out.min = std::min(out.min, s.min.load(std::memory_order_relaxed));
+        out.max = std::max(out.max, s.max.load(std::memory_order_relaxed));
+        for (size_t b = 0; b < kBuckets; ++b) out.buckets[b] += s.buckets[b].load(std::memory_order_relaxed);
+    }
+    if (out.count == 0) out.min = 0;
+    return out;
+}
+
+uint64_t HistogramSnapshot::percentile(double p) const {
+    if (count == 0) return 0;
+    uint64_t rank = std::max<uint64_t>(1, (uint64_t)std::ceil(std::clamp(p, 0.0, 1.0) * (double)count));
+    uint64_t seen = 0;
+    for (size_t b = 0; b < buckets.size(); ++b) {
+        seen += buckets[b];
+        if (seen >= rank) return std::clamp(LatencyHistogram::bucket_upper(b), min, max);
+    }
+    return max;
+}
+
+void HistogramSnapshot::merge(const HistogramSnapshot& o) {
+    if (o.count == 0) return;
+    if (buckets.empty()) buckets.assign(LatencyHistogram::kBuckets, 0);
+    for (size_t b = 0; b < o.buckets.size(); ++b) buckets[b] += o.buckets[b];
+    min = count ? std::min(min, o.min) : o.min;
+    max = std::max(max, o.max);
+    count += o.count;
+    sum += o.sum;
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Instrumentation primitives: counters and latency histograms cheap enough
+// to update on every operation from many threads at once.
+//
+// Both are split into shards, one cache line (counter) or one bucket array
+// (histogram) each. A thread always writes the shard picked for it on first
+// use, so threads on different shards never share a cache line and updates
+// are plain relaxed atomic adds; readers sum the shards. A snapshot taken
+// while updates run is not atomic across shards, which is fine for stats.
+
+constexpr size_t kMetricShards = 16;
+
+// Shard of the calling thread, in [0, kMetricShards).
+size_t metric_shard();
+
+// ShardedCounter: monotonically increasing event or byte count.
+class ShardedCounter {
+public:
+    ShardedCounter() = default;
+    // Copies hold a snapshot of the total (so structs of counters stay copyable).
+    ShardedCounter(const ShardedCounter& o) { shards[0].v.store(o.load(), std::memory_order_relaxed); }
+    ShardedCounter& operator=(const ShardedCounter& o) {
+        uint64_t total = o.load();
+        for (auto& s : shards) s.v.store(0, std::memory_order_relaxed);
+        shards[0].v.store(total, std::memory_order_relaxed);
+        return *this;
+    }
+
+    void add(uint64_t n = 1) { shards[metric_shard()].v.fetch_add(n, std::memory_order_relaxed); }
+
+    [[nodiscard]] uint64_t load() const {
+        uint64_t total = 0;
+        for (const auto& s : shards) total += s.v.load(std::memory_order_relaxed);
+        return total;
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> v{0};
+    };
+    std::array<Shard, kMetricShards> shards;
+};
+
+// Point-in-time copy of a LatencyHistogram; values are nanoseconds.
+struct HistogramSnapshot {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t min = 0;
+    uint64_t max = 0;
+    std::vector<uint64_t> buckets;   // LatencyHistogram::kBuckets counts (empty when count == 0)
+
+    [[nodiscard]] double mean() const { return count ? (double)sum / (double)count : 0.0; }
+
+    // Smallest bucket bound at or below which a share p (0..1) of the values
+    // lie, capped at max: within 1/16 of the exact percentile.
+    [[nodiscard]] uint64_t percentile(double p) const;
+
+    void merge(const HistogramSnapshot& o);
+};
+
+// LatencyHistogram
+// ----------------------------------------
+// HDR-style log-linear histogram: values below 16 get a bucket each, and
+// every power-of-two range above is split into 16 equal sub-buckets, so any
+// value is counted within 1/16 (6.25%) of itself over the full uint64 range
+// with under a thousand buckets. Recording is a bucket index computation and
+// a few relaxed atomic adds on the caller's shard.
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 4;
+    static constexpr size_t kSubBuckets = size_t(1) << kSubBucketBits;
+    static constexpr size_t kBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+    LatencyHistogram();
+
+    void record(uint64_t nanos);
+
+    [[nodiscard]] HistogramSnapshot snapshot() const;
+
+    [[nodiscard]] static size_t bucket_of(uint64_t v);
+    [[nodiscard]] static uint64_t bucket_upper(size_t b);   // largest value counted in bucket b
+
+private:
+    static constexpr size_t kShards = 8;
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> count{0}, sum{0}, min{UINT64_MAX}, max{0};
+        std::array<std::atomic<uint64_t>, kBuckets> buckets{};
+    };
+    std::unique_ptr<Shard[]> shards;
+};
+
+// Records the time from construction to destruction into a histogram (none if null).
+class LatencyTimer {
+public:
+    explicit LatencyTimer(LatencyHistogram* h)
+        : hist(h)
+        , start(h ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point()) {}
+    ~LatencyTimer() {
+        if (hist)
+            hist->record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count());
+    }
+    LatencyTimer(const LatencyTimer&) = delete;
+    LatencyTimer& operator=(const LatencyTimer&) = delete;
+
+private:
+    LatencyHistogram* hist;
+    std::chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,69 @@
+#ifndef KVDATABASE_METRICS_UNIT_TESTS_H
+#define KVDATABASE_METRICS_UNIT_TESTS_H
+
+#include "metrics.h"
+#include <cassert>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+void test_sharded_counter_concurrent() {
+    ShardedCounter c;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t)
+        threads.emplace_back([&] { for (int i = 0; i < 10000; ++i) c.add(); });
+    for (auto& t : threads) t.join();
+    c.add(5);
+    assert(c.load() == 80005);
+
+    ShardedCounter copy = c;   // snapshot of the total
+    c.add();
+    assert(copy.load() == 80005 && c.load() == 80006);
+}
+
+void test_histogram_buckets() {
+    // exact below 16, then every value lands in a bucket within 1/16 of it
+    for (uint64_t v = 0; v < 16; ++v) assert(LatencyHistogram::bucket_upper(LatencyHistogram::bucket_of(v)) == v);
+    for (uint64_t v : std::vector<uint64_t>{16, 17, 31, 32, 1000, 123456789, (1ull << 40) + 12345, UINT64_MAX}) {
+        size_t b = LatencyHistogram::bucket_of(v);
+        assert(b < LatencyHistogram::kBuckets);
+        uint64_t upper = LatencyHistogram::bucket_upper(b);
+        assert(upper >= v && upper - v <= v / 16);
+        assert(b == 0 || LatencyHistogram::bucket_upper(b - 1) < v);
+    }
+    assert(LatencyHistogram::bucket_of(UINT64_MAX) == LatencyHistogram::kBuckets - 1);
+}
+
+void test_histogram_percentiles() {
+    LatencyHistogram h;
+    assert(h.snapshot().count == 0 && h.snapshot().percentile(0.99) == 0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+        threads.emplace_back([&, t] { for (uint64_t v = t + 1; v <= 10000; v += 4) h.record(v * 1000); });
+    for (auto& t : threads) t.join();
+
+    HistogramSnapshot s = h.snapshot();
+    assert(s.count == 10000 && s.min == 1000 && s.max == 10000000);
+    assert(s.sum == 10000ull * 10001 / 2 * 1000);
+    auto near = [](uint64_t got, uint64_t want) { return got >= want && got - want <= want / 16; };
+    assert(near(s.percentile(0.50), 5000000));
+    assert(near(s.percentile(0.99), 9900000));
+    assert(s.percentile(1.0) == s.max && near(s.percentile(0.0), s.min));
+
+    LatencyHistogram other;
+    other.record(50000000);
+    HistogramSnapshot merged = s;
+    merged.merge(other.snapshot());
+    assert(merged.count == 10001 && merged.max == 50000000 && merged.min == 1000);
+    assert(merged.percentile(1.0) == 50000000);
+}
+
+void run_metrics_tests() {
+    test_sharded_counter_concurrent();
+    test_histogram_buckets();
+    test_histogram_percentiles();
+    std::cout << "✅ All metrics tests passed!" << std::endl;
+}
+
+#endif
@@ -0,0 +1,147 @@
+#include "prefix_index.h"
+#include <algorithm>
+#include <bit>
+#include <climits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PREFIX_INDEX_X86 1
+#endif
+
+namespace {
+
+constexpr uint64_t kSignBit = uint64_t(1) << 63;
+
+// Lanes of 'node' that are < p. Nodes are sorted, so this is also the
+// position of the first lane >= p.
+size_t count_less_scalar(const int64_t* node, int64_t p) {
+    size_t n = 0;
+    for (size_t i = 0; i < PrefixIndex::kFanout; ++i) n += node[i] < p;
+    return n;
+}
+
+size_t descend_scalar(const int64_t* nodes, const size_t* level_start, size_t levels, int64_t p) {
+    size_t b = 0;
+    for (size_t l = 0; l < levels; ++l)
+        b = b * PrefixIndex::kFanout + count_less_scalar(nodes + (level_start[l] + b) * PrefixIndex::kFanout, p);
+    return b;
+}
+
+#ifdef PREFIX_INDEX_X86
+__attribute__((target("sse4.2"))) size_t count_less_sse42(const int64_t* node, int64_t p) {
+    __m128i pv = _mm_set1_epi64x(p);
+    unsigned mask = 0;
+    for (int i = 0; i < 4; ++i) {
+        __m128i v = _mm_load_si128(reinterpret_cast<const __m128i*>(node) + i);
+        mask |= (unsigned)_mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(pv, v))) << (2 * i);
+    }
+    return (size_t)__builtin_popcount(mask);
+}
+
+__attribute__((target("sse4.2"))) size_t descend_sse42(const int64_t* nodes, const size_t* level_start,
+                                                        size_t levels, int64_t p) {
+    size_t b = 0;
+    for (size_t l = 0; l < levels; ++l)
+        b = b * PrefixIndex::kFanout + count_less_sse42(nodes + (level_start[l] + b) * PrefixIndex::kFanout, p);
+    return b;
+}
+
+__attribute__((target("avx2"))) size_t count_less_avx2(const int64_t* node, int64_t p) {
+    __m256i pv = _mm256_set1_epi64x(p);
+    __m256i lo = _mm256_load_si256(reinterpret_cast<const __m256i*>(node));
+    __m256i hi = _mm256_load_si256(reinterpret_cast<const __m256i*>(node) + 1);
+    unsigned mask = (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(pv, lo))) |
+                    (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(pv, hi))) << 4;
+    return (size_t)__builtin_popcount(mask);
+}
+
+__attribute__((target("avx2"))) size_t descend_avx2(const int64_t* nodes, const size_t* level_start,
+                                                     size_t levels, int64_t p) {
+    size_t b = 0;
+    for (size_t l = 0; l < levels; ++l)
+        b = b * PrefixIndex::kFanout + count_less_avx2(nodes + (level_start[l] + b) * PrefixIndex::kFanout, p);
+    return b;
+}
+#endif
+
+} // namespace
+
+PrefixIndex::Isa PrefixIndex::best_isa() {
+#ifdef PREFIX_INDEX_X86
+    static const Isa best = __builtin_cpu_supports("avx2")   ? Isa::AVX2
+                          : __builtin_cpu_supports("sse4.2") ? Isa::SSE42
+                                                             : Isa::Scalar;
+    return best;
+#else
+    return Isa::Scalar;
+#endif
+}
+
+int64_t PrefixIndex::encode(std::string_view key) const {
+    uint64_t v = 0;
+    for (size_t i = 0; i < 8; ++i) {
+        size_t pos = common.size() + i;
+        v = (v << 8) | (pos < key.size() ? (uint8_t)key[pos] : 0);
+    }
+    return (int64_t)(v ^ kSignBit);
+}
+
+void PrefixIndex::build(std::span<const std::string_view> keys, Isa want) {
+    nodes.clear();
+    level_start.clear();
+    common.clear();
+    count = keys.size();
+    search_isa = (int)want <= (int)best_isa() ? want : best_isa();
+    if (keys.empty()) return;
+
+    const std::string_view first = keys.front(), back = keys.back();
+    size_t shared = 0;
+    while (shared < first.size() && shared < back.size() && first[shared] == back[shared]) ++shared;
+    common.assign(first.substr(0, shared));
+
+    // Level 0, then parents until a level fits in one node
+    std::vector<std::vector<Node>> levels(1);
+    levels[0].resize((count + kFanout - 1) / kFanout);
+    for (size_t i = 0; i < levels[0].size() * kFanout; ++i)
+        levels[0][i / kFanout].key[i % kFanout] = i < count ? encode(keys[i]) : INT64_MAX;
+    last = encode(back);
+    while (levels.back().size() > 1) {
+        const std::vector<Node>& below = levels.back();
+        std::vector<Node> up((below.size() + kFanout - 1) / kFanout);
+        for (size_t i = 0; i < up.size() * kFanout; ++i)
+            up[i / kFanout].key[i % kFanout] = i < below.size() ? below[i].key[kFanout - 1] : INT64_MAX;
+        levels.push_back(std::move(up));
+    }
+
+    for (auto it = levels.rbegin(); it != levels.rend(); ++it) {
+        level_start.push_back(nodes.size());
+        nodes.insert(nodes.end(), it->begin(), it->end());
+    }
+}
+
+size_t PrefixIndex::first_not_less(int64_t p) const {
+    const int64_t* base = nodes.front().key;
+    switch (search_isa) {
+#ifdef PREFIX_INDEX_X86
+        case Isa::AVX2:  return descend_avx2(base, level_start.data(), level_start.size(), p);
+        case Isa::SSE42: return descend_sse42(base, level_start.data(), level_start.size(), p);
+#endif
+        default:         return descend_scalar(base, level_start.data(), level_start.size(), p);
+    }
+}
+
+std::pair<size_t, size_t> PrefixIndex::candidates(std::string_view key) const {
+    if (count == 0) return {0, 0};
+    // Every stored key starts with 'common'
+    int c = key.substr(0, common.size()).compare(common);
+    if (c < 0) return {0, 0};
+    if (c > 0) return {count, count};
+
+    int64_t p = encode(key);
+    if (p > last) return {count, count};
+    size_t lo = first_not_less(p);
+    const int64_t* level0 = nodes[level_start.back()].key;
+    if (level0[lo] != p) return {lo, lo};
+    size_t hi = p == last ? count : first_not_less(p + 1);
+    return {lo, hi};
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// PrefixIndex: search structure over a sorted array of keys
+// ----------------------------------------
+// Binary search over a std::vector of std::string touches a different heap
+// allocation at every probe. PrefixIndex instead keeps, for every key, the 8
+// bytes that follow the prefix shared by all keys, as one big-endian integer,
+// and arranges those integers as a static B+tree of 64-byte nodes (8 keys,
+// one cache line each). Level 0 is the sorted array itself; every node of a
+// level above holds the largest key of 8 nodes below it. A lookup reads one
+// node per level, comparing all 8 lanes at once with SSE4.2 or AVX2 where
+// the CPU has them (chosen at runtime by CPU detection, scalar otherwise).
+//
+// Integers are only a proxy for the keys: lower_bound() narrows the answer
+// to the run of keys whose 8 bytes tie with the target's and compares full
+// keys only inside that run (usually empty or a single key).
+class PrefixIndex {
+public:
+    enum class Isa { Scalar, SSE42, AVX2 };
+
+    static constexpr size_t kFanout = 8;   // keys per node
+
+    PrefixIndex() = default;
+
+    // Build over 'keys', which must be sorted. 'isa' is lowered to what the CPU supports.
+    void build(std::span<const std::string_view> keys, Isa isa = best_isa());
+
+    // Position of the first key >= 'key' (size() if none). key_at(i) must
+    // return the i-th key the index was built from.
+    template <class KeyAt>
+    [[nodiscard]] size_t lower_bound(std::string_view key, KeyAt&& key_at) const {
+        auto [lo, hi] = candidates(key);
+        while (lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            if (std::string_view(key_at(mid)) < key) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+    // [lo, hi): every key before lo is < 'key' and every key from hi on is > 'key'.
+    [[nodiscard]] std::pair<size_t, size_t> candidates(std::string_view key) const;
+
+    [[nodiscard]] size_t size() const { return count; }
+    [[nodiscard]] bool empty() const { return count == 0; }
+    [[nodiscard]] Isa isa() const { return search_isa; }
+    [[nodiscard]] size_t memory_usage() const { return nodes.capacity() * sizeof(Node) + common.capacity(); }
+
+    // Widest instruction set this CPU supports.
+    [[nodiscard]] static Isa best_isa();
+
+private:
+    // Keys are stored with the sign bit flipped so that signed 64-bit lane
+    // compares (the only kind SSE4.2/AVX2 have) order them as unsigned.
+    struct alignas(64) Node {
+        int64_t key[kFanout];
+    };
+
+    std::vector<Node> nodes;              // levels top (root) first
+    std::vector<size_t> level_start;      // first node of each level, top first; the last is level 0
+    std::string common;                   // prefix shared by every key
+    size_t count{0};
+    int64_t last{0};                      // largest stored key
+    Isa search_isa{Isa::Scalar};
+
+    // Stored form of the 8 bytes of 'key' after 'common' (zero-padded).
+    [[nodiscard]] int64_t encode(std::string_view key) const;
+
+    // Position of the first stored key >= p; p must not exceed 'last'.
+    [[nodiscard]] size_t first_not_less(int64_t p) const;
+};
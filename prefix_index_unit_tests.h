@@ -0,0 +1,77 @@
+#ifndef KVDATABASE_PREFIX_INDEX_UNIT_TESTS_H
+#define KVDATABASE_PREFIX_INDEX_UNIT_TESTS_H
+
+#include "prefix_index.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Every probe must land where std::lower_bound over the full keys does.
+inline void check_prefix_index(std::vector<std::string> keys, const std::vector<std::string>& probes) {
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    std::vector<std::string_view> views(keys.begin(), keys.end());
+    for (auto isa : {PrefixIndex::Isa::Scalar, PrefixIndex::Isa::SSE42, PrefixIndex::Isa::AVX2}) {
+        PrefixIndex ix;
+        ix.build(views, isa);
+        assert(ix.size() == keys.size());
+        auto key_at = [&](size_t i) -> const std::string& { return keys[i]; };
+        auto check = [&](const std::string& probe) {
+            size_t want = (size_t)(std::lower_bound(keys.begin(), keys.end(), probe) - keys.begin());
+            assert(ix.lower_bound(probe, key_at) == want);
+        };
+        for (const auto& k : keys) {
+            check(k);
+            check(k + '\0');
+            check(k + "\xff");
+            if (!k.empty()) check(k.substr(0, k.size() - 1));
+        }
+        for (const auto& p : probes) check(p);
+    }
+}
+
+void test_prefix_index_matches_lower_bound() {
+    check_prefix_index({}, {"", "a"});
+    check_prefix_index({"only"}, {"", "a", "only", "onlz", "zzz"});
+
+    // sizes around node and level boundaries
+    for (int n : {7, 8, 9, 63, 64, 65, 513, 4100}) {
+        std::vector<std::string> keys;
+        for (int i = 0; i < n; ++i) keys.push_back("key" + std::to_string(100000 + i * 3));
+        check_prefix_index(keys, {"", "k", "key", "key1", "key2", "kez", "\xff"});
+    }
+
+    // long shared prefix, keys that differ only past the 8 stored bytes,
+    // short keys, NUL and 0xff bytes
+    std::vector<std::string> keys;
+    const std::string shared = "tenant/0042/table/orders/";
+    for (int i = 0; i < 300; ++i) keys.push_back(shared + "row/" + std::to_string(i % 40) + "/" + std::to_string(i));
+    for (int i = 0; i < 50; ++i) keys.push_back(shared + "rowXXXXXXXXXXXX" + std::to_string(i));
+    keys.push_back(shared);
+    keys.push_back(shared + std::string(3, '\0'));
+    keys.push_back(shared + std::string(12, '\xff'));
+    keys.push_back(shared + "r");
+    check_prefix_index(keys, {"", "tenant", "tenant/0042/table/orders", "tenant/0043", "tenant/0041/zzz",
+                              shared + "row", shared + "rowXXXXXXXXXXXX", shared + "rowXXXXXXXXXXXX5x", "zzz"});
+
+    // random binary keys
+    std::mt19937 rng(7);
+    std::vector<std::string> random;
+    std::vector<std::string> probes;
+    for (int i = 0; i < 2000; ++i) {
+        std::string k(1 + rng() % 12, '\0');
+        for (char& c : k) c = (char)(rng() % 4 == 0 ? 0xff : rng() % 3);
+        (i % 4 ? random : probes).push_back(k);
+    }
+    check_prefix_index(random, probes);
+}
+
+void run_prefix_index_tests() {
+    test_prefix_index_matches_lower_bound();
+    std::cout << "✅ All PrefixIndex tests passed!" << std::endl;
+}
+
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+#include <string>
+#include <optional>
+#include <utility>
+#include <cstdint>
+
+// Outcome of a point lookup against one layer of the engine
+// (the memtable or a single SSTable).
+//  - NotFound: this layer knows nothing about the key, keep looking in older layers
+//  - Found:    the key has a live value in this layer
+//  - Deleted:  the key was removed in this layer (tombstone), older layers must be ignored
+enum class LookupResult {
+    NotFound,
+    Found,
+    Deleted,
+};
+
+// One logical record as it moves from the memtable to an SSTable.
+// A missing value (std::nullopt) is a tombstone.
+using KVRecord = std::pair<std::string, std::optional<std::string>>;
+
+// Value length written in place of a real length for tombstone records.
+constexpr uint32_t kTombstoneVlen = 0xFFFFFFFFu;
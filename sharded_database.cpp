@@ -0,0 +1,174 @@
+#include "sharded_database.h"
+#include "bloom_filter.h"
+#include <filesystem>
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <cstdio>
+#include <unistd.h>
+#include <fcntl.h>
+
+namespace fs = std::filesystem;
+
+// Seed of the shard hash; differs from the Bloom filter's so that the keys of
+// one shard do not all share part of their filter hash.
+static constexpr uint64_t kShardHashSeed = 0x5A4D3C2B1E0F9687ull;
+
+ShardedKVDatabase::ShardedKVDatabase(std::string dir_, ShardedKVOptions options)
+    : dir(std::move(dir_)) {
+    fs::create_directories(dir);
+    size_t recorded = read_shard_count();
+    size_t n = options.shards;
+    if (n == 0) n = recorded ? recorded : std::max(1u, std::thread::hardware_concurrency());
+    if (recorded && recorded != n)
+        throw std::invalid_argument("database was created with " + std::to_string(recorded) + " shards");
+    if (!recorded) save_shard_count(n);
+
+    // One page cache and one decompressed block cache for the whole database
+    KVOptions& shard_options = options.shard;
+    if (shard_options.block_cache_bytes > 0 && !shard_options.sstable.buffer_pool) {
+        BufferPoolOptions cache;
+        cache.capacity_bytes = shard_options.block_cache_bytes;
+        cache.policy = shard_options.block_cache_policy;
+        shard_options.sstable.buffer_pool = std::make_shared<BufferPool>(cache);
+    }
+    if (shard_options.decompressed_cache_bytes > 0 && !shard_options.sstable.block_cache)
+        shard_options.sstable.block_cache = std::make_shared<BlockCache>(shard_options.decompressed_cache_bytes);
+    buffer_pool = shard_options.sstable.buffer_pool;
+    block_cache = shard_options.sstable.block_cache;
+
+    shards.resize(n);
+    for_each_shard([&](size_t i) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "shard_%03zu", i);
+        shards[i] = std::make_unique<KVDatabase>((fs::path(dir) / name).string(), shard_options);
+    });
+}
+
+size_t ShardedKVDatabase::read_shard_count() const {
+    std::ifstream in(fs::path(dir) / "SHARDS");
+    size_t n = 0;
+    if (in && !(in >> n)) throw std::runtime_error("corrupt SHARDS file");
+    return n;
+}
+
+// Written like the MANIFEST: temp file, fdatasync, rename.
+void ShardedKVDatabase::save_shard_count(size_t n) const {
+    std::string body = std::to_string(n) + "\n";
+    std::string path = (fs::path(dir) / "SHARDS").string();
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
+    if (fd < 0) throw std::runtime_error("open SHARDS for write failed");
+    bool ok = ::write(fd, body.data(), body.size()) == (ssize_t)body.size() && ::fdatasync(fd) == 0;
+    ::close(fd);
+    if (!ok || ::rename(tmp.c_str(), path.c_str()) != 0) {
+        ::unlink(tmp.c_str());
+        throw std::runtime_error("write SHARDS failed");
+    }
+}
+
+void ShardedKVDatabase::for_each_shard(const std::function<void(size_t)>& fn) const {
+    if (shards.size() == 1) return fn(0);
+    std::exception_ptr error;
+    std::mutex error_mu;
+    std::vector<std::thread> threads;
+    threads.reserve(shards.size());
+    for (size_t i = 0; i < shards.size(); ++i) {
+        threads.emplace_back([&, i] {
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mu);
+                if (!error) error = std::current_exception();
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    if (error) std::rethrow_exception(error);
+}
+
+size_t ShardedKVDatabase::shard_of(std::string_view key) const {
+    return (size_t)(hash_key(key, kShardHashSeed) % shards.size());
+}
+
+void ShardedKVDatabase::put(const std::string& key, const std::string& value) {
+    shards[shard_of(key)]->put(key, value);
+}
+
+bool ShardedKVDatabase::get(const std::string& key, std::string& value_out) const {
+    return shards[shard_of(key)]->get(key, value_out);
+}
+
+void ShardedKVDatabase::remove(const std::string& key) {
+    shards[shard_of(key)]->remove(key);
+}
+
+std::vector<std::optional<std::string>> ShardedKVDatabase::multi_get(std::span<const std::string> keys) const {
+    std::vector<std::optional<std::string>> results(keys.size());
+    std::vector<std::vector<size_t>> positions(shards.size());
+    for (size_t i = 0; i < keys.size(); ++i) positions[shard_of(keys[i])].push_back(i);
+
+    std::vector<std::string> batch;
+    for (size_t s = 0; s < shards.size(); ++s) {
+        if (positions[s].empty()) continue;
+        batch.clear();
+        for (size_t i : positions[s]) batch.push_back(keys[i]);
+        std::vector<std::optional<std::string>> got = shards[s]->multi_get(batch);
+        for (size_t j = 0; j < got.size(); ++j) results[positions[s][j]] = std::move(got[j]);
+    }
+    return results;
+}
+
+void ShardedKVDatabase::scan(const std::string& start, const std::string& end,
+                             const std::function<void(const std::string&, const std::string&)>& visit) const {
+    auto it = iterator();
+    std::string k, v;
+    for (it->seek(start); it->valid() && it->key() <= end; it->next()) {
+        k.assign(it->key());
+        v.assign(it->value());
+        visit(k, v);
+    }
+}
+
+std::unique_ptr<Iterator> ShardedKVDatabase::iterator() const {
+    std::vector<std::unique_ptr<Iterator>> children;
+    children.reserve(shards.size());
+    for (const auto& s : shards) children.push_back(s->iterator());
+    return std::make_unique<MergingIterator>(std::move(children));
+}
+
+void ShardedKVDatabase::flush() {
+    for_each_shard([this](size_t i) { shards[i]->flush(); });
+}
+
+void ShardedKVDatabase::compact() {
+    for_each_shard([this](size_t i) { shards[i]->compact(); });
+}
+
+size_t ShardedKVDatabase::sstable_count() const {
+    size_t n = 0;
+    for (const auto& s : shards) n += s->sstable_count();
+    return n;
+}
+
+KVStats ShardedKVDatabase::stats() const {
+    KVStats s;
+    for (const auto& shard : shards) s.merge(shard->stats());
+    // every shard reported the shared caches in full
+    if (buffer_pool) {
+        BufferPoolStats cache = buffer_pool->stats();
+        s.cache_hits = cache.hits;
+        s.cache_misses = cache.misses;
+        s.cache_evictions = cache.evictions;
+        s.cache_hit_rate = cache.hit_rate();
+    }
+    if (block_cache) {
+        BufferPoolStats blocks = block_cache->stats();
+        s.decompressed_cache_hits = blocks.hits;
+        s.decompressed_cache_misses = blocks.misses;
+    }
+    return s;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <optional>
+#include <span>
+#include "kv_database.h"
+#include "iterator.h"
+
+// Tunables for a ShardedKVDatabase.
+struct ShardedKVOptions {
+    // Number of shards; 0 = the count the directory was created with, or
+    // std::thread::hardware_concurrency() for a new database.
+    size_t shards = 0;
+    // Options of every shard. Memtable limits and compaction triggers apply
+    // per shard; block_cache_bytes and decompressed_cache_bytes size one
+    // BufferPool and one BlockCache shared by all shards.
+    KVOptions shard;
+};
+
+// ShardedKVDatabase: hash-partitioned set of independent KVDatabases
+// ----------------------------------------
+// A stable 64-bit hash of the key picks its shard. Every shard is a complete
+// KVDatabase - memtable, write-ahead log, SSTables, flush and compaction
+// threads, engine mutex - so operations on keys of different shards share
+// no lock and no log, and writers on many cores do not queue behind one WAL
+// append. Point operations touch one shard; multi_get() splits the batch by
+// shard; scans and iterators merge the shards' iterators (the shards hold
+// disjoint keys, so the merge only interleaves them back into key order).
+// flush(), compact() and opening run on all shards in parallel.
+//
+// The shard count is fixed when the database is created (a key must always
+// hash to the shard that holds it) and recorded in 'dir':
+//   SHARDS                  the shard count
+//   shard_000/, shard_001/  one KVDatabase directory per shard
+class ShardedKVDatabase {
+public:
+    // Open (or create) the database in 'dir'. Throws std::invalid_argument if
+    // options.shards differs from the count 'dir' was created with.
+    explicit ShardedKVDatabase(std::string dir, ShardedKVOptions options = {});
+
+    ShardedKVDatabase(const ShardedKVDatabase&) = delete;
+    ShardedKVDatabase& operator=(const ShardedKVDatabase&) = delete;
+
+    void put(const std::string& key, const std::string& value);
+    bool get(const std::string& key, std::string& value_out) const;
+    void remove(const std::string& key);
+
+    // Batched get, one KVDatabase::multi_get() per shard holding any of the keys.
+    [[nodiscard]] std::vector<std::optional<std::string>> multi_get(std::span<const std::string> keys) const;
+
+    // Visit live key-value pairs with start <= key <= end in ascending key order.
+    void scan(const std::string& start, const std::string& end,
+              const std::function<void(const std::string&, const std::string&)>& visit) const;
+
+    // Iterator over live key-value pairs of all shards in ascending key order.
+    [[nodiscard]] std::unique_ptr<Iterator> iterator() const;
+
+    void flush();
+    void compact();
+
+    [[nodiscard]] size_t shard_count() const { return shards.size(); }
+    [[nodiscard]] size_t shard_of(std::string_view key) const;
+    [[nodiscard]] KVDatabase& shard(size_t i) { return *shards[i]; }
+    [[nodiscard]] size_t sstable_count() const;
+
+    // Stats of all shards merged (see KVStats::merge); cache counters are
+    // those of the shared caches.
+    [[nodiscard]] KVStats stats() const;
+
+private:
+    std::string dir;
+    std::vector<std::unique_ptr<KVDatabase>> shards;
+    std::shared_ptr<BufferPool> buffer_pool;    // shared by the shards (null without a page cache)
+    std::shared_ptr<BlockCache> block_cache;    // likewise for decompressed blocks
+
+    // Shard count recorded in 'dir' (0 if none), and recording it.
+    [[nodiscard]] size_t read_shard_count() const;
+    void save_shard_count(size_t n) const;
+
+    // Run fn(i) for every shard, one thread per shard; rethrows the first failure.
+    void for_each_shard(const std::function<void(size_t)>& fn) const;
+};
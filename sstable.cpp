@@ -1,169 +1,1009 @@
-#include "sstable.h"
-#include <unistd.h>
-#include <fcntl.h>
-#include <sys/stat.h>
-#include <sys/types.h>
-#include <stdexcept>
-#include <algorithm>
-
-// Helper: append file extension to a base path.
-// Example: "sst_000001" + ".sst" -> "sst_000001.sst"
-static std::string with_ext(const std::string& base, const char* ext) {
-    return base + ext;
-}
-
-// Constructor: initialize data and index file paths.
-SSTable::SSTable(std::string base_no_ext) {
-    data_path  = with_ext(base_no_ext, ".sst");
-    index_path = with_ext(base_no_ext, ".idx");
-}
-
-// Write a 32-bit unsigned integer (binary form) into file
-void SSTable::write_u32(int fd, uint32_t v) {
-    if (::write(fd, &v, sizeof(v)) != (ssize_t)sizeof(v)) throw std::runtime_error("write_u32");
-}
-// Write a 64-bit unsigned integer (binary form) into file.
-void SSTable::write_u64(int fd, uint64_t v) {
-    if (::write(fd, &v, sizeof(v)) != (ssize_t)sizeof(v)) throw std::runtime_error("write_u64");
-}
-// Read a 32-bit unsigned integer from file at given offset.
-uint32_t SSTable::read_u32_at(int fd, uint64_t off) {
-    uint32_t v{};
-    if (::pread(fd, &v, sizeof(v), off) != (ssize_t)sizeof(v)) throw std::runtime_error("pread u32");
-    return v;
-}
-// Read a 64-bit unsigned integer from file at given offset.
-uint64_t SSTable::read_u64_at(int fd, uint64_t off) {
-    uint64_t v{};
-    if (::pread(fd, &v, sizeof(v), off) != (ssize_t)sizeof(v)) throw std::runtime_error("pread u64");
-    return v;
-}
-
-// SSTable::build()
-// Build an immutable SSTable on disk from sorted key-value pairs.
-// Writes two files:
-//   - data file (.sst): stores actual key/value records
-//   - index file (.idx): stores key -> offset mappings
-// Returns an SSTable object ready for reading.
-SSTable SSTable::build(const std::string& base_no_ext,
-                       const std::vector<std::pair<std::string, std::string>>& sorted_kv) {
-    SSTable t(base_no_ext);
-
-    // Open data and index files for writing
-    int dfd = ::open(t.data_path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
-    if (dfd < 0) throw std::runtime_error("open data for write failed");
-    int ifd = ::open(t.index_path.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0644);
-    if (ifd < 0) { ::close(dfd); throw std::runtime_error("open index for write failed"); }
-
-    // Write the total number of entries into the index file
-    uint32_t n = (uint32_t)sorted_kv.size();
-    write_u32(ifd, n);
-
-    // Keep track of byte offset within the data file
-    uint64_t off = 0;
-    for (auto& kv : sorted_kv) {
-        const std::string& k = kv.first;
-        const std::string& v = kv.second;
-        uint32_t klen = (uint32_t)k.size(), vlen = (uint32_t)v.size();
-
-        // index Format: [key_len][key_bytes][offset]
-        write_u32(ifd, klen);
-        if (::write(ifd, k.data(), klen) != (ssize_t)klen) { ::close(ifd); ::close(dfd); throw std::runtime_error("write idx key"); }
-        write_u64(ifd, off);
-
-        // data Format: [key_len][val_len][key_bytes][val_bytes]
-        write_u32(dfd, klen);
-        write_u32(dfd, vlen);
-        if (::write(dfd, k.data(), klen) != (ssize_t)klen) { ::close(ifd); ::close(dfd); throw std::runtime_error("write data key"); }
-        if (::write(dfd, v.data(), vlen) != (ssize_t)vlen) { ::close(ifd); ::close(dfd); throw std::runtime_error("write data val"); }
-
-        // Update next offset in data file
-        off += sizeof(uint32_t)*2 + klen + vlen;
-    }
-    ::close(ifd);
-    ::close(dfd);
-
-    // Open table for reading (load index into memory)
-    t.open();
-    return t;
-}
-
-void SSTable::open() {
-    int ifd = ::open(index_path.c_str(), O_RDONLY);
-    if (ifd < 0) throw std::runtime_error("open index for read failed");
-
-    // Read number of entries
-    uint32_t n{};
-    if (::read(ifd, &n, sizeof(n)) != (ssize_t)sizeof(n)) { ::close(ifd); throw std::runtime_error("read n"); }
-
-    // Read index entries one by one
-    index.clear(); index.reserve(n);
-    for (uint32_t i=0;i<n;++i) {
-        uint32_t klen{};
-        if (::read(ifd, &klen, sizeof(klen)) != (ssize_t)sizeof(klen)) { ::close(ifd); throw std::runtime_error("read klen"); }
-        std::string k(klen, '\0');
-        if (::read(ifd, k.data(), klen) != (ssize_t)klen) { ::close(ifd); throw std::runtime_error("read key"); }
-        uint64_t off{};
-        if (::read(ifd, &off, sizeof(off)) != (ssize_t)sizeof(off)) { ::close(ifd); throw std::runtime_error("read off"); }
-        index.push_back({std::move(k), off});
-    }
-    ::close(ifd);
-
-    data_fd = ::open(data_path.c_str(), O_RDONLY);
-    if (data_fd < 0) throw std::runtime_error("open data for read failed");
-}
-
-void SSTable::close() {
-    if (data_fd >= 0) { ::close(data_fd); data_fd = -1; }
-    index.clear();
-}
-
-// SSTable::read_record_at()
-// --------------------------------------------------------------------
-// Given an offset, read one complete key-value record from data file.
-// Record format: [key_len][val_len][key_bytes][val_bytes]
-bool SSTable::read_record_at(int fd, uint64_t off, std::string& k, std::string& v) {
-    uint32_t klen = read_u32_at(fd, off);
-    uint32_t vlen = read_u32_at(fd, off + sizeof(uint32_t));
-    k.resize(klen); v.resize(vlen);
-    if (::pread(fd, k.data(), klen, off + sizeof(uint32_t)*2) != (ssize_t)klen) return false;
-    if (::pread(fd, v.data(), vlen, off + sizeof(uint32_t)*2 + klen) != (ssize_t)vlen) return false;
-    return true;
-}
-
-// SSTable::get()
-// --------------------------------------------------------------------
-// Binary-search the in-memory index to find key, then read the record
-// from the data file using its offset. Returns true if found.
-bool SSTable::get(const std::string& key, std::string& value_out) const {
-    if (index.empty() || data_fd < 0) return false;
-    auto it = std::lower_bound(index.begin(), index.end(), key,
-        [](const SSTIndexEntry& e, const std::string& k){ return e.key < k; });
-    if (it == index.end() || it->key != key) return false;
-
-    std::string k, v;
-    if (!read_record_at(data_fd, it->offset, k, v)) return false;
-    if (k != key) return false;
-    value_out = std::move(v);
-    return true;
-}
-
-// SSTable::scan()
-// --------------------------------------------------------------------
-// Range scan from 'start' to 'end' (inclusive).
-// Iterates through index and invokes user-supplied callback 'visit'.
-void SSTable::scan(const std::string& start, const std::string& end,
-                   const std::function<void(const std::string&, const std::string&)>& visit) const {
-    if (index.empty() || data_fd < 0) return;
-    auto it = std::lower_bound(index.begin(), index.end(), start,
-        [](const SSTIndexEntry& e, const std::string& k){ return e.key < k; });
-
-    for (; it != index.end(); ++it) {
-        if (it->key > end) break;
-        std::string k, v;
-        if (!read_record_at(data_fd, it->offset, k, v)) break;
-        if (k < start) continue;
-        if (k > end) break;
-        visit(k, v);
-    }
-}
+#include "sstable.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include "sstable_format.h"
+#include "sstable_writer.h"
+#include "compression.h"
+
+using namespace sst_format;
+
+// Helper: append file extension to a base path.
+// Example: "sst_000001" + ".sst" -> "sst_000001.sst"
+static std::string with_ext(const std::string& base, const char* ext) {
+    return base + ext;
+}
+
+// [offset varint][size varint] value of an index entry (v3 index block or B+tree page).
+static void decode_handle(std::string_view value, uint64_t& off, uint32_t& size) {
+    const char* p = value.data();
+    const char* end = p + value.size();
+    if (!get_varint64(p, end, off) || !get_varint32(p, end, size)) throw std::runtime_error("corrupt index block");
+}
+
+// Constructor: initialize data and index file paths.
+SSTable::SSTable(std::string base_no_ext) {
+    data_path  = with_ext(base_no_ext, ".sst");
+    index_path = with_ext(base_no_ext, ".idx");
+}
+
+// Read a 32-bit unsigned integer from file at given offset.
+uint32_t SSTable::read_u32_at(int fd, uint64_t off) {
+    uint32_t v{};
+    if (::pread(fd, &v, sizeof(v), off) != (ssize_t)sizeof(v)) throw std::runtime_error("pread u32");
+    return v;
+}
+// Read a 64-bit unsigned integer from file at given offset.
+uint64_t SSTable::read_u64_at(int fd, uint64_t off) {
+    uint64_t v{};
+    if (::pread(fd, &v, sizeof(v), off) != (ssize_t)sizeof(v)) throw std::runtime_error("pread u64");
+    return v;
+}
+
+// SSTable::build()
+// Build an immutable block-format SSTable on disk from sorted key-value pairs.
+// Convenience wrapper over SSTableWriter for callers that already hold the
+// records in memory. Returns an SSTable object ready for reading.
+SSTable SSTable::build(const std::string& base_no_ext,
+                       const std::vector<std::pair<std::string, std::string>>& sorted_kv,
+                       const SSTableOptions& options) {
+    SSTableWriter w(base_no_ext, options);
+    for (const auto& [k, v] : sorted_kv) w.add(k, v);
+    return w.finish();
+}
+
+SSTable SSTable::build(const std::string& base_no_ext,
+                       const std::vector<KVRecord>& sorted_records,
+                       const SSTableOptions& options) {
+    SSTableWriter w(base_no_ext, options);
+    for (const auto& [k, v] : sorted_records) {
+        if (v) w.add(k, *v);
+        else w.add_tombstone(k);
+    }
+    return w.finish();
+}
+
+void SSTable::open(SSTableReadMode mode, std::shared_ptr<BufferPool> pool, std::shared_ptr<AsyncReader> async,
+                   std::shared_ptr<BlockCache> blocks) {
+    data_fd = ::open(data_path.c_str(), O_RDONLY);
+    if (data_fd < 0) throw std::runtime_error("open data for read failed");
+
+    try {
+        if (!open_block_format()) open_legacy_index();
+        index_search = PrefixIndex();
+        if (use_prefix_index && !index.empty()) {
+            std::vector<std::string_view> keys(index.size());
+            for (size_t i = 0; i < index.size(); ++i) keys[i] = index[i].key;
+            index_search.build(keys);
+        }
+        read_mode = mode;
+        if (mode == SSTableReadMode::Mmap) map_file();
+        else if (pool) {
+            buffer_pool = std::move(pool);
+            cache_file_id = buffer_pool->register_file();
+        }
+        if (mode == SSTableReadMode::Pread && async) {
+            async_reader = std::move(async);
+            async_file = async_reader->register_file(data_fd);
+        }
+        if (compression != CompressionType::None && blocks) {
+            block_cache = std::move(blocks);
+            block_cache_file_id = block_cache->register_file();
+        }
+    } catch (...) {
+        close();
+        throw;
+    }
+}
+
+// Map the whole data file read-only. Point lookups dominate, so tell the
+// kernel not to read ahead; scan_impl() switches its range to sequential.
+void SSTable::map_file() {
+    struct stat st{};
+    if (::fstat(data_fd, &st) != 0) throw std::runtime_error("stat data");
+    map_size = (size_t)st.st_size;
+    if (map_size == 0) return;   // empty legacy table: nothing to map, index is empty too
+    void* p = ::mmap(nullptr, map_size, PROT_READ, MAP_SHARED, data_fd, 0);
+    if (p == MAP_FAILED) { map_size = 0; throw std::runtime_error("mmap sstable"); }
+    map_base = static_cast<const char*>(p);
+    ::madvise(p, map_size, MADV_RANDOM);
+}
+
+// SSTable::open_block_format()
+// --------------------------------------------------------------------
+// Read the footer at the end of the data file. If it carries our magic,
+// load the per-block index it points to (or the top of its B+tree).
+bool SSTable::open_block_format() {
+    struct stat st{};
+    if (::fstat(data_fd, &st) != 0) throw std::runtime_error("stat data");
+    uint64_t file_size = (uint64_t)st.st_size;
+    if (file_size < kFooterTail) return false;
+
+    uint64_t magic = read_u64_at(data_fd, file_size - sizeof(uint64_t));
+    if (magic != kFooterMagic) return false;
+    uint32_t version = read_u32_at(data_fd, file_size - sizeof(uint64_t) - sizeof(uint32_t));
+    uint32_t fields_size = read_u32_at(data_fd, file_size - kFooterTail);
+    if (version != kBlockFormat && version != kPrefixFormat) throw std::runtime_error("unsupported sstable format version");
+    if (fields_size < 4 * sizeof(uint64_t) || fields_size > file_size - kFooterTail)
+        throw std::runtime_error("corrupt sstable footer");
+
+    std::string fields(fields_size, '\0');
+    if (::pread(data_fd, fields.data(), fields_size, file_size - kFooterTail - fields_size) != (ssize_t)fields_size)
+        throw std::runtime_error("read footer");
+    // Fields appended by newer writers are ignored; ones this file predates read as 0
+    auto field = [&](FooterField i) -> uint64_t {
+        return (i + 1) * sizeof(uint64_t) <= fields_size ? get_u64(fields.data() + i * sizeof(uint64_t)) : 0;
+    };
+    uint64_t index_offset = field(kIndexOffset);
+    uint64_t index_size = field(kIndexSize);
+    num_entries = field(kNumEntries);
+    uint64_t filter_offset = field(kFilterOffset);
+    uint64_t filter_size = field(kFilterSize);
+    uint64_t codec = field(kCompression);
+    uint64_t levels = std::max<uint64_t>(field(kIndexLevels), 1);
+    separated_values = field(kSeparatedValues) != 0;
+    if (codec > (uint64_t)CompressionType::LZ) throw std::runtime_error("unsupported sstable compression");
+    compression = (CompressionType)codec;
+    if (index_offset + index_size > file_size || index_size < sizeof(uint32_t))
+        throw std::runtime_error("corrupt sstable footer");
+    if (filter_offset + filter_size > file_size)
+        throw std::runtime_error("corrupt sstable footer");
+    if (levels > 1 && version != kPrefixFormat) throw std::runtime_error("corrupt sstable footer");
+    // Older writers put the index right after the data blocks
+    data_end = (kFilterOffset + 1) * sizeof(uint64_t) <= fields_size ? filter_offset : index_offset;
+
+    filter = BloomFilter();
+    if (filter_size > 0) {
+        std::string fbuf(filter_size, '\0');
+        if (::pread(data_fd, fbuf.data(), filter_size, filter_offset) != (ssize_t)filter_size)
+            throw std::runtime_error("read filter block");
+        filter = BloomFilter(std::move(fbuf));
+    }
+
+    index.clear();
+    format_version = version;
+    if (levels > 1) {
+        index_levels = (uint32_t)levels;
+        open_index_tree(index_offset, index_size);
+        return true;
+    }
+
+    // One read for the whole index block
+    std::string buf(index_size, '\0');
+    if (::pread(data_fd, buf.data(), index_size, index_offset) != (ssize_t)index_size)
+        throw std::runtime_error("read index block");
+
+    if (prefix_keys()) {
+        for (BlockReader r(buf, true); r.valid(); r.next()) {
+            uint64_t off;
+            uint32_t size;
+            if (r.deleted()) throw std::runtime_error("corrupt index block");
+            decode_handle(r.value(), off, size);
+            index.push_back({std::string(r.key()), off, size});
+        }
+        return true;
+    }
+
+    const char* p = buf.data();
+    const char* end = p + buf.size();
+    uint32_t n = get_u32(p);
+    p += sizeof(uint32_t);
+    index.reserve(n);
+    for (uint32_t i = 0; i < n; ++i) {
+        if (end - p < (ptrdiff_t)sizeof(uint32_t)) throw std::runtime_error("corrupt index block");
+        uint32_t klen = get_u32(p);
+        p += sizeof(uint32_t);
+        if (end - p < (ptrdiff_t)(klen + sizeof(uint64_t) + sizeof(uint32_t))) throw std::runtime_error("corrupt index block");
+        std::string k(p, klen);
+        p += klen;
+        uint64_t off = get_u64(p);
+        uint32_t size = get_u32(p + sizeof(uint64_t));
+        p += sizeof(uint64_t) + sizeof(uint32_t);
+        index.push_back({std::move(k), off, size});
+    }
+    return true;
+}
+
+// SSTable::open_index_tree()
+// --------------------------------------------------------------------
+// Pin the root of a B+tree index, then the internal levels below it, top
+// down, for as long as they fit in kMaxPinnedIndexBytes in total. The pages
+// of a level are written next to each other, so each pinned level costs one
+// read. Leaves are never pinned.
+void SSTable::open_index_tree(uint64_t root_offset, uint64_t root_size) {
+    auto read_pages = [this](uint64_t off, uint64_t len) {
+        std::string buf(len, '\0');
+        if (::pread(data_fd, buf.data(), len, (off_t)off) != (ssize_t)len) throw std::runtime_error("read index block");
+        return buf;
+    };
+    // (offset, size) of the pages of the level below the one just pinned
+    std::vector<std::pair<uint64_t, uint32_t>> below;
+    auto children = [&below](std::string_view page) {
+        for (BlockReader r(page, true); r.valid(); r.next()) {
+            uint64_t off;
+            uint32_t size;
+            if (r.deleted()) throw std::runtime_error("corrupt index block");
+            decode_handle(r.value(), off, size);
+            if (!below.empty() && off != below.back().first + below.back().second)
+                throw std::runtime_error("corrupt index block");
+            below.emplace_back(off, size);
+        }
+    };
+
+    index_root = {{}, root_offset, (uint32_t)root_size};
+    std::string root = read_pages(root_offset, root_size);
+    BlockReader last(root, true);
+    if (!last.valid()) throw std::runtime_error("corrupt index block");
+    for (; last.valid(); last.next()) tree_last_key.assign(last.key());
+    children(root);
+    pinned_index.emplace(root_offset, std::move(root));
+
+    size_t pinned = root_size;
+    for (uint32_t level = 1; level + 1 < index_levels; ++level) {
+        uint64_t from = below.front().first;
+        uint64_t len = below.back().first + below.back().second - from;
+        if (pinned + len > kMaxPinnedIndexBytes) break;
+        std::string run = read_pages(from, len);
+        std::vector<std::pair<uint64_t, uint32_t>> pages = std::move(below);
+        below.clear();
+        for (auto [off, size] : pages) {
+            std::string page = run.substr(off - from, size);
+            children(page);
+            pinned_index.emplace(off, std::move(page));
+        }
+        pinned += len;
+    }
+}
+
+std::string_view SSTable::index_page(uint64_t offset, uint32_t size, BlockBuffer& buf, AccessHint hint) const {
+    auto it = pinned_index.find(offset);
+    if (it != pinned_index.end()) return it->second;
+    return read_range(offset, size, buf.bytes, hint);
+}
+
+void SSTable::open_legacy_index() {
+    int ifd = ::open(index_path.c_str(), O_RDONLY);
+    if (ifd < 0) throw std::runtime_error("open index for read failed");
+
+    // Read number of entries
+    uint32_t n{};
+    if (::read(ifd, &n, sizeof(n)) != (ssize_t)sizeof(n)) { ::close(ifd); throw std::runtime_error("read n"); }
+
+    // Read index entries one by one
+    index.clear(); index.reserve(n);
+    for (uint32_t i=0;i<n;++i) {
+        uint32_t klen{};
+        if (::read(ifd, &klen, sizeof(klen)) != (ssize_t)sizeof(klen)) { ::close(ifd); throw std::runtime_error("read klen"); }
+        std::string k(klen, '\0');
+        if (::read(ifd, k.data(), klen) != (ssize_t)klen) { ::close(ifd); throw std::runtime_error("read key"); }
+        uint64_t off{};
+        if (::read(ifd, &off, sizeof(off)) != (ssize_t)sizeof(off)) { ::close(ifd); throw std::runtime_error("read off"); }
+        index.push_back({std::move(k), off});
+    }
+    ::close(ifd);
+    format_version = kLegacyFormat;
+    num_entries = n;
+}
+
+void SSTable::close() {
+    if (map_base) { ::munmap(const_cast<char*>(map_base), map_size); map_base = nullptr; }
+    map_size = 0;
+    if (data_fd >= 0) { ::close(data_fd); data_fd = -1; }
+    if (buffer_pool) { buffer_pool->forget_file(cache_file_id); buffer_pool.reset(); }
+    if (async_reader) { async_reader->unregister_file(async_file); async_reader.reset(); async_file = -1; }
+    if (block_cache) { block_cache->forget_file(block_cache_file_id); block_cache.reset(); }
+    index.clear();
+    index_search = PrefixIndex();
+    index_levels = 1;
+    pinned_index.clear();
+    tree_last_key.clear();
+    data_end = 0;
+    filter = BloomFilter();
+}
+
+size_t SSTable::find_index(std::string_view key) const {
+    if (!index_search.empty() && index_search.size() == index.size())
+        return index_search.lower_bound(key, [this](size_t i) -> const std::string& { return index[i].key; });
+    auto it = std::lower_bound(index.begin(), index.end(), key,
+        [](const SSTIndexEntry& e, std::string_view k){ return e.key < k; });
+    return (size_t)(it - index.begin());
+}
+
+// SSTable::IndexCursor
+// --------------------------------------------------------------------
+SSTable::IndexCursor::IndexCursor(const SSTable& t, AccessHint h) : table(&t), hint(h) {
+    // Sized once: readers point into their level's page buffer
+    if (t.index_levels > 1) levels.resize(t.index_levels);
+}
+
+void SSTable::IndexCursor::seek_to_first() {
+    if (levels.empty()) {
+        pos = 0;
+        is_valid = !table->index.empty();
+        return;
+    }
+    load(0, table->index_root.offset, table->index_root.size);
+    descend(0, nullptr);
+}
+
+void SSTable::IndexCursor::seek(std::string_view key) {
+    if (levels.empty()) {
+        pos = table->find_index(key);
+        is_valid = pos < table->index.size();
+        return;
+    }
+    load(0, table->index_root.offset, table->index_root.size);
+    descend(0, &key);
+}
+
+void SSTable::IndexCursor::advance_to(std::string_view key) {
+    if (levels.empty()) {
+        const auto& index = table->index;
+        while (pos < index.size() && index[pos].key < key) ++pos;
+        is_valid = pos < index.size();
+        return;
+    }
+    if (is_valid) {
+        if (cur.key >= key) return;
+        sst_format::BlockReader& leaf = levels.back().reader;
+        for (leaf.next(); leaf.valid(); leaf.next()) {
+            if (leaf.key() >= key) {
+                cur.key.assign(leaf.key());
+                decode_handle(leaf.value(), cur.offset, cur.size);
+                return;
+            }
+        }
+    }
+    seek(key);
+}
+
+void SSTable::IndexCursor::next() {
+    if (levels.empty()) {
+        is_valid = ++pos < table->index.size();
+        return;
+    }
+    // Step the deepest level that has an entry left, then go down its first entries
+    size_t level = levels.size() - 1;
+    levels[level].reader.next();
+    while (!levels[level].reader.valid()) {
+        if (level == 0) { is_valid = false; return; }
+        levels[--level].reader.next();
+    }
+    descend(level, nullptr);
+}
+
+void SSTable::IndexCursor::load(size_t level, uint64_t offset, uint32_t size) {
+    Level& l = levels[level];
+    if (l.offset != offset || l.data.empty()) {
+        l.data = table->index_page(offset, size, l.page, hint);
+        l.offset = offset;
+    }
+    l.reader.reset(l.data, true);
+}
+
+void SSTable::IndexCursor::descend(size_t level, const std::string_view* key) {
+    for (;; ++level) {
+        sst_format::BlockReader& r = levels[level].reader;
+        if (key) r.seek(*key);
+        if (!r.valid()) { is_valid = false; return; }
+        if (r.deleted()) throw std::runtime_error("corrupt index block");
+        uint64_t off;
+        uint32_t size;
+        decode_handle(r.value(), off, size);
+        if (level + 1 == levels.size()) {
+            cur.key.assign(r.key());
+            cur.offset = off;
+            cur.size = size;
+            is_valid = true;
+            return;
+        }
+        load(level + 1, off, size);
+    }
+}
+
+// Bytes [off, off + len) of the data file:
+//  - mmap mode: a view straight into the mapping
+//  - buffer pool: copied out of cached pages into 'scratch' (pread only on a page miss)
+//  - otherwise: one pread into 'scratch'
+std::string_view SSTable::read_range(uint64_t off, size_t len, std::string& scratch, AccessHint hint) const {
+    stats.bytes_read.add(len);
+    if (map_base) {
+        if (off + len > map_size) throw std::runtime_error("read beyond end of file");
+        return {map_base + off, len};
+    }
+
+    scratch.resize(len);
+    if (buffer_pool) {
+        const size_t page_size = buffer_pool->page_size();
+        size_t done = 0;
+        while (done < len) {
+            uint64_t pos = off + done;
+            auto page = buffer_pool->fetch(cache_file_id, data_fd, pos / page_size, hint);
+            size_t in_page = pos % page_size;
+            if (page.size() <= in_page) throw std::runtime_error("read beyond end of file");
+            size_t n = std::min(page.size() - in_page, len - done);
+            std::memcpy(scratch.data() + done, page.data() + in_page, n);
+            done += n;
+        }
+        return scratch;
+    }
+
+    stats.read_syscalls.add();
+    if (::pread(data_fd, scratch.data(), len, (off_t)off) != (ssize_t)len) throw std::runtime_error("pread sstable");
+    return scratch;
+}
+
+std::string_view SSTable::block_data(const SSTIndexEntry& block, BlockBuffer& buf, AccessHint hint) const {
+    if (compression != CompressionType::None && block_cache) {
+        if ((buf.pinned = block_cache->lookup(block_cache_file_id, block.offset))) return *buf.pinned;
+    }
+    stats.blocks_read.add();
+    return uncompress_block(block, read_range(block.offset, block.size, buf.bytes, hint), buf, hint);
+}
+
+// Only point reads fill the BlockCache: like AccessHint::Scan in the buffer
+// pool, a scan or compaction must not flush the blocks lookups keep hitting.
+std::string_view SSTable::uncompress_block(const SSTIndexEntry& block, std::string_view stored, BlockBuffer& buf,
+                                           AccessHint hint) const {
+    if (compression == CompressionType::None) return stored;
+    if (stored.empty()) throw std::runtime_error("corrupt compressed block");
+    auto tag = (uint8_t)stored.back();
+    stored.remove_suffix(1);
+    if (tag == kRawBlock) return stored;
+    if (tag != kLZBlock) throw std::runtime_error("corrupt compressed block");
+
+    const char* p = stored.data();
+    uint64_t raw_size;
+    if (!get_varint64(p, stored.data() + stored.size(), raw_size)) throw std::runtime_error("corrupt compressed block");
+    auto out = std::make_shared<std::string>();
+    if (!lz::decompress(stored.substr((size_t)(p - stored.data())), raw_size, *out))
+        throw std::runtime_error("corrupt compressed block");
+    if (block_cache && hint == AccessHint::Point) block_cache->insert(block_cache_file_id, block.offset, out);
+    buf.pinned = std::move(out);
+    return *buf.pinned;
+}
+
+// Legacy record at 'off' as views into the mapping or into 'scratch'.
+// Record format: [key_len][val_len][key_bytes][val_bytes]
+// A tombstone has val_len == kTombstoneVlen and no value bytes.
+bool SSTable::legacy_record(uint64_t off, std::string& scratch,
+                            std::string_view& k, std::string_view& v, bool& deleted, AccessHint hint) const {
+    stats.blocks_read.add();
+    std::string_view hdr = read_range(off, sizeof(uint32_t) * 2, scratch, hint);
+    uint32_t klen = get_u32(hdr.data());
+    uint32_t vlen = get_u32(hdr.data() + sizeof(uint32_t));
+    deleted = (vlen == kTombstoneVlen);
+    size_t vbytes = deleted ? 0 : vlen;
+
+    std::string_view body = read_range(off + sizeof(uint32_t) * 2, (size_t)klen + vbytes, scratch, hint);
+    k = body.substr(0, klen);
+    v = body.substr(klen);
+    return true;
+}
+
+// SSTable::get()
+// --------------------------------------------------------------------
+// Look the key up and copy its value out. Returns true if found.
+bool SSTable::get(const std::string& key, std::string& value_out) const {
+    return lookup(key, value_out) == LookupResult::Found;
+}
+
+bool SSTable::get(std::string_view key, std::string_view& value_out) const {
+    return lookup(key, value_out) == LookupResult::Found;
+}
+
+// SSTable::lookup()
+// --------------------------------------------------------------------
+// Ask the Bloom filter first: "definitely absent" needs no I/O at all.
+// Otherwise binary-search the in-memory block index for the only block that
+// can hold the key (the first whose last key is >= key), read that block with
+// a single pread (or address it in the mapping) and binary-search inside it.
+// Reports tombstones as LookupResult::Deleted so the caller knows to stop
+// looking in older tables.
+LookupResult SSTable::lookup(const std::string& key, std::string& value_out) const {
+    BlockBuffer scratch;
+    std::string_view v;
+    LookupResult res = lookup_impl(key, v, scratch);
+    if (res == LookupResult::Found) value_out.assign(v);
+    return res;
+}
+
+// Zero-copy variant: only valid in mmap mode, where the value can point into
+// the mapping. No syscalls, and no allocations with a flat index.
+LookupResult SSTable::lookup(std::string_view key, std::string_view& value_out) const {
+    if (data_fd >= 0 && read_mode != SSTableReadMode::Mmap)
+        throw std::logic_error("zero-copy lookup requires SSTableReadMode::Mmap");
+    if (compression != CompressionType::None) throw std::logic_error("zero-copy lookup requires an uncompressed table");
+    BlockBuffer unused;   // never written to in mmap mode
+    return lookup_impl(key, value_out, unused);
+}
+
+LookupResult SSTable::lookup_impl(std::string_view key, std::string_view& value_out, BlockBuffer& scratch) const {
+    stats.lookups.add();
+    if (!has_blocks() || data_fd < 0) return LookupResult::NotFound;
+
+    bool filtered = !filter.empty();
+    if (filtered) {
+        stats.filter_checks.add();
+        if (!filter.may_contain(key)) {
+            stats.filter_negatives.add();
+            return LookupResult::NotFound;
+        }
+    }
+
+    LookupResult res = format_version == kLegacyFormat ? lookup_legacy(key, value_out, scratch.bytes)
+                                                        : lookup_block(key, value_out, scratch);
+    if (filtered && res == LookupResult::NotFound)
+        stats.filter_false_positives.add();
+    return res;
+}
+
+// v2/v3: one block read, then binary search inside the block.
+LookupResult SSTable::lookup_block(std::string_view key, std::string_view& value_out, BlockBuffer& scratch) const {
+    IndexCursor blocks(*this, AccessHint::Point);
+    blocks.seek(key);
+    if (!blocks.valid()) return LookupResult::NotFound;
+
+    BlockReader block(block_data(blocks.entry(), scratch, AccessHint::Point), prefix_keys());
+    block.seek(key);
+    if (!block.valid() || block.key() != key) return LookupResult::NotFound;
+    if (block.deleted()) return LookupResult::Deleted;
+    value_out = block.value();
+    return LookupResult::Found;
+}
+
+// v1: binary-search the per-key index, then read the record at its offset.
+LookupResult SSTable::lookup_legacy(std::string_view key, std::string_view& value_out, std::string& scratch) const {
+    size_t pos = find_index(key);
+    if (pos == index.size() || index[pos].key != key) return LookupResult::NotFound;
+
+    std::string_view k, v;
+    bool deleted = false;
+    if (!legacy_record(index[pos].offset, scratch, k, v, deleted, AccessHint::Point)) return LookupResult::NotFound;
+    if (k != key) return LookupResult::NotFound;
+    if (deleted) return LookupResult::Deleted;
+    value_out = v;
+    return LookupResult::Found;
+}
+
+// SSTable::get_async()
+// --------------------------------------------------------------------
+// The Bloom filter and a flat block index are in memory, so everything up
+// to the block read happens inline; only the read itself is asynchronous.
+// (The leaf page of a B+tree index that is not pinned is read inline too.)
+// The block is searched on the completion thread.
+void SSTable::get_async(const std::string& key, LookupCallback done) const {
+    if (!async_reader || map_base || format_version == kLegacyFormat) {
+        std::string v;
+        LookupResult r;
+        try {
+            r = lookup(key, v);
+        } catch (...) {
+            return done(LookupResult::NotFound, {}, std::current_exception());
+        }
+        return done(r, std::move(v), nullptr);
+    }
+    stats.lookups.add();
+    if (!has_blocks() || data_fd < 0) return done(LookupResult::NotFound, {}, nullptr);
+
+    bool filtered = !filter.empty();
+    if (filtered) {
+        stats.filter_checks.add();
+        if (!filter.may_contain(key)) {
+            stats.filter_negatives.add();
+            return done(LookupResult::NotFound, {}, nullptr);
+        }
+    }
+    IndexCursor blocks(*this, AccessHint::Point);
+    try {
+        blocks.seek(key);
+    } catch (...) {
+        return done(LookupResult::NotFound, {}, std::current_exception());
+    }
+    if (!blocks.valid()) {
+        if (filtered) stats.filter_false_positives.add();
+        return done(LookupResult::NotFound, {}, nullptr);
+    }
+    SSTIndexEntry entry{{}, blocks.entry().offset, blocks.entry().size};
+
+    // Search the block once it is in memory: 'stored' holds its bytes as read
+    // from disk, or is null when buf.pinned already holds it decompressed.
+    auto search = [this, key, filtered, entry, done = std::move(done)](BlockBuffer& buf, const std::string* stored,
+                                                                      bool read_failed) {
+        LookupResult res = LookupResult::NotFound;
+        std::string value;
+        try {
+            if (read_failed) throw std::runtime_error("async sstable read");
+            std::string_view contents = stored ? uncompress_block(entry, *stored, buf, AccessHint::Point)
+                                               : std::string_view(*buf.pinned);
+            BlockReader reader(contents, prefix_keys());
+            reader.seek(key);
+            if (reader.valid() && reader.key() == key) {
+                res = reader.deleted() ? LookupResult::Deleted : LookupResult::Found;
+                if (!reader.deleted()) value.assign(reader.value());
+            }
+        } catch (...) {
+            return done(LookupResult::NotFound, {}, std::current_exception());
+        }
+        if (filtered && res == LookupResult::NotFound)
+            stats.filter_false_positives.add();
+        done(res, std::move(value), nullptr);
+    };
+
+    if (block_cache) {
+        BlockBuffer buf;
+        if ((buf.pinned = block_cache->lookup(block_cache_file_id, entry.offset))) return search(buf, nullptr, false);
+    }
+    uint64_t offset = entry.offset;
+    uint32_t size = entry.size;
+    stats.blocks_read.add();
+    stats.bytes_read.add(size);
+    stats.read_syscalls.add();
+    async_reader->read(async_file, offset, size,
+                       [size, search = std::move(search)](std::string block, int error) {
+        BlockBuffer buf;
+        search(buf, &block, error != 0 || block.size() != size);
+    });
+}
+
+std::vector<LookupResult> SSTable::multi_get(std::span<const std::string> keys,
+                                             std::vector<std::string>& values_out) const {
+    std::vector<std::string_view> views(keys.begin(), keys.end());
+    return multi_get(std::span<const std::string_view>(views), values_out);
+}
+
+// SSTable::multi_get()
+// --------------------------------------------------------------------
+// 1. Drop keys the Bloom filter rules out and sort the rest.
+// 2. Walk the sorted keys and the block index together: each key maps to the
+//    first block whose last key is >= it, with no binary search per key
+//    (except when a key leaves the current leaf page of a B+tree index).
+// 3. Merge the distinct blocks into runs (adjacent or separated by a small
+//    gap), hint every run to the kernel, then read each run once and
+//    binary-search its keys inside the blocks it holds.
+std::vector<LookupResult> SSTable::multi_get(std::span<const std::string_view> keys,
+                                             std::vector<std::string>& values_out) const {
+    std::vector<LookupResult> results(keys.size(), LookupResult::NotFound);
+    values_out.resize(keys.size());
+    if (!has_blocks() || data_fd < 0) return results;
+    if (format_version == kLegacyFormat) {
+        BlockBuffer scratch;
+        for (size_t i = 0; i < keys.size(); ++i) {
+            std::string_view v;
+            results[i] = lookup_impl(keys[i], v, scratch);
+            if (results[i] == LookupResult::Found) values_out[i].assign(v);
+        }
+        return results;
+    }
+    stats.lookups.add(keys.size());
+
+    bool filtered = !filter.empty();
+    std::vector<uint32_t> order;
+    order.reserve(keys.size());
+    for (uint32_t i = 0; i < keys.size(); ++i) {
+        if (filtered) {
+            stats.filter_checks.add();
+            if (!filter.may_contain(keys[i])) {
+                stats.filter_negatives.add();
+                continue;
+            }
+        }
+        order.push_back(i);
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+
+    BlockReader block;
+    auto probe = [&](uint32_t k) {
+        block.seek(keys[k]);
+        if (!block.valid() || block.key() != keys[k]) return;
+        results[k] = block.deleted() ? LookupResult::Deleted : LookupResult::Found;
+        if (!block.deleted()) values_out[k].assign(block.value());
+    };
+
+    // Keys whose block is in the BlockCache are answered right away.
+    // Blocks are told apart by their offset.
+    struct Probe { uint32_t key; uint32_t size; uint64_t block; };
+    std::vector<Probe> probes;
+    probes.reserve(order.size());
+    IndexCursor blocks(*this, AccessHint::Point);
+    BlockBuffer cached;
+    uint64_t cached_block = UINT64_MAX;
+    for (uint32_t k : order) {
+        blocks.advance_to(keys[k]);
+        if (!blocks.valid()) break;   // this and every later key sort after the table
+        const SSTIndexEntry& e = blocks.entry();
+        if (block_cache && cached_block != e.offset) {
+            cached.pinned = block_cache->lookup(block_cache_file_id, e.offset);
+            if (cached.pinned) block.reset(*cached.pinned, prefix_keys());
+            cached_block = e.offset;
+        }
+        if (cached.pinned) probe(k);
+        else probes.push_back({k, e.size, e.offset});
+    }
+
+    struct Run { uint64_t offset, size; size_t first, end; };   // probes [first, end)
+    std::vector<Run> runs;
+    for (size_t p = 0; p < probes.size(); ++p) {
+        uint64_t offset = probes[p].block, size = probes[p].size;
+        if (!runs.empty()) {
+            Run& r = runs.back();
+            uint64_t r_end = r.offset + r.size;
+            if (offset == probes[p - 1].block ||
+                (offset >= r_end && offset - r_end <= kMultiGetMaxGap && offset + size - r.offset <= kMultiGetMaxRead)) {
+                r.size = std::max(r_end, offset + size) - r.offset;
+                r.end = p + 1;
+                continue;
+            }
+        }
+        runs.push_back({offset, size, p, p + 1});
+    }
+
+    if (map_base) {
+        uint64_t page = (uint64_t)::sysconf(_SC_PAGESIZE);
+        for (const Run& r : runs) {
+            uint64_t from = r.offset / page * page;
+            ::madvise(const_cast<char*>(map_base + from), r.offset + r.size - from, MADV_WILLNEED);
+        }
+    } else if (!buffer_pool && runs.size() > 1) {
+        for (const Run& r : runs) ::posix_fadvise(data_fd, (off_t)r.offset, (off_t)r.size, POSIX_FADV_WILLNEED);
+    }
+
+    BlockBuffer buf;
+    for (const Run& r : runs) {
+        std::string_view data = read_range(r.offset, r.size, buf.bytes, AccessHint::Point);
+        for (size_t p = r.first; p < r.end; ++p) {
+            if (p == r.first || probes[p].block != probes[p - 1].block) {
+                SSTIndexEntry e{{}, probes[p].block, probes[p].size};
+                stats.blocks_read.add();
+                block.reset(uncompress_block(e, data.substr(e.offset - r.offset, e.size), buf, AccessHint::Point),
+                            prefix_keys());
+            }
+            probe(probes[p].key);
+        }
+    }
+
+    if (filtered)
+        for (uint32_t k : order)
+            if (results[k] == LookupResult::NotFound) stats.filter_false_positives.add();
+    return results;
+}
+
+// SSTable::scan()
+// --------------------------------------------------------------------
+// Range scan from 'start' to 'end' (inclusive).
+// Iterates through index and invokes user-supplied callback 'visit'.
+// Tombstones are skipped.
+void SSTable::scan(const std::string& start, const std::string& end,
+                   const std::function<void(const std::string&, const std::string&)>& visit) const {
+    scan_records(start, end, [&](const std::string& k, const std::string* v) {
+        if (v) visit(k, *v);
+    });
+}
+
+// SSTable::scan_records()
+// --------------------------------------------------------------------
+// Range scan that also reports tombstones (value == nullptr).
+void SSTable::scan_records(const std::string& start, const std::string& end,
+                           const std::function<void(const std::string&, const std::string*)>& visit) const {
+    std::string k, v;
+    scan_impl(start, end, [&](std::string_view key, const std::string_view* value) {
+        k.assign(key);
+        if (value) v.assign(*value);
+        visit(k, value ? &v : nullptr);
+    });
+}
+
+// SSTable::scan_view()
+// --------------------------------------------------------------------
+// Zero-copy range scan: records are handed out as views into the mapping
+// (or into the current block buffer in pread mode). Tombstones are skipped.
+void SSTable::scan_view(std::string_view start, std::string_view end,
+                        const std::function<void(std::string_view, std::string_view)>& visit) const {
+    scan_impl(start, end, [&](std::string_view key, const std::string_view* value) {
+        if (value) visit(key, *value);
+    });
+}
+
+// Shared scan loop. Block format: one whole block per read, with the
+// scanned byte range advised MADV_SEQUENTIAL in mmap mode and pages fetched
+// with AccessHint::Scan from the buffer pool.
+void SSTable::scan_impl(std::string_view start, std::string_view end,
+                        const std::function<void(std::string_view, const std::string_view*)>& visit) const {
+    if (!has_blocks() || data_fd < 0) return;
+    if (format_version == kLegacyFormat) return scan_legacy(start, end, visit);
+
+    IndexCursor blocks(*this, AccessHint::Scan);
+    blocks.seek(start);
+    if (!blocks.valid()) return;
+
+    // Read ahead over [first block, block holding 'end'], then go back to random access
+    struct SeqAdvice {
+        const char* p = nullptr;
+        size_t n = 0;
+        ~SeqAdvice() { if (p) ::madvise(const_cast<char*>(p), n, MADV_RANDOM); }
+    } advice;
+    if (map_base) {
+        const SSTIndexEntry& first = blocks.entry();
+        IndexCursor last(*this, AccessHint::Scan);
+        last.seek(end);
+        uint64_t to = last.valid() ? last.entry().offset + last.entry().size : data_end;
+        to = std::max(to, first.offset + first.size);
+        uint64_t page = (uint64_t)::sysconf(_SC_PAGESIZE);
+        uint64_t from = first.offset / page * page;
+        advice.p = map_base + from;
+        advice.n = to - from;
+        ::madvise(const_cast<char*>(advice.p), advice.n, MADV_SEQUENTIAL);
+        ::madvise(const_cast<char*>(advice.p), advice.n, MADV_WILLNEED);
+    }
+
+    BlockBuffer scratch;
+    BlockReader block;
+    bool first = true;
+    for (; blocks.valid(); blocks.next()) {
+        block.reset(block_data(blocks.entry(), scratch, AccessHint::Scan), prefix_keys());
+        if (first) block.seek(start);
+        for (; block.valid(); block.next()) {
+            if (block.key() > end) return;
+            std::string_view v = block.value();
+            visit(block.key(), block.deleted() ? nullptr : &v);
+        }
+        first = false;
+    }
+}
+
+// v1: walk the per-key index, reading each record separately.
+void SSTable::scan_legacy(std::string_view start, std::string_view end,
+                          const std::function<void(std::string_view, const std::string_view*)>& visit) const {
+    auto it = index.begin() + (ptrdiff_t)find_index(start);
+
+    std::string scratch;
+    for (; it != index.end(); ++it) {
+        if (it->key > end) break;
+        std::string_view k, v;
+        bool deleted = false;
+        if (!legacy_record(it->offset, scratch, k, v, deleted, AccessHint::Scan)) break;
+        if (k < start) continue;
+        if (k > end) break;
+        visit(k, deleted ? nullptr : &v);
+    }
+}
+
+// SSTable::Cursor
+// --------------------------------------------------------------------
+SSTable::Cursor::Cursor(const SSTable& t) : table(&t), blocks(t, AccessHint::Scan) {
+    if (t.format_version != kLegacyFormat && t.data_fd >= 0) blocks.seek_to_first();
+    next();
+}
+
+void SSTable::Cursor::next() {
+    if (table->format_version == kLegacyFormat) {
+        is_valid = index_pos < table->index.size() &&
+                   table->legacy_record(table->index[index_pos].offset, scratch.bytes, cur_key, cur_value,
+                                        cur_deleted, AccessHint::Scan);
+        ++index_pos;
+        return;
+    }
+
+    if (is_valid) block.next();
+    while (!block.valid()) {
+        if (!blocks.valid() || table->data_fd < 0) { is_valid = false; return; }
+        block.reset(table->block_data(blocks.entry(), scratch, AccessHint::Scan), table->prefix_keys());
+        blocks.next();
+    }
+    cur_key = block.key();
+    cur_value = block.value();
+    cur_deleted = block.deleted();
+    is_valid = true;
+}
+
+// SSTable::Iterator
+// --------------------------------------------------------------------
+SSTable::Iterator::Iterator(const SSTable& t, size_t readahead_bytes)
+    : table(&t)
+    , readahead(std::max<size_t>(readahead_bytes, 1))
+    , window(readahead)
+    , blocks(t, AccessHint::Scan) {}
+
+void SSTable::Iterator::seek_to_first() {
+    if (table->format_version == kLegacyFormat) {
+        index_pos = 0;
+        return load_legacy();
+    }
+    if (table->data_fd < 0) { is_valid = false; return; }
+    window = readahead;
+    blocks.seek_to_first();
+    if (!blocks.valid()) { is_valid = false; return; }
+    load_block();
+    settle();
+}
+
+void SSTable::Iterator::seek(std::string_view target) {
+    if (table->format_version == kLegacyFormat) {
+        index_pos = table->find_index(target);
+        return load_legacy();
+    }
+    if (table->data_fd < 0) { is_valid = false; return; }
+    window = 0;
+    blocks.seek(target);
+    if (!blocks.valid()) { is_valid = false; return; }
+    load_block();
+    block.seek(target);
+    settle();
+}
+
+void SSTable::Iterator::next() {
+    if (table->format_version == kLegacyFormat) {
+        ++index_pos;
+        return load_legacy();
+    }
+    block.next();
+    settle();
+}
+
+void SSTable::Iterator::settle() {
+    while (!block.valid()) {
+        blocks.next();
+        if (!blocks.valid()) { is_valid = false; return; }
+        load_block();
+    }
+    cur_key = block.key();
+    cur_value = block.value();
+    cur_deleted = block.deleted();
+    is_valid = true;
+}
+
+void SSTable::Iterator::load_legacy() {
+    is_valid = index_pos < table->index.size() && table->data_fd >= 0 &&
+               table->legacy_record(table->index[index_pos].offset, scratch.bytes, cur_key, cur_value,
+                                    cur_deleted, AccessHint::Scan);
+}
+
+void SSTable::Iterator::load_block() {
+    const SSTIndexEntry& e = blocks.entry();
+    // a read right after seek() covers the one block and prefetches nothing;
+    // each read after it covers twice as much as the last
+    auto grow_window = [&](size_t covered) {
+        bool sequential = window > 0;
+        window = std::min(readahead, std::max(2 * window, 2 * covered));
+        return sequential;
+    };
+    if (table->map_base) {
+        if (e.offset + e.size > advised_to) {
+            uint64_t page = (uint64_t)::sysconf(_SC_PAGESIZE);
+            uint64_t from = e.offset / page * page;
+            advised_to = std::min<uint64_t>(std::max<uint64_t>(e.offset + e.size, from + window), table->map_size);
+            if (grow_window(advised_to - from))
+                ::madvise(const_cast<char*>(table->map_base + from), advised_to - from, MADV_WILLNEED);
+        }
+    } else if (!table->buffer_pool) {
+        if (e.offset < chunk_offset || e.offset + e.size > chunk_offset + chunk.size()) {
+            // one pread for this block and the blocks after it, 'window' bytes
+            // in all (data blocks are contiguous, up to data_end)
+            uint64_t to = std::min(table->data_end, std::max<uint64_t>(e.offset + e.size, e.offset + window));
+            if (to < e.offset + e.size) throw std::runtime_error("corrupt sstable index");
+            chunk.resize(to - e.offset);
+            table->stats.bytes_read.add(chunk.size());
+            table->stats.read_syscalls.add();
+            if (::pread(table->data_fd, chunk.data(), chunk.size(), (off_t)e.offset) != (ssize_t)chunk.size())
+                throw std::runtime_error("pread sstable");
+            chunk_offset = e.offset;
+            if (grow_window(chunk.size()) && to < table->data_end)
+                ::posix_fadvise(table->data_fd, (off_t)to, (off_t)window, POSIX_FADV_WILLNEED);
+        }
+        std::string_view stored = std::string_view(chunk).substr(e.offset - chunk_offset, e.size);
+        table->stats.blocks_read.add();
+        block.reset(table->uncompress_block(e, stored, scratch, AccessHint::Scan), table->prefix_keys());
+        return;
+    }
+    block.reset(table->block_data(e, scratch, AccessHint::Scan), table->prefix_keys());
+}
+
+std::string SSTable::first_key() const {
+    Cursor c(*this);
+    return c.valid() ? std::string(c.key()) : std::string();
+}
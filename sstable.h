@@ -1,73 +1,449 @@
-#pragma once
-#include <string>
-#include <vector>
-#include <cstdint>
-#include <functional>
-
-// Represents one entry in the SSTable index file.
-// Each entry maps a key to its byte offset in the data file.
-struct SSTIndexEntry {
-    std::string key;   // Key string
-    uint64_t offset;   // Offset in data file where this key-value pair starts
-};
-
-// SSTable: Sorted String Table
-// ----------------------------------------
-// This class represents an immutable, sorted key-value store file.
-// It usually comes from flushing a MemTable (in-memory structure) to disk.
-// The SSTable consists of two parts:
-//  - Data file: stores serialized key-value pairs
-//  - Index file: stores key -> offset mappings for quick lookup
-class SSTable {
-public:
-    std::string data_path;     // Path to data file (e.g., "sst_001.data")
-    std::string index_path;    // Path to index file (e.g., "sst_001.index")
-    std::vector<SSTIndexEntry> index;  // In-memory index (loaded from index file)
-    int data_fd{-1};           // File descriptor for data file
-
-    SSTable() = default;
-
-    // Constructor: given the base name (without extension), initialize paths.
-    // Example: base_no_ext = "sst_001" -> data_path = "sst_001.data"
-    explicit SSTable(std::string base_no_ext);
-
-    // Static builder function:
-    // Given sorted key-value pairs, create both data and index files on disk.
-    // Returns an SSTable object representing the files created.
-    static SSTable build(const std::string& base_no_ext,
-                         const std::vector<std::pair<std::string, std::string>>& sorted_kv);
-
-    // Open the data file for reading
-    void open();
-
-    // Close the data file if open
-    void close();
-
-    // Get the value associated with a key.
-    // Returns true if found, false if not.
-    bool get(const std::string& key, std::string& value_out) const;
-
-    // Perform a range scan between 'start' and 'end'.
-    // For each key-value pair, call the 'visit' function.
-    void scan(const std::string& start, const std::string& end,
-              const std::function<void(const std::string&, const std::string&)>& visit) const;
-
-private:
-    // Helper functions for low-level binary I/O:
-
-    // Write a 32-bit unsigned integer to file at current position
-    static void write_u32(int fd, uint32_t v);
-
-    // Write a 64-bit unsigned integer to file at current position
-    static void write_u64(int fd, uint64_t v);
-
-    // Read a 32-bit unsigned integer from a specific file offset
-    static uint32_t read_u32_at(int fd, uint64_t off);
-
-    // Read a 64-bit unsigned integer from a specific file offset
-    static uint64_t read_u64_at(int fd, uint64_t off);
-
-    // Read one complete key-value record at a given offset in the data file
-    // Returns false if read fails
-    static bool read_record_at(int fd, uint64_t off, std::string& k, std::string& v);
-};
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <atomic>
+#include <memory>
+#include <exception>
+#include <span>
+#include <unordered_map>
+#include "record.h"
+#include "bloom_filter.h"
+#include "buffer_pool.h"
+#include "iterator.h"
+#include "async_io.h"
+#include "block_cache.h"
+#include "compression.h"
+#include "sstable_format.h"
+#include "metrics.h"
+#include "prefix_index.h"
+
+// Represents one entry in the in-memory SSTable index.
+//  - Legacy format (v1): one entry per key, mapping the key to its record offset.
+//  - Block formats (v2, v3): one entry per data block; 'key' is the last key stored
+//    in the block and 'size' is the block length in bytes.
+struct SSTIndexEntry {
+    std::string key;   // Key string
+    uint64_t offset;   // Offset in data file where this key-value pair (or block) starts
+    uint32_t size{0};  // Block length (v2/v3 only; 0 for legacy per-record entries)
+};
+
+// How an opened SSTable reads its data file.
+enum class SSTableReadMode {
+    Pread,   // one pread per block into a private buffer, or through a BufferPool if one is given
+    Mmap,    // map the whole file and decode blocks in place: no syscalls or copies on reads
+};
+
+// When SSTableWriter forces written data to stable storage.
+enum class SSTableSyncPolicy {
+    None,       // leave write-back to the kernel
+    OnFinish,   // one fdatasync before finish() returns (needed before the WAL can be truncated)
+    Periodic,   // additionally fdatasync every sync_interval_bytes to smooth out write-back bursts
+};
+
+// Per-table knobs used when writing an SSTable.
+struct SSTableOptions {
+    uint32_t block_size = 4096;     // target size of a data block before it is cut
+    int block_restart_interval = 16;   // keys between whole (restart) keys in a block; 0 writes format v2
+    int bloom_bits_per_key = 10;    // Bloom filter size; 0 writes no filter (~1% false positives at 10)
+    SSTableReadMode read_mode = SSTableReadMode::Pread;   // how build()/finish() open the table they return
+    std::shared_ptr<BufferPool> buffer_pool;              // shared page cache for Pread-mode reads (optional)
+    std::shared_ptr<AsyncReader> async_reader;            // get_async() I/O engine for Pread-mode tables (optional)
+    CompressionType compression = CompressionType::None;  // codec of the data blocks (format v3 only)
+    std::shared_ptr<BlockCache> block_cache;              // decompressed blocks of compressed tables (optional)
+    bool prefix_index = true;       // search the in-memory index through a PrefixIndex rather than std::lower_bound
+    // > 0: write the block index as an on-disk B+tree of pages of about this
+    // size, which open() does not load (format v3 only); 0: one index block.
+    uint32_t index_page_size = 0;
+    // Values are a ValueKind byte followed by the value or a ValuePointer into
+    // a value log (value_log.h); recorded in the footer. Set by KVDatabase.
+    bool separated_values = false;
+
+    size_t write_buffer_size = 1 << 20;   // writer output buffer; one write() per filled buffer
+    bool direct_io = false;               // O_DIRECT writes (falls back to buffered if unsupported)
+    SSTableSyncPolicy sync_policy = SSTableSyncPolicy::OnFinish;
+    uint64_t sync_interval_bytes = 64ull << 20;   // SSTableSyncPolicy::Periodic only
+};
+
+// Read-path counters of one SSTable. Updated from const lookups on many
+// threads, hence sharded counters (metrics.h); copying takes a snapshot so
+// SSTable stays copyable.
+struct SSTableStats {
+    ShardedCounter lookups;                  // point lookups (get/lookup/get_async/multi_get keys)
+    ShardedCounter filter_checks;            // lookups that consulted the Bloom filter
+    ShardedCounter filter_negatives;         // ... where it ruled the key out (no I/O)
+    ShardedCounter filter_false_positives;   // ... where it said "maybe" but the key was absent
+    ShardedCounter blocks_read;              // data blocks (or legacy records) fetched for lookups and scans
+    ShardedCounter bytes_read;               // data file bytes those fetches asked for, in any read mode
+    ShardedCounter read_syscalls;            // preads and async reads issued by the table itself
+                                             // (buffer pool misses are counted by the pool)
+
+    // Fraction of absent-key lookups the filter failed to reject.
+    [[nodiscard]] double false_positive_rate() const {
+        uint64_t fp = filter_false_positives.load(), tn = filter_negatives.load();
+        return fp + tn == 0 ? 0.0 : (double)fp / (double)(fp + tn);
+    }
+};
+
+// SSTable: Sorted String Table
+// ----------------------------------------
+// This class represents an immutable, sorted key-value store file.
+// It usually comes from flushing a MemTable (in-memory structure) to disk.
+//
+// Two on-disk formats are readable, told apart by the footer:
+//
+//  v1 (legacy, no footer) - written by earlier versions:
+//   - Data file (.sst): [key_len][val_len][key_bytes][val_bytes] records
+//   - Index file (.idx): [n] then n x [key_len][key_bytes][offset]
+//
+//  v2 (block format, single .sst file):
+//   [data block 0][data block 1]...[filter block][index block][footer]
+//   - data block: records in the v1 record layout packed up to ~block_size
+//     bytes, followed by a trailer of per-record u32 offsets and a u32 count
+//     so a key can be binary-searched inside the block
+//   - filter block: Bloom filter over every key (see bloom_filter.h), optional
+//   - index block: [n] then n x [key_len][last_key][block_offset u64][block_size u32]
+//   - footer: [fields...][fields_size u32][format_version u32][magic u64]
+//     'fields' is a list of u64 values (index_offset, index_size, num_entries,
+//     block_size, filter_offset, filter_size); newer writers may append fields,
+//     older readers ignore them and missing trailing fields read as 0.
+//
+//  v3 (prefix-compressed blocks) - what build() writes by default:
+//   same file layout as v2, but data blocks store each key as the length it
+//   shares with the previous key plus the remaining suffix, with varint
+//   lengths and a whole key at every block_restart_interval-th record (see
+//   sst_format::BlockBuilder). The index block is a block of the same kind
+//   mapping each block's last key to [block_offset varint][block_size varint].
+//   With compression (footer field 'compression', see CompressionType) each
+//   data block is compressed on its own and tagged raw or compressed (see
+//   sst_format::BlockTag); the filter and index blocks stay uncompressed.
+//   With SSTableOptions::index_page_size the index is instead a static
+//   B+tree built bottom-up: leaf pages are index blocks of about that size
+//   covering consecutive data blocks, and every page of a level above maps
+//   the last key of each page below to its [offset varint][size varint].
+//   Each level is written after the one below it, so the root comes last;
+//   footer field 'index_levels' counts the levels (absent or 1: flat index),
+//   and index_offset/index_size point at the root. Footer field
+//   'separated_values' marks a table whose values are encoded for key-value
+//   separation (see value_log.h); the table itself stores them as opaque bytes.
+//
+// A flat index is loaded at open (one entry per block) and searched through
+// a PrefixIndex (8-byte key prefixes in cache-line B+tree nodes) unless
+// SSTableOptions::prefix_index is off. A B+tree index is not: open() pins
+// the root and the upper internal levels that fit in kMaxPinnedIndexBytes,
+// and a lookup reads one page per remaining level, so opening costs the same
+// for any number of keys. The Bloom filter is always kept in memory.
+// A lookup for an absent key is usually answered by the filter alone; any
+// other point lookup costs a single block read. Compressed blocks are
+// decompressed after the read and, given a BlockCache, kept decompressed so
+// a hit skips both the read and the decompression.
+class SSTable {
+public:
+    static constexpr uint32_t kLegacyFormat = 1;
+    static constexpr uint32_t kBlockFormat = 2;
+    static constexpr uint32_t kPrefixFormat = 3;
+
+    // Upper B+tree index levels pinned by open(), below the root.
+    static constexpr size_t kMaxPinnedIndexBytes = 64 * 1024;
+
+    std::string data_path;     // Path to data file (e.g., "sst_001.sst")
+    std::string index_path;    // Path to legacy index file (e.g., "sst_001.idx"), v1 only
+    std::vector<SSTIndexEntry> index;  // In-memory index (per key for v1, per block for v2)
+    PrefixIndex index_search;          // Cache-friendly search structure over index keys (see prefix_index.h)
+    bool use_prefix_index{true};       // Build index_search in open(); set before opening
+    uint32_t index_levels{1};          // B+tree index height (leaves included); 1 = flat, loaded into 'index'
+    uint64_t data_end{0};              // End of the data blocks (v2/v3)
+    int data_fd{-1};           // File descriptor for data file
+    uint32_t format_version{0};        // kLegacyFormat, kBlockFormat or kPrefixFormat once opened
+    uint64_t num_entries{0};           // Number of records (tombstones included)
+    BloomFilter filter;                // Empty (never filters) for legacy tables or bloom_bits_per_key == 0
+    SSTableReadMode read_mode{SSTableReadMode::Pread};
+    const char* map_base{nullptr};     // Whole data file, mmap mode only
+    size_t map_size{0};
+    std::shared_ptr<BufferPool> buffer_pool;   // Page cache the reads go through (Pread mode), may be null
+    uint64_t cache_file_id{0};                 // This file's id inside buffer_pool
+    std::shared_ptr<AsyncReader> async_reader; // Engine behind get_async() (Pread mode), may be null
+    int async_file{-1};                        // This file's handle inside async_reader
+    CompressionType compression{CompressionType::None};   // Codec of the data blocks
+    bool separated_values{false};              // Values are tagged inline values or value log pointers
+    std::shared_ptr<BlockCache> block_cache;   // Decompressed blocks (compressed tables only), may be null
+    uint64_t block_cache_file_id{0};           // This file's id inside block_cache
+    mutable SSTableStats stats;
+
+    SSTable() = default;
+
+    // Constructor: given the base name (without extension), initialize paths.
+    // Example: base_no_ext = "sst_001" -> data_path = "sst_001.sst"
+    explicit SSTable(std::string base_no_ext);
+
+    // Static builder function:
+    // Given sorted key-value pairs, create a block-format table on disk.
+    // Returns an SSTable object representing the file created.
+    // To write without holding every record in memory, use SSTableWriter.
+    static SSTable build(const std::string& base_no_ext,
+                         const std::vector<std::pair<std::string, std::string>>& sorted_kv,
+                         const SSTableOptions& options = {});
+
+    // Same as above, but records may be tombstones (std::nullopt value).
+    // Used when flushing a memtable that contains deletions.
+    static SSTable build(const std::string& base_no_ext,
+                         const std::vector<KVRecord>& sorted_records,
+                         const SSTableOptions& options = {});
+
+    // Open the data file for reading and load the index (format detected from the footer).
+    // In mmap mode the whole file is mapped with MADV_RANDOM. In pread mode, block
+    // reads go through 'pool' when one is given, and get_async() reads go
+    // through 'async' (the file is registered with it). Decompressed blocks of
+    // a compressed table are cached in 'blocks' (any read mode).
+    void open(SSTableReadMode mode = SSTableReadMode::Pread, std::shared_ptr<BufferPool> pool = nullptr,
+              std::shared_ptr<AsyncReader> async = nullptr, std::shared_ptr<BlockCache> blocks = nullptr);
+
+    // Close the data file (and unmap it) if open
+    void close();
+
+    // Get the value associated with a key.
+    // Returns true if found, false if not.
+    bool get(const std::string& key, std::string& value_out) const;
+
+    // Zero-copy get: 'value_out' points into the mapped file and stays valid
+    // until close(). Requires SSTableReadMode::Mmap and an uncompressed table
+    // (throws std::logic_error otherwise).
+    bool get(std::string_view key, std::string_view& value_out) const;
+
+    // Like get(), but distinguishes "key deleted here" from "key not in this table".
+    // Consults the Bloom filter first; a negative answer skips the index and all I/O.
+    LookupResult lookup(const std::string& key, std::string& value_out) const;
+    LookupResult lookup(std::string_view key, std::string_view& value_out) const;   // zero-copy, mmap mode
+
+    // Asynchronous lookup: the block read is queued on the table's AsyncReader
+    // (bypassing the buffer pool) and 'done' runs on the reader's completion
+    // thread with the result, the value when Found, and the exception of a
+    // failed read or a corrupt block. Without an AsyncReader, in mmap mode and
+    // for legacy tables the lookup runs synchronously and 'done' is called
+    // before get_async() returns. The table must stay open until every
+    // callback has run.
+    using LookupCallback = std::function<void(LookupResult result, std::string value, std::exception_ptr error)>;
+    void get_async(const std::string& key, LookupCallback done) const;
+
+    // Batched lookup: results[i] (and values_out[i] when Found) answer keys[i].
+    // The batch is sorted and matched against the block index in one merged
+    // pass; the blocks it needs are coalesced into runs of at most
+    // kMultiGetMaxRead bytes (bridging gaps up to kMultiGetMaxGap), all runs
+    // are announced to the kernel up front (posix_fadvise / madvise WILLNEED)
+    // and then read with one read_range() each. Legacy tables fall back to lookup().
+    static constexpr uint64_t kMultiGetMaxRead = 1 << 20;
+    static constexpr uint64_t kMultiGetMaxGap = 16 * 1024;
+    std::vector<LookupResult> multi_get(std::span<const std::string> keys, std::vector<std::string>& values_out) const;
+    std::vector<LookupResult> multi_get(std::span<const std::string_view> keys, std::vector<std::string>& values_out) const;
+
+    // Perform a range scan between 'start' and 'end'.
+    // For each key-value pair, call the 'visit' function.
+    void scan(const std::string& start, const std::string& end,
+              const std::function<void(const std::string&, const std::string&)>& visit) const;
+
+    // Range scan that also reports tombstones: 'value' is nullptr for a deleted key.
+    void scan_records(const std::string& start, const std::string& end,
+                      const std::function<void(const std::string&, const std::string*)>& visit) const;
+
+    // Zero-copy range scan: key and value are views valid only during the callback.
+    // Works in both read modes; in mmap mode the scanned range is advised MADV_SEQUENTIAL.
+    void scan_view(std::string_view start, std::string_view end,
+                   const std::function<void(std::string_view, std::string_view)>& visit) const;
+
+    // Bytes of the block a reader is on: read into 'bytes', or a decompressed
+    // block shared with the BlockCache.
+    struct BlockBuffer {
+        std::string bytes;
+        BlockCache::Block pinned;
+    };
+
+    // IndexCursor: walk over the block index in key order, one entry (last
+    // key, offset and size of a data block) at a time. A flat index is walked
+    // in memory. A B+tree index keeps one page per level: pinned pages are
+    // used in place, the others are read (with 'hint') when the walk enters them.
+    class IndexCursor {
+    public:
+        IndexCursor(const SSTable& table, AccessHint hint);
+
+        void seek_to_first();
+        void seek(std::string_view key);         // first entry whose key is >= 'key'
+        // Like seek() for keys that ascend between calls: steps forward
+        // through the current leaf page before searching from the root.
+        void advance_to(std::string_view key);
+        void next();
+
+        [[nodiscard]] bool valid() const { return is_valid; }
+        [[nodiscard]] const SSTIndexEntry& entry() const { return levels.empty() ? table->index[pos] : cur; }
+
+    private:
+        struct Level {
+            BlockBuffer page;                  // page bytes when not pinned
+            std::string_view data;             // the page (pinned, or in 'page')
+            uint64_t offset{UINT64_MAX};       // file offset of 'data'
+            sst_format::BlockReader reader;
+        };
+        const SSTable* table;
+        AccessHint hint;
+        size_t pos{0};                 // flat index: current entry
+        std::vector<Level> levels;     // B+tree: root first, leaf last (empty for a flat index)
+        SSTIndexEntry cur;             // B+tree: decoded leaf entry
+        bool is_valid{false};
+
+        void load(size_t level, uint64_t offset, uint32_t size);
+        // From the entry levels[level] is on, descend to the leaf: first
+        // entries of each page, or (given 'key') the first entry >= key.
+        void descend(size_t level, const std::string_view* key);
+    };
+
+    // Cursor: forward walk over every record of the table, tombstones included,
+    // with one block resident at a time (read with AccessHint::Scan). key() and
+    // value() stay valid until the next call to next(). Used by compaction.
+    class Cursor {
+    public:
+        explicit Cursor(const SSTable& table);
+
+        [[nodiscard]] bool valid() const { return is_valid; }
+        void next();
+
+        [[nodiscard]] std::string_view key() const { return cur_key; }
+        [[nodiscard]] std::string_view value() const { return cur_value; }
+        [[nodiscard]] bool deleted() const { return cur_deleted; }
+
+    private:
+        const SSTable* table;
+        size_t index_pos{0};        // v1: next record to load
+        IndexCursor blocks;         // v2/v3: next block to load
+        BlockBuffer scratch;
+        sst_format::BlockReader block;   // current block (v2/v3 only)
+        std::string_view cur_key, cur_value;
+        bool cur_deleted{false};
+        bool is_valid{false};
+    };
+
+    // Iterator: seekable walk over the table, tombstones included. In pread
+    // mode without a buffer pool, runs of consecutive blocks are fetched with
+    // one pread, and posix_fadvise(WILLNEED) starts the kernel reading the
+    // following run while this one is consumed. seek_to_first() reads runs of
+    // 'readahead_bytes' from the start (full scans, compaction); seek() reads
+    // just the block it lands on, and the run doubles with every further read
+    // next() needs, up to 'readahead_bytes', so short range reads stay cheap.
+    // In mmap mode the same windows are prefetched with madvise(WILLNEED);
+    // with a buffer pool, pages come from the pool (AccessHint::Scan).
+    // Legacy (v1) tables are read one record at a time.
+    class Iterator : public ::Iterator {
+    public:
+        static constexpr size_t kDefaultReadahead = 256 * 1024;
+
+        explicit Iterator(const SSTable& table, size_t readahead_bytes = kDefaultReadahead);
+
+        void seek_to_first() override;
+        void seek(std::string_view target) override;
+        void next() override;
+
+        [[nodiscard]] bool valid() const override { return is_valid; }
+        [[nodiscard]] std::string_view key() const override { return cur_key; }
+        [[nodiscard]] std::string_view value() const override { return cur_value; }
+        [[nodiscard]] bool deleted() const override { return cur_deleted; }
+
+    private:
+        const SSTable* table;
+        size_t readahead;
+        size_t window;                // bytes the next read-ahead covers: 0 after seek(), doubling up to readahead
+        size_t index_pos{0};          // v1: current record
+        IndexCursor blocks;           // v2/v3: current block
+        std::string chunk;            // read-ahead run of blocks (pread mode)
+        uint64_t chunk_offset{0};     // file offset of chunk[0]
+        uint64_t advised_to{0};       // mmap mode: end of the last madvise(WILLNEED) window
+        BlockBuffer scratch;          // single reads: buffer pool blocks, legacy records, decompressed blocks
+        sst_format::BlockReader block;   // current block (v2/v3 only)
+        std::string_view cur_key, cur_value;
+        bool cur_deleted{false};
+        bool is_valid{false};
+
+        // Make the block 'blocks' is on current (positioned on its first
+        // record), reading ahead as described above.
+        void load_block();
+
+        // Take the record the block reader is on, moving on to later blocks
+        // while past the end of this one.
+        void settle();
+
+        // v1: make the record at index_pos current.
+        void load_legacy();
+    };
+
+    // Smallest key in the table ("" if empty); costs one block read.
+    [[nodiscard]] std::string first_key() const;
+
+    // Largest key in the table ("" if empty); taken from the in-memory index
+    // or the B+tree root.
+    [[nodiscard]] std::string last_key() const { return index.empty() ? tree_last_key : index.back().key; }
+
+private:
+    // Try to read a v2/v3 footer and index block. Returns false if the file has no footer.
+    bool open_block_format();
+
+    // Load the v1 per-key index from the .idx file.
+    void open_legacy_index();
+
+    // Map the data file (mmap read mode).
+    void map_file();
+
+    // Bytes [off, off + len): a view into the mapping, or copied into 'scratch'
+    // from the buffer pool or a single pread.
+    std::string_view read_range(uint64_t off, size_t len, std::string& scratch, AccessHint hint) const;
+
+    // B+tree index: root page and the pinned pages (by offset), largest key.
+    SSTIndexEntry index_root;
+    std::unordered_map<uint64_t, std::string> pinned_index;
+    std::string tree_last_key;
+
+    // Load the root of a B+tree index and pin the upper levels.
+    void open_index_tree(uint64_t root_offset, uint64_t root_size);
+
+    // B+tree index page: pinned, or read through read_range() into 'buf'.
+    std::string_view index_page(uint64_t offset, uint32_t size, BlockBuffer& buf, AccessHint hint) const;
+
+    // The table has data blocks to look in (flat index entries or a B+tree).
+    [[nodiscard]] bool has_blocks() const { return index_levels > 1 || !index.empty(); }
+
+    // Position of the first index entry whose key is >= 'key' (index.size() if none).
+    [[nodiscard]] size_t find_index(std::string_view key) const;
+
+    // Blocks of this table use the prefix-compressed layout (v3).
+    [[nodiscard]] bool prefix_keys() const { return format_version >= kPrefixFormat; }
+
+    // Whole data block described by an index entry, decompressed: a view into
+    // the mapping or into 'buf' (see read_range()), or a block from the
+    // BlockCache, in which case nothing is read.
+    std::string_view block_data(const SSTIndexEntry& block, BlockBuffer& buf, AccessHint hint) const;
+
+    // Block contents from the block's bytes as stored on disk; a compressed
+    // block is decompressed into buf.pinned and, for point reads, added to the BlockCache.
+    std::string_view uncompress_block(const SSTIndexEntry& block, std::string_view stored, BlockBuffer& buf,
+                                      AccessHint hint) const;
+
+    // Legacy record at 'off' as views into the mapping or into 'scratch'.
+    bool legacy_record(uint64_t off, std::string& scratch,
+                       std::string_view& k, std::string_view& v, bool& deleted, AccessHint hint) const;
+
+    // Read-path cores shared by the copying and zero-copy APIs. Returned views
+    // point into the mapping or into 'scratch'.
+    LookupResult lookup_impl(std::string_view key, std::string_view& value_out, BlockBuffer& scratch) const;
+    LookupResult lookup_block(std::string_view key, std::string_view& value_out, BlockBuffer& scratch) const;
+    LookupResult lookup_legacy(std::string_view key, std::string_view& value_out, std::string& scratch) const;
+    void scan_impl(std::string_view start, std::string_view end,
+                   const std::function<void(std::string_view, const std::string_view*)>& visit) const;
+    void scan_legacy(std::string_view start, std::string_view end,
+                     const std::function<void(std::string_view, const std::string_view*)>& visit) const;
+
+    // Helper functions for low-level binary I/O:
+
+    // Read a 32-bit unsigned integer from a specific file offset
+    static uint32_t read_u32_at(int fd, uint64_t off);
+
+    // Read a 64-bit unsigned integer from a specific file offset
+    static uint64_t read_u64_at(int fd, uint64_t off);
+};
@@ -0,0 +1,304 @@
+#pragma once
+// Internal: on-disk encoding pieces shared by the SSTable reader (sstable.cpp)
+// and writer (sstable_writer.cpp). Not part of the public API (sstable.h only
+// needs BlockReader for the members of its cursors).
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include "record.h"
+
+namespace sst_format {
+
+// Footer magic for block-format tables ("KVDBSST2" read as little-endian bytes).
+constexpr uint64_t kFooterMagic = 0x325453534244564Bull;
+// [fields_size u32][format_version u32][magic u64]
+constexpr size_t kFooterTail = sizeof(uint32_t) * 2 + sizeof(uint64_t);
+
+// Footer field slots (each a u64), in on-disk order.
+enum FooterField : size_t {
+    kIndexOffset = 0,
+    kIndexSize,
+    kNumEntries,
+    kBlockSize,
+    kFilterOffset,
+    kFilterSize,
+    kCompression,   // CompressionType of the data blocks (absent = None)
+    kIndexLevels,   // height of a B+tree index (absent or 1 = one flat index block)
+    kSeparatedValues,   // 1: every value starts with a ValueKind byte (see value_log.h)
+    kNumFooterFields,
+};
+
+// Data blocks of a table with compression end with one of these tags: a
+// block that would not shrink by at least 1/kMinCompressionGain is stored raw.
+// An LZ block is [raw_size varint][lz stream][kLZBlock].
+enum BlockTag : uint8_t {
+    kRawBlock = 0,
+    kLZBlock = 1,
+};
+constexpr size_t kMinCompressionGain = 8;
+
+// Helpers: append / decode fixed-width integers in an in-memory buffer.
+inline void put_u32(std::string& buf, uint32_t v) {
+    buf.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+inline void put_u64(std::string& buf, uint64_t v) {
+    buf.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+inline uint32_t get_u32(const char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+inline uint64_t get_u64(const char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Varints: 7 bits per byte, least significant group first, high bit set on
+// every byte but the last.
+inline void put_varint64(std::string& buf, uint64_t v) {
+    while (v >= 0x80) {
+        buf.push_back((char)(v | 0x80));
+        v >>= 7;
+    }
+    buf.push_back((char)v);
+}
+inline void put_varint32(std::string& buf, uint32_t v) {
+    put_varint64(buf, v);
+}
+
+// Decode a varint at 'p' and advance past it; false if it runs past 'end'.
+inline bool get_varint64(const char*& p, const char* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift <= 63 && p < end; shift += 7) {
+        uint64_t byte = (unsigned char)*p++;
+        v |= (byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+inline bool get_varint32(const char*& p, const char* end, uint32_t& v) {
+    uint64_t v64;
+    if (!get_varint64(p, end, v64) || v64 > UINT32_MAX) return false;
+    v = (uint32_t)v64;
+    return true;
+}
+
+// BlockBuilder
+// --------------------------------------------------------------------
+// Accumulates records for one block. Two layouts:
+//
+//  plain (restart_interval == 0, format v2):
+//   [record 0][record 1]...[offset_0 u32]...[offset_{n-1} u32][n u32]
+//   Each record uses the v1 layout [key_len][val_len][key_bytes][val_bytes];
+//   a tombstone has val_len == kTombstoneVlen and no value bytes.
+//
+//  prefix-compressed (restart_interval > 0, format v3):
+//   [record 0][record 1]...[restart_0 u32]...[restart_{r-1} u32][r u32]
+//   Each record is [shared varint][non_shared varint][value_tag varint]
+//   [key suffix][value bytes]: the key is the first 'shared' bytes of the
+//   previous key followed by the suffix, and value_tag is
+//   (value_len << 1) | is_tombstone. Every restart_interval-th record is a
+//   restart point that stores its whole key (shared == 0); the trailer lists
+//   their offsets so a lookup can binary-search the restarts and then scan
+//   at most restart_interval records.
+class BlockBuilder {
+public:
+    explicit BlockBuilder(int restart_interval = 0) : restart_interval(restart_interval) {}
+
+    void add(std::string_view key, const std::string_view* value) {
+        if (restart_interval <= 0) {
+            offsets.push_back((uint32_t)buf.size());
+            put_u32(buf, (uint32_t)key.size());
+            put_u32(buf, value ? (uint32_t)value->size() : kTombstoneVlen);
+            buf.append(key);
+            if (value) buf.append(*value);
+            ++count;
+            return;
+        }
+
+        size_t shared = 0;
+        if (count % (uint32_t)restart_interval == 0) {
+            offsets.push_back((uint32_t)buf.size());
+        } else {
+            size_t limit = std::min(last_key.size(), key.size());
+            while (shared < limit && last_key[shared] == key[shared]) ++shared;
+        }
+        put_varint32(buf, (uint32_t)shared);
+        put_varint32(buf, (uint32_t)(key.size() - shared));
+        put_varint64(buf, value ? (uint64_t)value->size() << 1 : 1);
+        buf.append(key.substr(shared));
+        if (value) buf.append(*value);
+        last_key.assign(key);
+        ++count;
+    }
+
+    [[nodiscard]] bool empty() const { return count == 0; }
+
+    // Size of the records so far (what the block-size cut is based on).
+    [[nodiscard]] size_t records_size() const { return buf.size(); }
+
+    // Append the offset trailer and return the finished block bytes.
+    // The view stays valid until the next add() or reset().
+    std::string_view finish() {
+        for (uint32_t o : offsets) put_u32(buf, o);
+        put_u32(buf, (uint32_t)offsets.size());
+        return buf;
+    }
+
+    void reset() {
+        buf.clear();
+        offsets.clear();
+        last_key.clear();
+        count = 0;
+    }
+
+private:
+    int restart_interval;
+    std::string buf;
+    std::vector<uint32_t> offsets;   // every record (plain) or restart points (prefix)
+    std::string last_key;            // prefix layout only
+    uint32_t count{0};
+};
+
+// BlockReader
+// --------------------------------------------------------------------
+// Cursor over one block written by BlockBuilder, in either layout. A fresh
+// reader sits on the first record. key() and value() stay valid until the
+// cursor moves: values point into the block, keys of prefix-compressed
+// blocks are rebuilt in a buffer of the reader.
+class BlockReader {
+public:
+    BlockReader() = default;
+    BlockReader(std::string_view block, bool prefix_keys) { reset(block, prefix_keys); }
+
+    void reset(std::string_view block, bool prefix_keys) {
+        data = block;
+        prefix = prefix_keys;
+        if (data.size() < sizeof(uint32_t)) throw std::runtime_error("corrupt block");
+        count = get_u32(data.data() + data.size() - sizeof(uint32_t));
+        if ((uint64_t)count * sizeof(uint32_t) + sizeof(uint32_t) > data.size())
+            throw std::runtime_error("corrupt block trailer");
+        records_end = data.size() - sizeof(uint32_t) - (size_t)count * sizeof(uint32_t);
+        seek_to_first();
+    }
+
+    [[nodiscard]] bool valid() const { return is_valid; }
+    [[nodiscard]] std::string_view key() const { return prefix ? std::string_view(key_buf) : cur_key; }
+    [[nodiscard]] std::string_view value() const { return cur_value; }
+    [[nodiscard]] bool deleted() const { return cur_deleted; }
+
+    void seek_to_first() {
+        if (prefix) return restart_at(0);
+        pos = 0;
+        decode_plain();
+    }
+
+    void next() {
+        if (prefix) return decode_prefixed();
+        ++pos;
+        decode_plain();
+    }
+
+    // Move to the first record with key >= 'target' (invalid if none).
+    void seek(std::string_view target) {
+        uint32_t lo = 0, hi = count;
+        if (prefix) {
+            // last restart point whose key is < target; the answer lies after it
+            while (hi - lo > 1) {
+                uint32_t mid = lo + (hi - lo) / 2;
+                if (restart_key(mid) < target) lo = mid;
+                else hi = mid;
+            }
+            restart_at(lo);
+            while (is_valid && key() < target) decode_prefixed();
+            return;
+        }
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            pos = mid;
+            decode_plain();
+            if (cur_key < target) lo = mid + 1;
+            else hi = mid;
+        }
+        pos = lo;
+        decode_plain();
+    }
+
+private:
+    std::string_view data;
+    bool prefix{false};
+    uint32_t count{0};           // records (plain) or restart points (prefix)
+    size_t records_end{0};
+    uint32_t pos{0};             // plain: index of the current record
+    size_t next_off{0};          // prefix: offset of the record after the current one
+    std::string key_buf;         // prefix: current key
+    std::string_view cur_key, cur_value;
+    bool cur_deleted{false};
+    bool is_valid{false};
+
+    [[nodiscard]] uint32_t restart_offset(uint32_t i) const {
+        uint32_t off = get_u32(data.data() + records_end + (size_t)i * sizeof(uint32_t));
+        if (off >= records_end) throw std::runtime_error("corrupt block offset");
+        return off;
+    }
+
+    void decode_plain() {
+        is_valid = pos < count;
+        if (!is_valid) return;
+        uint32_t off = restart_offset(pos);
+        if ((uint64_t)off + sizeof(uint32_t) * 2 > records_end) throw std::runtime_error("corrupt block offset");
+        uint32_t klen = get_u32(data.data() + off);
+        uint32_t vlen = get_u32(data.data() + off + sizeof(uint32_t));
+        cur_deleted = (vlen == kTombstoneVlen);
+        uint64_t vbytes = cur_deleted ? 0 : vlen;
+        uint64_t kpos = off + sizeof(uint32_t) * 2;
+        if (kpos + klen + vbytes > records_end) throw std::runtime_error("corrupt block record");
+        cur_key = data.substr(kpos, klen);
+        cur_value = data.substr(kpos + klen, vbytes);
+    }
+
+    void restart_at(uint32_t i) {
+        key_buf.clear();
+        next_off = count == 0 ? records_end : restart_offset(i);
+        decode_prefixed();
+    }
+
+    // Decode the record at next_off on top of the key in key_buf.
+    void decode_prefixed() {
+        is_valid = next_off < records_end;
+        if (!is_valid) return;
+        const char* p = data.data() + next_off;
+        const char* end = data.data() + records_end;
+        uint32_t shared, non_shared;
+        uint64_t tag;
+        if (!get_varint32(p, end, shared) || !get_varint32(p, end, non_shared) || !get_varint64(p, end, tag) ||
+            shared > key_buf.size() || (uint64_t)(end - p) < non_shared + (tag >> 1))
+            throw std::runtime_error("corrupt block record");
+        key_buf.resize(shared);
+        key_buf.append(p, non_shared);
+        p += non_shared;
+        cur_deleted = tag & 1;
+        cur_value = std::string_view(p, cur_deleted ? 0 : (size_t)(tag >> 1));
+        next_off = (size_t)(p - data.data()) + cur_value.size();
+    }
+
+    // Whole key stored at restart point i (no decoding state involved).
+    [[nodiscard]] std::string_view restart_key(uint32_t i) const {
+        const char* p = data.data() + restart_offset(i);
+        const char* end = data.data() + records_end;
+        uint32_t shared, non_shared;
+        uint64_t tag;
+        if (!get_varint32(p, end, shared) || !get_varint32(p, end, non_shared) || !get_varint64(p, end, tag) ||
+            shared != 0 || (uint64_t)(end - p) < non_shared)
+            throw std::runtime_error("corrupt block restart");
+        return {p, non_shared};
+    }
+};
+
+} // namespace sst_format
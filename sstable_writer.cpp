@@ -0,0 +1,290 @@
+#include "sstable_writer.h"
+#include "compression.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace sst_format;
+
+// O_DIRECT needs buffer address, file offset and length aligned to the
+// logical block size; 4 KiB covers every common device.
+static constexpr size_t kIoAlign = 4096;
+
+static size_t round_up(size_t n, size_t align) {
+    return (n + align - 1) / align * align;
+}
+
+SSTableWriter::SSTableWriter(const std::string& base_no_ext, const SSTableOptions& options_)
+    : base(base_no_ext)
+    , data_path(base_no_ext + ".sst")
+    , options(options_)
+    , block(options_.block_restart_interval)
+    , index_builder(options_.block_restart_interval)
+    , bloom(options_.bloom_bits_per_key) {
+    if (options.compression != CompressionType::None && options.block_restart_interval <= 0)
+        throw std::invalid_argument("block compression needs block_restart_interval > 0 (format v3)");
+    if (options.index_page_size > 0 && options.block_restart_interval <= 0)
+        throw std::invalid_argument("a B+tree index needs block_restart_interval > 0 (format v3)");
+    int flags = O_CREAT | O_TRUNC | O_WRONLY;
+    if (options.direct_io) {
+        fd = ::open(data_path.c_str(), flags | O_DIRECT, 0644);
+        direct = fd >= 0;
+        // Some filesystems (tmpfs, ...) reject O_DIRECT: fall back to buffered writes
+    }
+    if (fd < 0) fd = ::open(data_path.c_str(), flags, 0644);
+    if (fd < 0) throw std::runtime_error("open data for write failed");
+    // A stale v1 index next to a v2 file would never be read, but don't leave it lying around
+    ::unlink((base + ".idx").c_str());
+
+    buf_cap = round_up(std::max(options.write_buffer_size, kIoAlign), kIoAlign);
+    void* p = nullptr;
+    if (::posix_memalign(&p, kIoAlign, buf_cap) != 0) {
+        ::close(fd);
+        throw std::bad_alloc();
+    }
+    buf = static_cast<char*>(p);
+}
+
+SSTableWriter::~SSTableWriter() {
+    if (!finished) abandon();
+    std::free(buf);
+}
+
+void SSTableWriter::abandon() {
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+        ::unlink(data_path.c_str());
+    }
+    finished = true;
+}
+
+void SSTableWriter::add(std::string_view key, std::string_view value) {
+    add_record(key, &value);
+}
+
+void SSTableWriter::add_tombstone(std::string_view key) {
+    add_record(key, nullptr);
+}
+
+void SSTableWriter::add_record(std::string_view key, const std::string_view* value) {
+    if (finished) throw std::logic_error("SSTableWriter used after finish()");
+    if (has_last_key && key <= std::string_view(last_key))
+        throw std::invalid_argument("SSTableWriter keys must be strictly increasing");
+
+    block.add(key, value);
+    last_key.assign(key);
+    has_last_key = true;
+    if (options.bloom_bits_per_key > 0) bloom.add(key);
+    ++entries;
+
+    if (block.records_size() >= options.block_size) finish_block();
+}
+
+// Close the current block, compress it if the table asks for it, stage it
+// and index it by its last key.
+void SSTableWriter::finish_block() {
+    if (block.empty()) return;
+    std::string_view bytes = block.finish();
+    if (options.compression == CompressionType::LZ) {
+        compressed.clear();
+        put_varint64(compressed, bytes.size());
+        lz::compress(bytes, compressed);
+        if (compressed.size() <= bytes.size() - bytes.size() / kMinCompressionGain) {
+            compressed.push_back((char)kLZBlock);
+        } else {
+            compressed.assign(bytes);
+            compressed.push_back((char)kRawBlock);
+        }
+        bytes = compressed;
+    }
+
+    if (options.block_restart_interval > 0) {
+        std::string handle;
+        put_varint64(handle, logical_size);
+        put_varint32(handle, (uint32_t)bytes.size());
+        std::string_view v = handle;
+        index_builder.add(last_key, &v);
+        if (options.index_page_size > 0 && index_builder.records_size() >= options.index_page_size)
+            cut_index_page();
+    } else {
+        put_u32(index_block, (uint32_t)last_key.size());
+        index_block.append(last_key);
+        put_u64(index_block, logical_size);
+        put_u32(index_block, (uint32_t)bytes.size());
+    }
+    ++num_blocks;
+
+    append(bytes);
+    block.reset();
+}
+
+// Close the current leaf page of a B+tree index. Leaves are kept in memory
+// until finish(): the data blocks must stay contiguous.
+void SSTableWriter::cut_index_page() {
+    if (index_builder.empty()) return;
+    std::string_view page = index_builder.finish();
+    leaf_handles.push_back({last_key, index_leaves.size(), (uint32_t)page.size()});
+    index_leaves.append(page);
+    index_builder.reset();
+}
+
+// Leaves first, then each level above them in turn: a page of level l + 1
+// takes entries for consecutive pages of level l until it reaches
+// index_page_size (and holds at least two, so every level is smaller than
+// the one below). The single page of the last level is the root.
+SSTableWriter::PageHandle SSTableWriter::write_index_tree(uint32_t& levels) {
+    cut_index_page();
+    std::vector<PageHandle> level = std::move(leaf_handles);
+    for (PageHandle& h : level) h.offset += logical_size;
+    append(index_leaves);
+    levels = 1;
+
+    BlockBuilder page(options.block_restart_interval);
+    while (level.size() > 1) {
+        std::vector<PageHandle> up;
+        size_t in_page = 0;
+        auto cut = [&](const std::string& key) {
+            std::string_view bytes = page.finish();
+            up.push_back({key, logical_size, (uint32_t)bytes.size()});
+            append(bytes);
+            page.reset();
+            in_page = 0;
+        };
+        for (size_t i = 0; i < level.size(); ++i) {
+            std::string handle;
+            put_varint64(handle, level[i].offset);
+            put_varint32(handle, level[i].size);
+            std::string_view v = handle;
+            page.add(level[i].last_key, &v);
+            if (++in_page >= 2 && page.records_size() >= options.index_page_size) cut(level[i].last_key);
+        }
+        if (!page.empty()) cut(level.back().last_key);
+        level = std::move(up);
+        ++levels;
+    }
+    return level.front();
+}
+
+void SSTableWriter::append(std::string_view bytes) {
+    while (!bytes.empty()) {
+        size_t n = std::min(bytes.size(), buf_cap - buf_len);
+        std::memcpy(buf + buf_len, bytes.data(), n);
+        buf_len += n;
+        logical_size += n;
+        bytes.remove_prefix(n);
+        if (buf_len == buf_cap) flush_buffer(false);
+    }
+}
+
+void SSTableWriter::flush_buffer(bool final) {
+    size_t n = buf_len;
+    if (direct) {
+        if (final) {
+            // zero-pad the tail to a whole block; finish() truncates the padding away
+            n = round_up(buf_len, kIoAlign);
+            std::memset(buf + buf_len, 0, n - buf_len);
+        } else {
+            n = buf_len / kIoAlign * kIoAlign;
+        }
+    }
+
+    size_t done = 0;
+    while (done < n) {
+        ssize_t w = ::write(fd, buf + done, n - done);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("write sstable");
+        }
+        done += (size_t)w;
+        ++writes;
+    }
+    written += std::min(n, buf_len);
+
+    // keep the unaligned remainder (direct I/O only) at the front of the buffer
+    size_t kept = buf_len > n ? buf_len - n : 0;
+    if (kept) std::memmove(buf, buf + n, kept);
+    buf_len = kept;
+
+    if (options.sync_policy == SSTableSyncPolicy::Periodic && options.sync_interval_bytes > 0 &&
+        written - synced_upto >= options.sync_interval_bytes) {
+        if (::fdatasync(fd) != 0) throw std::runtime_error("fdatasync sstable");
+        synced_upto = written;
+    }
+}
+
+// SSTableWriter::finish()
+// --------------------------------------------------------------------
+// Layout after the data blocks: [filter block][index block][footer]
+// (see sstable.h for the footer fields). A B+tree index takes the place of
+// the index block: leaf pages, then each internal level, root last.
+SSTable SSTableWriter::finish() {
+    if (finished) throw std::logic_error("SSTableWriter::finish() called twice");
+    try {
+        finish_block();
+
+        // filter block
+        uint64_t filter_offset = logical_size, filter_size = 0;
+        if (options.bloom_bits_per_key > 0) {
+            std::string filter = bloom.finish();
+            filter_size = filter.size();
+            append(filter);
+        }
+
+        // index block: v3 a prefix-compressed block, v2 [n] then n x [key_len][key][offset][size]
+        uint64_t index_offset = logical_size;
+        uint64_t index_size = 0;
+        uint32_t index_levels = 1;
+        if (!leaf_handles.empty()) {
+            PageHandle root = write_index_tree(index_levels);
+            index_offset = root.offset;
+            index_size = root.size;
+        } else if (options.block_restart_interval > 0) {
+            append(index_builder.finish());
+            index_size = logical_size - index_offset;
+        } else {
+            std::string count;
+            put_u32(count, num_blocks);
+            append(count);
+            append(index_block);
+            index_size = logical_size - index_offset;
+        }
+
+        // footer
+        std::string fields;
+        put_u64(fields, index_offset);
+        put_u64(fields, index_size);
+        put_u64(fields, entries);
+        put_u64(fields, options.block_size);
+        put_u64(fields, filter_offset);
+        put_u64(fields, filter_size);
+        put_u64(fields, (uint64_t)options.compression);
+        put_u64(fields, index_levels);
+        put_u64(fields, options.separated_values ? 1 : 0);
+        std::string footer = fields;
+        put_u32(footer, (uint32_t)fields.size());
+        put_u32(footer, options.block_restart_interval > 0 ? SSTable::kPrefixFormat : SSTable::kBlockFormat);
+        put_u64(footer, kFooterMagic);
+        append(footer);
+
+        flush_buffer(true);
+        if (direct && ::ftruncate(fd, (off_t)logical_size) != 0) throw std::runtime_error("truncate sstable padding");
+        if (options.sync_policy != SSTableSyncPolicy::None && ::fdatasync(fd) != 0)
+            throw std::runtime_error("fdatasync sstable");
+    } catch (...) {
+        abandon();
+        throw;
+    }
+    ::close(fd);
+    fd = -1;
+    finished = true;
+
+    SSTable t(base);
+    t.use_prefix_index = options.prefix_index;
+    t.open(options.read_mode, options.buffer_pool, options.async_reader, options.block_cache);
+    return t;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include <vector>
+#include "sstable.h"
+#include "sstable_format.h"
+#include "bloom_filter.h"
+
+// SSTableWriter: streaming, single-pass SSTable builder
+// ----------------------------------------
+// Records are added one at a time in strictly increasing key order, cut into
+// data blocks and staged in one large, page-aligned output buffer; a write()
+// is only issued when that buffer fills. The Bloom filter and the block index
+// are accumulated on the side and written, with the footer, by finish().
+// Memory use is bounded by the buffer, one block, the index and the filter's
+// key hashes - never by the whole data set.
+//
+// With SSTableOptions::index_page_size the index is cut into leaf pages as
+// blocks are added, and finish() writes them followed by the internal levels
+// of a B+tree over them, built bottom-up one level at a time (see sstable.h).
+//
+// With SSTableOptions::direct_io the file is opened O_DIRECT and only whole
+// aligned chunks are written; the final partial chunk is zero-padded and the
+// file truncated back to its logical size.
+//
+// A writer destroyed without finish() removes its partial file.
+class SSTableWriter {
+public:
+    explicit SSTableWriter(const std::string& base_no_ext, const SSTableOptions& options = {});
+    ~SSTableWriter();
+
+    SSTableWriter(const SSTableWriter&) = delete;
+    SSTableWriter& operator=(const SSTableWriter&) = delete;
+
+    void add(std::string_view key, std::string_view value);
+    void add_tombstone(std::string_view key);
+
+    // Flush everything, write filter/index/footer, sync according to the
+    // policy and return the table opened for reading.
+    SSTable finish();
+
+    // Drop the partial file without finishing it.
+    void abandon();
+
+    [[nodiscard]] uint64_t num_entries() const { return entries; }
+    [[nodiscard]] uint64_t file_size() const { return logical_size; }   // bytes written or buffered so far
+    [[nodiscard]] uint64_t write_calls() const { return writes; }       // write() syscalls issued so far
+    [[nodiscard]] bool using_direct_io() const { return direct; }
+
+private:
+    std::string base;
+    std::string data_path;
+    SSTableOptions options;
+    int fd{-1};
+    bool direct{false};
+    bool finished{false};
+
+    char* buf{nullptr};           // aligned output buffer
+    size_t buf_cap{0};
+    size_t buf_len{0};
+
+    sst_format::BlockBuilder block;
+    std::string last_key;         // last key added (to enforce ordering and index the block)
+    bool has_last_key{false};
+    std::string index_block;      // v2: [key_len][last_key][offset][size] per block
+    sst_format::BlockBuilder index_builder;   // v3: last_key -> [offset varint][size varint]
+    // B+tree index: leaf pages cut from index_builder so far, and the handle
+    // of each (offset relative to the start of index_leaves until finish()).
+    struct PageHandle {
+        std::string last_key;
+        uint64_t offset;
+        uint32_t size;
+    };
+    std::string index_leaves;
+    std::vector<PageHandle> leaf_handles;
+    uint32_t num_blocks{0};
+    std::string compressed;       // staging buffer for a compressed block
+    BloomFilterBuilder bloom;
+
+    uint64_t entries{0};
+    uint64_t logical_size{0};     // file offset of the next byte appended
+    uint64_t written{0};          // bytes handed to write() so far
+    uint64_t synced_upto{0};
+    uint64_t writes{0};
+
+    void add_record(std::string_view key, const std::string_view* value);
+    void finish_block();
+    void cut_index_page();
+
+    // Write the B+tree index over the leaf pages; returns the root handle and sets 'levels'.
+    PageHandle write_index_tree(uint32_t& levels);
+
+    // Stage bytes in the output buffer, writing it out whenever it fills.
+    void append(std::string_view bytes);
+
+    // Write the buffered bytes. Unless 'final', direct I/O keeps the unaligned tail buffered.
+    void flush_buffer(bool final);
+};
@@ -0,0 +1,300 @@
+#include "value_log.h"
+#include "sstable_format.h"
+#include <filesystem>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdio>
+#include <unistd.h>
+#include <fcntl.h>
+
+namespace fs = std::filesystem;
+using namespace sst_format;
+
+// [key_len u32][value_len u32]
+static constexpr size_t kRecordHeader = 2 * sizeof(uint32_t);
+// Appends are written out once this much is buffered
+static constexpr size_t kWriteBufferBytes = 1 << 20;
+
+void encode_inline_value(std::string& out, std::string_view value) {
+    out.clear();
+    out.push_back((char)kInlineValue);
+    out.append(value);
+}
+
+void encode_value_pointer(std::string& out, const ValuePointer& p) {
+    out.clear();
+    out.push_back((char)kValuePointer);
+    put_varint64(out, p.file);
+    put_varint64(out, p.offset);
+    put_varint32(out, p.size);
+}
+
+bool decode_separated_value(std::string_view stored, std::string_view& inline_value, ValuePointer& p) {
+    if (stored.empty()) throw std::runtime_error("corrupt separated value");
+    if ((uint8_t)stored[0] == kInlineValue) {
+        inline_value = stored.substr(1);
+        return false;
+    }
+    const char* q = stored.data() + 1;
+    const char* end = stored.data() + stored.size();
+    if ((uint8_t)stored[0] != kValuePointer || !get_varint64(q, end, p.file) || !get_varint64(q, end, p.offset) ||
+        !get_varint32(q, end, p.size) || q != end)
+        throw std::runtime_error("corrupt separated value");
+    return true;
+}
+
+// Parse "vlog_000042.vlog" -> 42; 0 for anything else.
+static uint64_t parse_vlog_number(const std::string& filename) {
+    const std::string prefix = "vlog_", suffix = ".vlog";
+    if (filename.size() <= prefix.size() + suffix.size()) return 0;
+    if (filename.compare(0, prefix.size(), prefix) != 0) return 0;
+    if (filename.compare(filename.size() - suffix.size(), suffix.size(), suffix) != 0) return 0;
+    std::string digits = filename.substr(prefix.size(), filename.size() - prefix.size() - suffix.size());
+    if (digits.empty() || !std::all_of(digits.begin(), digits.end(), ::isdigit)) return 0;
+    return std::stoull(digits);
+}
+
+ValueLog::File::~File() {
+    if (fd >= 0) ::close(fd);
+}
+
+bool ValueLog::exists(const std::string& dir) {
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(dir, ec))
+        if (entry.is_regular_file() && parse_vlog_number(entry.path().filename().string()) != 0) return true;
+    return false;
+}
+
+ValueLog::ValueLog(std::string dir_, ValueLogOptions options_)
+    : dir(std::move(dir_))
+    , options(options_) {
+    auto files = std::make_shared<FileSet>();
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        if (!entry.is_regular_file()) continue;
+        uint64_t n = parse_vlog_number(entry.path().filename().string());
+        if (n == 0) continue;
+        next_number = std::max(next_number, n + 1);
+        if (entry.file_size() == 0) {
+            ::unlink(entry.path().c_str());
+            continue;
+        }
+        auto f = std::make_shared<File>();
+        f->number = n;
+        f->fd = ::open(entry.path().c_str(), O_RDONLY);
+        if (f->fd < 0) throw std::runtime_error("open value log failed");
+        (*files)[n] = std::move(f);
+        meta[n].size = entry.file_size();
+    }
+    set = std::move(files);
+    std::lock_guard<std::mutex> lock(mu);
+    open_head_locked();
+}
+
+ValueLog::~ValueLog() {
+    try {
+        sync();
+    } catch (...) {
+        // never throw from a destructor
+    }
+    // nothing was appended since open: leave no empty file behind
+    if (head_size == 0) ::unlink(path(head->number).c_str());
+}
+
+std::string ValueLog::path(uint64_t n) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "vlog_%06llu.vlog", (unsigned long long)n);
+    return (fs::path(dir) / name).string();
+}
+
+void ValueLog::open_head_locked() {
+    auto f = std::make_shared<File>();
+    f->number = next_number++;
+    f->fd = ::open(path(f->number).c_str(), O_CREAT | O_TRUNC | O_RDWR, 0644);
+    if (f->fd < 0) throw std::runtime_error("open value log failed");
+    auto next = std::make_shared<FileSet>(*set);
+    (*next)[f->number] = f;
+    set = std::move(next);
+    meta[f->number] = Meta{};
+    head = std::move(f);
+    head_size = 0;
+    head_written = 0;
+}
+
+void ValueLog::write_buffer_locked() {
+    size_t done = 0;
+    while (done < buffer.size()) {
+        ssize_t n = ::pwrite(head->fd, buffer.data() + done, buffer.size() - done, (off_t)(head_written + done));
+        if (n <= 0) throw std::runtime_error("write value log failed");
+        done += (size_t)n;
+    }
+    head_written += buffer.size();
+    buffer.clear();
+}
+
+ValuePointer ValueLog::append(std::string_view key, std::string_view value) {
+    std::lock_guard<std::mutex> lock(mu);
+    if (head_size >= options.file_size) {
+        // seal the head: everything in it durable before it is left behind
+        write_buffer_locked();
+        if (::fdatasync(head->fd) != 0) throw std::runtime_error("fdatasync value log failed");
+        open_head_locked();
+    }
+    put_u32(buffer, (uint32_t)key.size());
+    put_u32(buffer, (uint32_t)value.size());
+    buffer.append(key);
+    buffer.append(value);
+    ValuePointer p{head->number, head_size + kRecordHeader + key.size(), (uint32_t)value.size()};
+    head_size += kRecordHeader + key.size() + value.size();
+    meta[head->number].size = head_size;
+    appended.add(value.size());
+    if (buffer.size() >= kWriteBufferBytes) write_buffer_locked();
+    return p;
+}
+
+void ValueLog::sync() {
+    std::lock_guard<std::mutex> lock(mu);
+    write_buffer_locked();
+    if (::fdatasync(head->fd) != 0) throw std::runtime_error("fdatasync value log failed");
+}
+
+std::shared_ptr<const ValueLog::FileSet> ValueLog::snapshot() const {
+    std::lock_guard<std::mutex> lock(mu);
+    return set;
+}
+
+void ValueLog::read(const FileSet& files, const ValuePointer& p, std::string& out) const {
+    auto it = files.find(p.file);
+    if (it == files.end()) throw std::runtime_error("value log file missing");
+    value_reads.add();
+    out.resize(p.size);
+    size_t done = 0;
+    while (done < p.size) {
+        ssize_t n = ::pread(it->second->fd, out.data() + done, p.size - done, (off_t)(p.offset + done));
+        if (n <= 0) throw std::runtime_error("read value log failed");
+        done += (size_t)n;
+    }
+}
+
+void ValueLog::read(const ValuePointer& p, std::string& out) const {
+    read(*snapshot(), p, out);
+}
+
+void ValueLog::for_each_record(uint64_t file,
+                               const std::function<void(std::string_view, const ValuePointer&)>& visit) const {
+    std::shared_ptr<const FileSet> files;
+    uint64_t size;
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        if (head && file == head->number) throw std::logic_error("value log file is not sealed");
+        files = set;
+        auto m = meta.find(file);
+        if (m == meta.end() || !files->count(file)) throw std::runtime_error("value log file missing");
+        size = m->second.size;
+    }
+    int fd = files->at(file)->fd;
+
+    // bytes [chunk_off, chunk_off + chunk.size()) of the file
+    std::string chunk;
+    uint64_t chunk_off = 0;
+    auto bytes = [&](uint64_t off, size_t n) -> const char* {
+        if (off < chunk_off || off + n > chunk_off + chunk.size()) {
+            chunk.resize(std::max(n, kWriteBufferBytes));
+            ssize_t got = ::pread(fd, chunk.data(), chunk.size(), (off_t)off);
+            if (got < 0) throw std::runtime_error("read value log failed");
+            chunk.resize((size_t)got);
+            chunk_off = off;
+            if (chunk.size() < n) return nullptr;
+        }
+        return chunk.data() + (off - chunk_off);
+    };
+
+    // a torn tail (crash before a sync) simply ends the walk
+    uint64_t pos = 0;
+    while (pos + kRecordHeader <= size) {
+        const char* h = bytes(pos, kRecordHeader);
+        if (!h) break;
+        uint64_t klen = get_u32(h), vlen = get_u32(h + sizeof(uint32_t));
+        if (pos + kRecordHeader + klen + vlen > size) break;
+        const char* k = bytes(pos + kRecordHeader, klen);
+        if (!k) break;
+        visit(std::string_view(k, klen), ValuePointer{file, pos + kRecordHeader + klen, (uint32_t)vlen});
+        pos += kRecordHeader + klen + vlen;
+    }
+}
+
+void ValueLog::add_garbage(uint64_t file, uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mu);
+    auto it = meta.find(file);
+    if (it != meta.end()) it->second.garbage += bytes;   // a file already collected has nothing left to count
+}
+
+void ValueLog::set_garbage(uint64_t file, uint64_t bytes) {
+    std::lock_guard<std::mutex> lock(mu);
+    auto it = meta.find(file);
+    if (it != meta.end()) it->second.garbage = bytes;
+}
+
+std::vector<ValueLog::FileInfo> ValueLog::files() const {
+    std::lock_guard<std::mutex> lock(mu);
+    std::vector<FileInfo> out;
+    for (const auto& [n, m] : meta) out.push_back({n, m.size, m.garbage, n != head->number});
+    return out;
+}
+
+uint64_t ValueLog::pick_for_collection() const {
+    std::lock_guard<std::mutex> lock(mu);
+    uint64_t best = 0;
+    double best_ratio = 0;
+    for (const auto& [n, m] : meta) {
+        if (n == head->number || m.size == 0) continue;
+        double ratio = (double)m.garbage / (double)m.size;
+        if (ratio >= options.gc_garbage_ratio && ratio > best_ratio) {
+            best = n;
+            best_ratio = ratio;
+        }
+    }
+    return best;
+}
+
+void ValueLog::remove_file(uint64_t file) {
+    std::lock_guard<std::mutex> lock(mu);
+    if (head && file == head->number) throw std::logic_error("cannot remove the value log head");
+    auto next = std::make_shared<FileSet>(*set);
+    next->erase(file);
+    set = std::move(next);
+    meta.erase(file);
+    ::unlink(path(file).c_str());
+}
+
+SeparatedValueIterator::SeparatedValueIterator(std::unique_ptr<Iterator> base_, const ValueLog* log_,
+                                               std::shared_ptr<const ValueLog::FileSet> files_)
+    : base(std::move(base_))
+    , log(log_)
+    , files(std::move(files_)) {}
+
+void SeparatedValueIterator::seek_to_first() {
+    base->seek_to_first();
+    resolved = false;
+}
+
+void SeparatedValueIterator::seek(std::string_view target) {
+    base->seek(target);
+    resolved = false;
+}
+
+void SeparatedValueIterator::next() {
+    base->next();
+    resolved = false;
+}
+
+std::string_view SeparatedValueIterator::value() const {
+    if (resolved) return current;
+    ValuePointer p;
+    if (decode_separated_value(base->value(), current, p)) {
+        if (!log || !files) throw std::runtime_error("value log missing");
+        log->read(*files, p, fetched);
+        current = fetched;
+    }
+    resolved = true;
+    return current;
+}
@@ -0,0 +1,183 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+#include "metrics.h"
+#include "iterator.h"
+
+// Tunables for key-value separation (KVOptions::value_log).
+struct ValueLogOptions {
+    // Values at least this long are written to the value log when a memtable
+    // is flushed (or a table compacted); SSTables keep a ValuePointer. 0 = off.
+    size_t min_value_size = 0;
+    uint64_t file_size = 64ull << 20;   // the file being appended to is sealed at about this size
+    // Garbage collection rewrites a sealed file once at least this share of
+    // its bytes is known to be dead.
+    double gc_garbage_ratio = 0.5;
+};
+
+// Location of one value in a value log file.
+struct ValuePointer {
+    uint64_t file{0};
+    uint64_t offset{0};   // of the value bytes
+    uint32_t size{0};
+
+    bool operator==(const ValuePointer&) const = default;
+};
+
+// Values of a table with SSTableOptions::separated_values start with one of these.
+enum ValueKind : uint8_t {
+    kInlineValue = 0,    // [kind][value bytes]
+    kValuePointer = 1,   // [kind][file varint][offset varint][size varint]
+};
+
+// Encode a value of a separated table into 'out' (replacing its contents).
+void encode_inline_value(std::string& out, std::string_view value);
+void encode_value_pointer(std::string& out, const ValuePointer& p);
+
+// Decode a value of a separated table: true and 'p' for a pointer, false and
+// 'inline_value' (a view into 'stored') for an inline value. Throws
+// std::runtime_error on a malformed value.
+bool decode_separated_value(std::string_view stored, std::string_view& inline_value, ValuePointer& p);
+
+// ValueLog: append-only files of large values (WiscKey-style separation)
+// ----------------------------------------
+// Values go to the newest file, vlog_<number>.vlog, as records
+//   [key_len u32][value_len u32][key bytes][value bytes]
+// and are addressed by ValuePointer. The key is kept so garbage collection
+// can walk a file and ask the LSM tree whether each value is still the one
+// its key points to. Appends are buffered; sync() writes them out and
+// fdatasyncs, and must run before a table holding their pointers is
+// installed. A file is sealed (synced and never written again) once it
+// reaches file_size, and a new one started; every open starts a new file,
+// so a torn tail left by a crash is never appended to - nothing points past
+// the last sync anyway.
+//
+// Reads go through a FileSet: an immutable map of open files, replaced
+// (never changed) when a file is added or removed, like the engine's level
+// structure. A reader holding a snapshot keeps the files it names readable
+// after remove_file() unlinks them, until the snapshot is released.
+//
+// Dead bytes per file are not discovered by the log itself: the engine
+// reports values that compactions drop through add_garbage(), and the
+// counts are persisted by the engine (set_garbage() on open).
+//
+// All methods are thread-safe.
+class ValueLog {
+public:
+    struct File {
+        uint64_t number{0};
+        int fd{-1};
+        ~File();
+    };
+    using FileSet = std::map<uint64_t, std::shared_ptr<const File>>;
+
+    // Size and known garbage of one file.
+    struct FileInfo {
+        uint64_t number{0};
+        uint64_t size{0};
+        uint64_t garbage{0};
+        bool sealed{false};
+    };
+
+    // Open the vlog_*.vlog files in 'dir' and start a new file for appends.
+    ValueLog(std::string dir, ValueLogOptions options);
+    ~ValueLog();
+
+    ValueLog(const ValueLog&) = delete;
+    ValueLog& operator=(const ValueLog&) = delete;
+
+    // True if 'dir' holds value log files (an engine that no longer
+    // separates values still has to read them).
+    static bool exists(const std::string& dir);
+
+    ValuePointer append(std::string_view key, std::string_view value);
+
+    // Write buffered appends and make them durable.
+    void sync();
+
+    [[nodiscard]] std::shared_ptr<const FileSet> snapshot() const;
+
+    // Read the value 'p' points at into 'out', through 'files' (a snapshot)
+    // or the current file set. Throws std::runtime_error if it is missing.
+    void read(const FileSet& files, const ValuePointer& p, std::string& out) const;
+    void read(const ValuePointer& p, std::string& out) const;
+
+    // Visit the records of a sealed file in file order.
+    void for_each_record(uint64_t file, const std::function<void(std::string_view key, const ValuePointer& p)>& visit) const;
+
+    void add_garbage(uint64_t file, uint64_t bytes);
+    void set_garbage(uint64_t file, uint64_t bytes);
+    [[nodiscard]] std::vector<FileInfo> files() const;
+
+    // The sealed file with the largest share of garbage, if that share is at
+    // least gc_garbage_ratio; 0 if none.
+    [[nodiscard]] uint64_t pick_for_collection() const;
+
+    // Drop a file from the set and unlink it; snapshots still holding it can read it.
+    void remove_file(uint64_t file);
+
+    [[nodiscard]] uint64_t bytes_written() const { return appended.load(); }
+    [[nodiscard]] uint64_t reads() const { return value_reads.load(); }
+
+private:
+    struct Meta {
+        uint64_t size{0};
+        uint64_t garbage{0};
+    };
+
+    std::string dir;
+    ValueLogOptions options;
+
+    mutable std::mutex mu;
+    std::shared_ptr<const FileSet> set;   // replaced, never modified in place
+    std::map<uint64_t, Meta> meta;
+    std::shared_ptr<const File> head;     // file being appended to
+    uint64_t head_size{0};                // bytes appended to head, buffered ones included
+    uint64_t head_written{0};             // bytes of head handed to write()
+    std::string buffer;                   // appends not yet written
+    uint64_t next_number{1};
+    ShardedCounter appended;              // value bytes appended
+    mutable ShardedCounter value_reads;
+
+    [[nodiscard]] std::string path(uint64_t n) const;
+
+    // Start a new head file. Caller holds mu.
+    void open_head_locked();
+
+    // Write 'buffer' to the head file. Caller holds mu.
+    void write_buffer_locked();
+};
+
+// SeparatedValueIterator: a separated table's iterator that returns the
+// values themselves. Inline values are unwrapped in place; a pointer is read
+// from the log (through 'files', the snapshot the caller reads under) on the
+// first value() call at a position, so a walk over keys alone never touches
+// the log. 'log' may be null if the table holds no pointers.
+class SeparatedValueIterator : public Iterator {
+public:
+    SeparatedValueIterator(std::unique_ptr<Iterator> base, const ValueLog* log,
+                           std::shared_ptr<const ValueLog::FileSet> files);
+
+    void seek_to_first() override;
+    void seek(std::string_view target) override;
+    void next() override;
+
+    [[nodiscard]] bool valid() const override { return base->valid(); }
+    [[nodiscard]] std::string_view key() const override { return base->key(); }
+    [[nodiscard]] std::string_view value() const override;
+    [[nodiscard]] bool deleted() const override { return base->deleted(); }
+
+private:
+    std::unique_ptr<Iterator> base;
+    const ValueLog* log;
+    std::shared_ptr<const ValueLog::FileSet> files;
+    mutable bool resolved{false};
+    mutable std::string_view current;
+    mutable std::string fetched;   // value read from the log
+};
@@ -0,0 +1,216 @@
+#include "wal.h"
+#include "record.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <cstring>
+#include <stdexcept>
+#include <cerrno>
+#include <array>
+
+// Standard CRC-32 (IEEE 802.3 polynomial, reflected), table driven.
+static uint32_t crc32(const char* data, size_t n) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < n; ++i) c = table[(c ^ (uint8_t)data[i]) & 0xFF] ^ (c >> 8);
+    return c ^ 0xFFFFFFFFu;
+}
+
+static void put_u32(std::string& buf, uint32_t v) {
+    buf.append(reinterpret_cast<const char*>(&v), sizeof(v));
+}
+
+static uint32_t get_u32(const char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+WriteAheadLog::WriteAheadLog(std::string path_, WalSyncMode mode_, std::chrono::milliseconds interval_)
+    : path(std::move(path_))
+    , mode(mode_)
+    , interval(interval_) {
+    fd = ::open(path.c_str(), O_CREAT | O_RDWR | O_APPEND, 0644);
+    if (fd < 0) throw std::runtime_error("open wal failed");
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error("stat wal");
+    }
+    file_end = (uint64_t)st.st_size;
+    if (mode == WalSyncMode::Interval) syncer = std::thread(&WriteAheadLog::interval_loop, this);
+}
+
+WriteAheadLog::~WriteAheadLog() {
+    {
+        std::lock_guard<std::mutex> lock(mu);
+        stopping = true;
+    }
+    stop_cv.notify_all();
+    if (syncer.joinable()) syncer.join();
+    try {
+        std::unique_lock<std::mutex> lock(mu);
+        sync_pending(lock);
+    } catch (...) {
+        // never throw from a destructor
+    }
+    if (fd >= 0) ::close(fd);
+}
+
+void WriteAheadLog::replay(const std::function<void(const std::string&, const std::string*)>& apply) {
+    std::lock_guard<std::mutex> lock(mu);
+
+    struct stat st{};
+    if (::fstat(fd, &st) != 0) throw std::runtime_error("stat wal");
+    std::string buf((size_t)st.st_size, '\0');
+    size_t got = 0;
+    while (got < buf.size()) {
+        ssize_t r = ::pread(fd, buf.data() + got, buf.size() - got, (off_t)got);
+        if (r < 0) throw std::runtime_error("read wal");
+        if (r == 0) break;
+        got += (size_t)r;
+    }
+    buf.resize(got);
+
+    const size_t header = sizeof(uint32_t) * 3;
+    size_t off = 0;
+    std::string key, value;
+    while (off + header <= buf.size()) {
+        const char* p = buf.data() + off;
+        uint32_t crc = get_u32(p);
+        uint32_t klen = get_u32(p + 4);
+        uint32_t vlen = get_u32(p + 8);
+        bool deleted = (vlen == kTombstoneVlen);
+        uint64_t vbytes = deleted ? 0 : vlen;
+        uint64_t total = header + (uint64_t)klen + vbytes;
+        if (off + total > buf.size()) break;                      // torn tail
+        if (crc32(p + 4, total - 4) != crc) break;                 // corrupt tail
+
+        key.assign(p + header, klen);
+        value.assign(p + header + klen, vbytes);
+        apply(key, deleted ? nullptr : &value);
+        off += total;
+        ++last_seq;
+    }
+    synced_seq = last_seq;
+
+    if (off < buf.size() && ::ftruncate(fd, (off_t)off) != 0) throw std::runtime_error("truncate wal tail");
+    file_end = off;
+}
+
+uint64_t WriteAheadLog::append(const std::string& key, const std::string* value) {
+    std::unique_lock<std::mutex> lock(mu);
+
+    size_t start = pending.size();
+    uint32_t klen = (uint32_t)key.size();
+    uint32_t vlen = value ? (uint32_t)value->size() : kTombstoneVlen;
+    put_u32(pending, 0);   // crc placeholder
+    put_u32(pending, klen);
+    put_u32(pending, vlen);
+    pending.append(key);
+    if (value) pending.append(*value);
+    uint32_t crc = crc32(pending.data() + start + 4, pending.size() - start - 4);
+    std::memcpy(pending.data() + start, &crc, sizeof(crc));
+
+    uint64_t seq = ++last_seq;
+    if (mode == WalSyncMode::PerWrite) sync_pending(lock);
+    return seq;
+}
+
+void WriteAheadLog::sync_to(uint64_t seq) {
+    if (mode != WalSyncMode::PerBatch) return;   // PerWrite already synced, Interval syncs in background
+    std::unique_lock<std::mutex> lock(mu);
+    while (synced_seq < seq) {
+        if (syncing) synced_cv.wait(lock);       // follower: a leader's batch may cover us
+        else sync_pending(lock);                 // leader: sync everything appended so far
+    }
+}
+
+void WriteAheadLog::sync_pending(std::unique_lock<std::mutex>& lock) {
+    while (syncing) synced_cv.wait(lock);
+    if (pending.empty()) {
+        synced_seq = last_seq;
+        return;
+    }
+
+    syncing = true;
+    std::string batch;
+    batch.swap(pending);
+    uint64_t batch_end = last_seq;
+
+    lock.unlock();
+    try {
+        write_and_sync(batch);
+    } catch (...) {
+        lock.lock();
+        pending.insert(0, batch);   // put the batch back so a later sync retries it
+        syncing = false;
+        synced_cv.notify_all();
+        throw;
+    }
+    lock.lock();
+
+    syncing = false;
+    if (batch_end > synced_seq) synced_seq = batch_end;
+    ++syncs;
+    synced_cv.notify_all();
+}
+
+void WriteAheadLog::write_and_sync(const std::string& batch) {
+    // a failed batch left part of itself behind and cutting it off failed too
+    if (torn) {
+        if (::ftruncate(fd, (off_t)file_end) != 0) throw std::runtime_error("truncate wal");
+        torn = false;
+    }
+    try {
+        size_t done = 0;
+        while (done < batch.size()) {
+            ssize_t w = ::write(fd, batch.data() + done, batch.size() - done);
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) throw std::runtime_error("write wal");
+            done += (size_t)w;
+        }
+        if (::fdatasync(fd) != 0) throw std::runtime_error("fdatasync wal");
+    } catch (...) {
+        // the caller puts the batch back and retries it whole: drop what got written
+        torn = ::ftruncate(fd, (off_t)file_end) != 0;
+        throw;
+    }
+    file_end += batch.size();
+}
+
+void WriteAheadLog::truncate() {
+    std::unique_lock<std::mutex> lock(mu);
+    while (syncing) synced_cv.wait(lock);   // don't let an in-flight batch land after the truncate
+    pending.clear();
+    if (::ftruncate(fd, 0) != 0) throw std::runtime_error("truncate wal");
+    file_end = 0;
+    torn = false;
+    synced_seq = last_seq;
+    synced_cv.notify_all();
+}
+
+uint64_t WriteAheadLog::sync_count() const {
+    std::lock_guard<std::mutex> lock(mu);
+    return syncs;
+}
+
+void WriteAheadLog::interval_loop() {
+    std::unique_lock<std::mutex> lock(mu);
+    while (!stopping) {
+        stop_cv.wait_for(lock, interval, [&] { return stopping; });
+        try {
+            if (!pending.empty()) sync_pending(lock);
+        } catch (...) {
+            // keep the records pending; the next tick (or the destructor) retries
+        }
+    }
+}
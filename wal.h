@@ -0,0 +1,90 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+// When a WAL append is considered durable.
+enum class WalSyncMode {
+    PerWrite,   // every record is written and fdatasync'ed on its own before append() returns
+    PerBatch,   // group commit: concurrent writers waiting in sync_to() share one fdatasync
+    Interval,   // a background thread syncs every 'interval'; a crash may lose the last interval
+};
+
+// WriteAheadLog: append-only redo log for the memtable
+// ----------------------------------------
+// Every put/delete is appended here before it is applied to the memtable,
+// so the memtable can be rebuilt after a crash by replaying the log.
+// The engine gives each memtable a log file of its own and deletes it once
+// that memtable has been flushed to an SSTable.
+//
+// Record format: [crc32][key_len][val_len][key_bytes][val_bytes]
+//   - crc32 covers everything after it; a torn or corrupt tail ends replay
+//   - val_len == kTombstoneVlen marks a delete (no value bytes)
+//
+// Group commit: append() only serializes the record into an in-memory
+// buffer and hands back a sequence number. sync_to(seq) makes one waiting
+// thread the leader, which writes the whole pending buffer with a single
+// write() + fdatasync(); every follower whose record was in that buffer
+// returns without its own syscall.
+//
+// A batch whose write or fdatasync fails is cut back off the file before it
+// is retried, so a retry never lands behind a torn copy of itself (replay
+// would stop at the torn one and drop everything after it).
+class WriteAheadLog {
+public:
+    WriteAheadLog(std::string path, WalSyncMode mode,
+                  std::chrono::milliseconds interval = std::chrono::milliseconds(10));
+    ~WriteAheadLog();
+
+    WriteAheadLog(const WriteAheadLog&) = delete;
+    WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+
+    // Re-apply all intact records in log order; value is nullptr for a delete.
+    // A torn tail (from a crash mid-write) is cut off so new appends follow valid data.
+    // Call once, before the first append().
+    void replay(const std::function<void(const std::string&, const std::string*)>& apply);
+
+    // Log a put (value != nullptr) or delete (value == nullptr).
+    // Returns the record's sequence number to pass to sync_to().
+    uint64_t append(const std::string& key, const std::string* value);
+
+    // Block until record 'seq' is durable under the configured sync mode.
+    void sync_to(uint64_t seq);
+
+    // Drop every record.
+    void truncate();
+
+    [[nodiscard]] uint64_t sync_count() const;   // number of fdatasync calls issued so far
+
+private:
+    std::string path;
+    WalSyncMode mode;
+    std::chrono::milliseconds interval;
+    int fd{-1};
+    uint64_t file_end{0};                 // end of the intact records; owned by the leader
+    bool torn{false};                     // bytes past file_end still need cutting off
+
+    mutable std::mutex mu;
+    std::condition_variable synced_cv;    // signalled when synced_seq advances
+    std::string pending;                  // serialized records not yet written
+    uint64_t last_seq{0};                 // seq of the last appended record
+    uint64_t synced_seq{0};               // every record <= synced_seq is durable
+    bool syncing{false};                  // a leader is writing + syncing a batch
+    uint64_t syncs{0};
+
+    bool stopping{false};
+    std::condition_variable stop_cv;
+    std::thread syncer;                   // Interval mode only
+
+    // Write 'batch' and fdatasync. Called without mu held by the current leader.
+    void write_and_sync(const std::string& batch);
+
+    // Become leader, sync everything pending, then wake waiters. Caller holds 'lock'.
+    void sync_pending(std::unique_lock<std::mutex>& lock);
+
+    void interval_loop();
+};